@@ -1,24 +1,43 @@
 # https://github.com/pybind/pybind11/issues/1004
 from _pygalmesh import (
+    Affine,
     Ball,
+    CancelToken,
+    CompiledDomain,
     Cone,
+    ConstantSizingField,
+    ConvexPolyhedron,
     Cuboid,
     Cylinder,
     Difference,
+    DistanceToPointsField,
+    DistanceToPolylinesField,
+    DistanceToSurfaceField,
     DomainBase,
     Ellipsoid,
     Extrude,
+    GradedSizingField,
+    GridSizingField,
     HalfSpace,
     Intersection,
+    MaxSizingField,
+    MeshResult,
+    MeshSizingField,
+    MinSizingField,
+    NativeDomain,
+    NativeSizingField,
     Polygon2D,
     RingExtrude,
     Rotate,
     Scale,
+    ScaledSizingField,
     Stretch,
+    SurfaceMeshDomain,
     Tetrahedron,
     Torus,
     Translate,
     Union,
+    fuse_transforms,
 )
 
 from . import _cli
@@ -27,12 +46,18 @@ from .main import (
     generate_2d,
     generate_from_array,
     generate_from_inr,
+    generate_many,
     generate_mesh,
+    generate_mesh_partitioned,
     generate_periodic_mesh,
     generate_surface_mesh,
     generate_volume_mesh_from_surface_mesh,
+    load_mesh,
+    load_mesh_from_inr,
+    refine_existing,
     remesh_surface,
     save_inr,
+    write,
 )
 
 __all__ = [
@@ -46,28 +71,54 @@ __all__ = [
     "Rotate",
     "Scale",
     "Stretch",
+    "Affine",
+    "fuse_transforms",
     "Intersection",
     "Union",
     "Difference",
+    "CompiledDomain",
+    "NativeDomain",
     "Extrude",
     "Ball",
     "Cuboid",
     "Ellipsoid",
     "Tetrahedron",
+    "ConvexPolyhedron",
     "Cone",
     "Cylinder",
     "Torus",
     "HalfSpace",
     "Polygon2D",
     "RingExtrude",
+    "SurfaceMeshDomain",
     #
+    "GridSizingField",
+    "ConstantSizingField",
+    "DistanceToPointsField",
+    "DistanceToPolylinesField",
+    "DistanceToSurfaceField",
+    "MinSizingField",
+    "MaxSizingField",
+    "ScaledSizingField",
+    "GradedSizingField",
+    "MeshSizingField",
+    "NativeSizingField",
+    #
+    "MeshResult",
+    "CancelToken",
     "generate_mesh",
+    "generate_many",
+    "generate_mesh_partitioned",
     "generate_2d",
     "generate_periodic_mesh",
     "generate_surface_mesh",
     "generate_volume_mesh_from_surface_mesh",
     "generate_from_array",
     "generate_from_inr",
+    "load_mesh",
+    "load_mesh_from_inr",
+    "refine_existing",
     "remesh_surface",
     "save_inr",
+    "write",
 ]
@@ -1,11 +1,10 @@
 import argparse
 from sys import version_info
 
-import meshio
 from _pygalmesh import _CGAL_VERSION_STR
 
 from .__about__ import __version__
-from .main import generate_from_inr, generate_volume_mesh_from_surface_mesh
+from .main import generate_from_inr, generate_volume_mesh_from_surface_mesh, write
 from .main import remesh_surface as rms
 
 
@@ -69,8 +68,9 @@ def inr(args):
         max_circumradius_edge_ratio=args.max_circumradius_edge_ratio,
         max_cell_circumradius=args.max_cell_circumradius,
         verbose=not args.quiet,
+        lazy=True,
     )
-    meshio.write(args.outfile, mesh)
+    write(args.outfile, mesh)
 
 
 def _cli_inr(parser):
@@ -180,8 +180,9 @@ def remesh_surface(args):
         max_radius_surface_delaunay_ball=args.max_radius_surface_delaunay_ball,
         max_facet_distance=args.max_facet_distance,
         verbose=not args.quiet,
+        lazy=True,
     )
-    meshio.write(args.outfile, mesh)
+    write(args.outfile, mesh)
 
 
 def _cli_remesh(parser):
@@ -245,8 +246,9 @@ def volume_from_surface(args):
         max_cell_circumradius=args.max_cell_circumradius,
         reorient=args.reorient,
         verbose=not args.quiet,
+        lazy=True,
     )
-    meshio.write(args.outfile, mesh)
+    write(args.outfile, mesh)
 
 
 def _cli_volume_from_surface(parser):
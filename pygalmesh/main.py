@@ -1,25 +1,99 @@
 from __future__ import annotations
 
 import math
-import os
-import tempfile
+import pathlib
+import warnings
 from typing import Callable
 
 import meshio
 import numpy as np
 from _pygalmesh import (
+    CancelToken,
+    MeshResult,
     SizingFieldBase,
+    _ImageArray,
+    _MeshBatch,
+    _MeshingOptions,
+    _MeshJob,
     _generate_2d,
-    _generate_from_inr,
+    _generate_from_array,
+    _generate_from_array_with_subdomain_sizing,
+    _generate_from_inr_with_sizing_fields,
     _generate_from_inr_with_subdomain_sizing,
-    _generate_from_off,
+    _generate_from_off_with_sizing_fields,
     _generate_mesh,
-    _generate_periodic_mesh,
+    _generate_mesh_partitioned,
+    _generate_mesh_watched,
+    _generate_periodic_mesh_with_sizing_fields,
     _generate_surface_mesh,
-    _remesh_surface,
+    _load_mesh,
+    _load_mesh_from_inr,
+    _remesh_surface_with_sizing_fields,
+    _write_meshb,
+    _write_vtu,
 )
 
 
+def _get_num_threads(parallel: bool, num_threads: int | None) -> int:
+    # 0 selects the sequential mesher, -1 the parallel one on all cores
+    if num_threads is None:
+        return -1 if parallel else 0
+    if num_threads < 1:
+        raise ValueError(f"num_threads must be positive, got {num_threads}.")
+    return num_threads
+
+
+def _surface_arrays(mesh: str | meshio.Mesh) -> tuple[np.ndarray, np.ndarray]:
+    # The vertices are passed on without a copy if they already are C-contiguous
+    # float64; faces usually come as int64 and are narrowed.
+    if not isinstance(mesh, meshio.Mesh):
+        mesh = meshio.read(mesh)
+    faces = mesh.get_cells_type("triangle")
+    if len(faces) == 0:
+        raise ValueError("Expected a triangle surface mesh.")
+    vertices = np.ascontiguousarray(mesh.points, dtype=np.float64)
+    return vertices, np.ascontiguousarray(faces, dtype=np.intc)
+
+
+def _split_subdomain_sizing(
+    max_cell_circumradius: dict[int | str, float]
+) -> tuple[float, list[float], list[int]]:
+    # default value, values, and subdomain labels
+    assert isinstance(max_cell_circumradius, dict)
+    sizes = dict(max_cell_circumradius)
+    default_max_cell_circumradius = sizes.pop("default", 0.0)
+    return default_max_cell_circumradius, list(sizes.values()), list(sizes.keys())
+
+
+def _to_meshio(data: dict) -> meshio.Mesh:
+    # The arrays own the buffers the mesher filled; nothing is copied here. Subdomain
+    # indices and surface patch numbers become "medit:ref". The patches are numbered
+    # 1, 2, ... in the order of their first triangle, not like in the .mesh files of
+    # CGAL.
+    cells = []
+    refs = []
+    for cell_type, ref_key in [
+        ("triangle", "triangle_patch"),
+        ("tetra", "tetra_subdomain"),
+        ("line", "line_curve"),
+    ]:
+        if len(data[cell_type]) > 0:
+            cells.append((cell_type, data[cell_type]))
+            refs.append(data[ref_key])
+    cell_data = (
+        {"medit:ref": refs}
+        if all(len(ref) == len(c) for ref, (_, c) in zip(refs, cells))
+        else None
+    )
+    return meshio.Mesh(data["points"], cells, cell_data=cell_data)
+
+
+def _from_result(result: MeshResult, lazy: bool) -> meshio.Mesh | MeshResult:
+    # A lazy result keeps CGAL's mesh and reads it out on demand; otherwise, the
+    # complex is freed right after the conversion.
+    return result if lazy else _to_meshio(result.arrays())
+
+
 class Wrapper(SizingFieldBase):
     def __init__(self, f):
         self.f = f
@@ -29,6 +103,121 @@ class Wrapper(SizingFieldBase):
         return self.f(x)
 
 
+def _select_sizing(obj) -> tuple[float, SizingFieldBase | None]:
+    # a constant, a sizing field, or a function that is wrapped into one
+    if isinstance(obj, float) or isinstance(obj, int):
+        return float(obj), None
+    if isinstance(obj, SizingFieldBase):
+        return -1.0, obj
+    assert callable(obj)
+    return -1.0, Wrapper(obj)
+
+
+def _meshing_options(
+    lloyd: bool = False,
+    odt: bool = False,
+    perturb: bool = True,
+    exude: bool = True,
+    min_edge_size_at_feature_edges: float = 0.0,
+    max_edge_size_at_feature_edges: float | Callable[..., float] = np.finfo(float).max,
+    min_facet_angle: float = 0.0,
+    max_radius_surface_delaunay_ball: float | Callable[..., float] = 0.0,
+    max_facet_distance: float | Callable[..., float] = 0.0,
+    max_circumradius_edge_ratio: float = 0.0,
+    max_cell_circumradius: float | Callable[..., float] = 0.0,
+    exude_time_limit: float = 0.0,
+    exude_sliver_bound: float = 0.0,
+    verbose: bool = True,
+    seed: int = 0,
+    num_threads: int = 0,
+) -> _MeshingOptions:
+    # the criteria of generate_mesh() for a single mesher run
+    options = _MeshingOptions()
+    options.lloyd = lloyd
+    options.odt = odt
+    options.perturb = perturb
+    options.exude = exude
+    options.min_edge_size_at_feature_edges = min_edge_size_at_feature_edges
+    (
+        options.max_edge_size_at_feature_edges_value,
+        options.max_edge_size_at_feature_edges_field,
+    ) = _select_sizing(max_edge_size_at_feature_edges)
+    options.min_facet_angle = min_facet_angle
+    (
+        options.max_radius_surface_delaunay_ball_value,
+        options.max_radius_surface_delaunay_ball_field,
+    ) = _select_sizing(max_radius_surface_delaunay_ball)
+    (
+        options.max_facet_distance_value,
+        options.max_facet_distance_field,
+    ) = _select_sizing(max_facet_distance)
+    options.max_circumradius_edge_ratio = max_circumradius_edge_ratio
+    (
+        options.max_cell_circumradius_value,
+        options.max_cell_circumradius_field,
+    ) = _select_sizing(max_cell_circumradius)
+    options.exude_time_limit = exude_time_limit
+    options.exude_sliver_bound = exude_sliver_bound
+    options.verbose = verbose
+    options.seed = seed
+    options.num_threads = num_threads
+    return options
+
+
+def _mesh_job(
+    domain,
+    extra_feature_edges: list | None = None,
+    bounding_sphere_radius: float = 0.0,
+    bounding_cuboid: list[float] | None = None,
+    **criteria,
+) -> _MeshJob:
+    # the input of one generate_mesh() run
+    job = _MeshJob()
+    job.domain = domain
+    if extra_feature_edges is not None:
+        job.extra_feature_edges = extra_feature_edges
+    job.bounding_sphere_radius = bounding_sphere_radius
+    if bounding_cuboid is not None:
+        job.has_bounding_cuboid = True
+        job.bounding_cuboid = bounding_cuboid
+    job.options = _meshing_options(**criteria)
+    return job
+
+
+def _control(
+    deadline: float | None,
+    max_vertices: int | None,
+    cancel_token: CancelToken | None,
+    progress: Callable[[str, int, int], None] | None,
+    progress_interval: float,
+) -> dict | None:
+    # the budgets of a watched mesher run, 0 standing for none, or None if there is
+    # nothing to watch for
+    if deadline is not None and deadline <= 0.0:
+        raise ValueError(f"deadline must be positive, got {deadline}.")
+    if max_vertices is not None and max_vertices < 1:
+        raise ValueError(f"max_vertices must be positive, got {max_vertices}.")
+    if all(arg is None for arg in [deadline, max_vertices, cancel_token, progress]):
+        return None
+    return dict(
+        time_limit=0.0 if deadline is None else deadline,
+        max_vertices=0 if max_vertices is None else max_vertices,
+        cancel_token=cancel_token,
+        progress=progress,
+        progress_interval=progress_interval,
+    )
+
+
+def _warn_if_incomplete(stop_reason: str):
+    if stop_reason:
+        warnings.warn(
+            f"Meshing stopped early ({stop_reason}); "
+            "the mesh does not meet all criteria.",
+            RuntimeWarning,
+            stacklevel=3,
+        )
+
+
 def generate_mesh(
     domain,
     extra_feature_edges: list | None = None,
@@ -49,6 +238,14 @@ def generate_mesh(
     exude_sliver_bound: float = 0.0,
     verbose: bool = True,
     seed: int = 0,
+    parallel: bool = False,
+    num_threads: int | None = None,
+    lazy: bool = False,
+    deadline: float | None = None,
+    max_vertices: int | None = None,
+    progress: Callable[[str, int, int], None] | None = None,
+    progress_interval: float = 1.0,
+    cancel_token: CancelToken | None = None,
 ):
     """
     From <https://doc.cgal.org/latest/Mesh_3/classCGAL_1_1Mesh__criteria__3.html>:
@@ -71,33 +268,44 @@ def generate_mesh(
     max_cell_circumradius:
         a scalar field (resp. a constant) describing a space varying (resp. a uniform)
         upper-bound for the circumradii of the mesh tetrahedra.
-    """
-    extra_feature_edges = [] if extra_feature_edges is None else extra_feature_edges
-
-    fh, outfile = tempfile.mkstemp(suffix=".mesh")
-    os.close(fh)
-
-    def _select(obj):
-        if isinstance(obj, float) or isinstance(obj, int):
-            return float(obj), None
-        assert callable(obj)
-        return -1.0, Wrapper(obj)
-
-    (
-        max_edge_size_at_feature_edges_value,
-        max_edge_size_at_feature_edges_field,
-    ) = _select(max_edge_size_at_feature_edges)
-    max_cell_circumradius_value, max_cell_circumradius_field = _select(
-        max_cell_circumradius
-    )
-    (
-        max_radius_surface_delaunay_ball_value,
-        max_radius_surface_delaunay_ball_field,
-    ) = _select(max_radius_surface_delaunay_ball)
-    max_facet_distance_value, max_facet_distance_field = _select(
-        max_facet_distance
-    )
 
+    The fields can be Python functions of a point or `SizingFieldBase` objects. The
+    built-in ones, e.g., `GridSizingField`, are evaluated without calls into Python
+    and are much faster.
+
+    parallel:
+        refine and optimize the mesh with multiple threads; requires pygalmesh to be
+        built with TBB. The result is not reproducible with `seed`.
+    num_threads:
+        number of threads of the parallel mesher; implies `parallel`. Defaults to all
+        cores.
+    lazy:
+        return a `MeshResult` instead of a meshio.Mesh. It holds on to CGAL's mesh and
+        reads the points and cells off it when asked for, e.g., chunk by chunk with
+        `iter_chunks()` or straight into a file with `write()`.
+
+    deadline:
+        time budget of the call in seconds. Refinement stops once it is used up, and
+        the optimization steps get what is left as their time limit.
+    max_vertices:
+        stop refining once the mesh has that many vertices; the optimization steps
+        still run.
+    progress:
+        called as `progress(phase, num_vertices, num_cells)` on the calling thread
+        whenever the mesher enters a phase, "refine", "lloyd", "odt", "perturb",
+        "exude" or "done", and every `progress_interval` seconds in between. The
+        counts are the ones at the start of the phase; CGAL doesn't report them
+        while it works.
+    cancel_token:
+        a `CancelToken`; calling its `cancel()`, e.g., from another thread, stops the
+        mesher.
+
+    A mesher that stops early returns the mesh as far as it got, with a
+    RuntimeWarning. With any of these arguments given, Ctrl-C stops it as well and
+    raises KeyboardInterrupt once it has; without them, CGAL's make_mesh_3 runs
+    uninterrupted. Only the refinement can be stopped. The optimization steps, lloyd,
+    odt, perturb and exude, run to the end of their time limit.
+    """
     # if feature_edges:
     #     if max_edge_size_at_feature_edges == 0.0:
     #         raise ValueError(
@@ -108,39 +316,174 @@ def generate_mesh(
     #         "No feature edges. The max_edge_size_at_feature_edges argument has no effect."
     #     )
 
-    kwargs = dict(
+    job = _mesh_job(
+        domain,
         extra_feature_edges=extra_feature_edges,
+        bounding_sphere_radius=bounding_sphere_radius,
+        bounding_cuboid=bounding_cuboid,
         lloyd=lloyd,
         odt=odt,
         perturb=perturb,
         exude=exude,
         min_edge_size_at_feature_edges=min_edge_size_at_feature_edges,
-        max_edge_size_at_feature_edges_value=max_edge_size_at_feature_edges_value,
-        max_edge_size_at_feature_edges_field=max_edge_size_at_feature_edges_field,
+        max_edge_size_at_feature_edges=max_edge_size_at_feature_edges,
         min_facet_angle=min_facet_angle,
-        max_radius_surface_delaunay_ball_value=max_radius_surface_delaunay_ball_value,
-        max_radius_surface_delaunay_ball_field=max_radius_surface_delaunay_ball_field,
-        max_facet_distance_value=max_facet_distance_value,
-        max_facet_distance_field=max_facet_distance_field,
+        max_radius_surface_delaunay_ball=max_radius_surface_delaunay_ball,
+        max_facet_distance=max_facet_distance,
         max_circumradius_edge_ratio=max_circumradius_edge_ratio,
-        max_cell_circumradius_value=max_cell_circumradius_value,
-        max_cell_circumradius_field=max_cell_circumradius_field,
+        max_cell_circumradius=max_cell_circumradius,
         exude_time_limit=exude_time_limit,
         exude_sliver_bound=exude_sliver_bound,
         verbose=verbose,
         seed=seed,
+        num_threads=_get_num_threads(parallel, num_threads),
+    )
+    control = _control(
+        deadline, max_vertices, cancel_token, progress, progress_interval
     )
+    if control is None:
+        return _from_result(_generate_mesh(job), lazy)
+    result, stop_reason = _generate_mesh_watched(job, **control)
+    _warn_if_incomplete(stop_reason)
+    return _from_result(result, lazy)
 
-    if bounding_cuboid is not None:
-        kwargs["bounding_cuboid"] = bounding_cuboid
+
+def generate_many(
+    jobs: list | dict,
+    max_workers: int | None = None,
+    seed: int = 0,
+    lazy: bool = False,
+):
+    """Runs many `generate_mesh()` calls at once on a pool of C++ threads and yields
+    `(key, mesh)` pairs as the meshes finish. `jobs` is a list or a dict of specs, and
+    the key is the list index or the dict key, respectively. A spec is either a dict
+    with the domain under "domain" and further keyword arguments of `generate_mesh()`,
+    or a pair of the domain and a dict of those arguments. `parallel` and
+    `num_threads` aren't supported; the jobs run sequentially, `max_workers` at a time
+    (defaults to all cores).
+
+    Jobs without a seed get `seed + k`, k being the position of the job, so the
+    results don't depend on the order in which the jobs run. `verbose` defaults to
+    False. Jobs with domains or sizing fields written in Python take turns at the GIL.
+    If a job fails, the error is raised from the iteration; jobs that haven't started
+    yet when the iteration is abandoned are dropped.
+    """
+    if isinstance(jobs, dict):
+        keys = list(jobs.keys())
+        specs = list(jobs.values())
     else:
-        kwargs["bounding_sphere_radius"] = bounding_sphere_radius
+        specs = list(jobs)
+        keys = list(range(len(specs)))
+
+    native_jobs = []
+    for k, spec in enumerate(specs):
+        if isinstance(spec, dict):
+            criteria = dict(spec)
+            domain = criteria.pop("domain")
+        else:
+            domain, criteria = spec
+            criteria = dict(criteria)
+
+        criteria.setdefault("seed", seed + k)
+        criteria.setdefault("verbose", False)
+        native_jobs.append(_mesh_job(domain, **criteria))
+
+    # started right away, not on the first iteration
+    batch = _MeshBatch(native_jobs, _get_num_threads(False, max_workers))
+
+    def results():
+        for index, result in batch:
+            yield keys[index], _from_result(result, lazy)
 
-    _generate_mesh(domain, outfile, **kwargs)
+    return results()
 
-    mesh = meshio.read(outfile)
-    os.remove(outfile)
-    return mesh
+
+def generate_mesh_partitioned(
+    domain,
+    bounding_cuboid: list[float],
+    num_blocks: tuple[int, int, int] = (2, 2, 2),
+    extra_feature_edges: list | None = None,
+    lloyd: bool = False,
+    odt: bool = False,
+    perturb: bool = True,
+    exude: bool = True,
+    min_edge_size_at_feature_edges: float = 0.0,
+    max_edge_size_at_feature_edges: float | Callable[..., float] | None = None,
+    min_facet_angle: float = 0.0,
+    max_radius_surface_delaunay_ball: float | Callable[..., float] = 0.0,
+    max_facet_distance: float | Callable[..., float] = 0.0,
+    max_circumradius_edge_ratio: float = 0.0,
+    max_cell_circumradius: float | Callable[..., float] = 0.0,
+    exude_time_limit: float = 0.0,
+    exude_sliver_bound: float = 0.0,
+    verbose: bool = True,
+    seed: int = 0,
+    max_workers: int | None = None,
+) -> meshio.Mesh:
+    """Meshes a domain block by block, like `generate_mesh()` with a
+    `bounding_cuboid`. The cuboid is split into `num_blocks` blocks along x, y, and z,
+    which are meshed as the domain restricted to them on `max_workers` threads
+    (defaults to all cores) and merged. Only the blocks being meshed at a time hold a
+    triangulation, so this needs less memory than meshing the whole domain at once.
+
+    The curves along which the block faces cut the domain boundary, the block edges
+    inside the domain, and a grid of lines through the domain on the faces between
+    blocks, no coarser than `max_edge_size_at_feature_edges`, are protected as
+    features in all blocks they belong to. Both sides of a face thus get the same
+    points on it and mesh it alike; the points are welded, so the merged mesh is
+    conforming. A `RuntimeError` is raised if a facet on a face between blocks has no
+    twin on the other side; a smaller `max_edge_size_at_feature_edges` may help.
+    The features of the domain are cut into their parts in each block; line cells are
+    labeled with the number of the feature they come from.
+
+    The protected curves need `max_edge_size_at_feature_edges`, which defaults to
+    `max_cell_circumradius` or `max_radius_surface_delaunay_ball`.
+    """
+    extra_feature_edges = [] if extra_feature_edges is None else extra_feature_edges
+
+    if max_edge_size_at_feature_edges is None:
+        candidates = [max_cell_circumradius, max_radius_surface_delaunay_ball]
+        sizes = [c for c in candidates if callable(c) or c > 0.0]
+        if len(sizes) == 0:
+            raise ValueError(
+                "Need max_edge_size_at_feature_edges for the curves between blocks."
+            )
+        max_edge_size_at_feature_edges = sizes[0]
+
+    edge_size_value, edge_size_field = _select_sizing(max_edge_size_at_feature_edges)
+    facet_size_value, facet_size_field = _select_sizing(
+        max_radius_surface_delaunay_ball
+    )
+    distance_value, distance_field = _select_sizing(max_facet_distance)
+    cell_size_value, cell_size_field = _select_sizing(max_cell_circumradius)
+
+    data = _generate_mesh_partitioned(
+        domain,
+        bounding_cuboid,
+        list(num_blocks),
+        extra_feature_edges=extra_feature_edges,
+        lloyd=lloyd,
+        odt=odt,
+        perturb=perturb,
+        exude=exude,
+        min_edge_size_at_feature_edges=min_edge_size_at_feature_edges,
+        max_edge_size_at_feature_edges_value=edge_size_value,
+        max_edge_size_at_feature_edges_field=edge_size_field,
+        min_facet_angle=min_facet_angle,
+        max_radius_surface_delaunay_ball_value=facet_size_value,
+        max_radius_surface_delaunay_ball_field=facet_size_field,
+        max_facet_distance_value=distance_value,
+        max_facet_distance_field=distance_field,
+        max_circumradius_edge_ratio=max_circumradius_edge_ratio,
+        max_cell_circumradius_value=cell_size_value,
+        max_cell_circumradius_field=cell_size_field,
+        exude_time_limit=exude_time_limit,
+        exude_sliver_bound=exude_sliver_bound,
+        verbose=verbose,
+        seed=seed,
+        num_workers=_get_num_threads(False, max_workers),
+    )
+    return _to_meshio(data)
 
 
 def generate_2d(
@@ -179,44 +522,43 @@ def generate_periodic_mesh(
     perturb: bool = True,
     exude: bool = True,
     manifold: bool = False,
-    max_edge_size_at_feature_edges: float = 0.0,
+    max_edge_size_at_feature_edges: float | Callable[..., float] = 0.0,
     min_facet_angle: float = 0.0,
-    max_radius_surface_delaunay_ball: float = 0.0,
-    max_facet_distance: float = 0.0,
+    max_radius_surface_delaunay_ball: float | Callable[..., float] = 0.0,
+    max_facet_distance: float | Callable[..., float] = 0.0,
     max_circumradius_edge_ratio: float = 0.0,
-    max_cell_circumradius: float = 0.0,
+    max_cell_circumradius: float | Callable[..., float] = 0.0,
     number_of_copies_in_output: int = 1,
     verbose: bool = True,
     seed: int = 0,
 ):
-    fh, outfile = tempfile.mkstemp(suffix=".mesh")
-    os.close(fh)
-
+    """The sizes may be sizing fields as in `generate_mesh()`. They are evaluated in
+    and around the bounding cuboid, which is the period.
+    """
     assert number_of_copies_in_output in [1, 2, 4, 8]
 
-    _generate_periodic_mesh(
-        domain,
-        outfile,
-        bounding_cuboid,
+    options = _meshing_options(
         lloyd=lloyd,
         odt=odt,
         perturb=perturb,
         exude=exude,
-        manifold=manifold,
         max_edge_size_at_feature_edges=max_edge_size_at_feature_edges,
         min_facet_angle=min_facet_angle,
         max_radius_surface_delaunay_ball=max_radius_surface_delaunay_ball,
         max_facet_distance=max_facet_distance,
         max_circumradius_edge_ratio=max_circumradius_edge_ratio,
         max_cell_circumradius=max_cell_circumradius,
-        number_of_copies_in_output=number_of_copies_in_output,
         verbose=verbose,
         seed=seed,
     )
-
-    mesh = meshio.read(outfile)
-    os.remove(outfile)
-    return mesh
+    data = _generate_periodic_mesh_with_sizing_fields(
+        domain,
+        bounding_cuboid,
+        options,
+        manifold=manifold,
+        number_of_copies_in_output=number_of_copies_in_output,
+    )
+    return _to_meshio(data)
 
 
 def generate_surface_mesh(
@@ -228,12 +570,8 @@ def generate_surface_mesh(
     verbose: bool = True,
     seed: int = 0,
 ):
-    fh, outfile = tempfile.mkstemp(suffix=".off")
-    os.close(fh)
-
-    _generate_surface_mesh(
+    data = _generate_surface_mesh(
         domain,
-        outfile,
         bounding_sphere_radius=bounding_sphere_radius,
         min_facet_angle=min_facet_angle,
         max_radius_surface_delaunay_ball=max_radius_surface_delaunay_ball,
@@ -241,42 +579,35 @@ def generate_surface_mesh(
         verbose=verbose,
         seed=seed,
     )
-
-    mesh = meshio.read(outfile)
-    os.remove(outfile)
-    return mesh
+    return _to_meshio(data)
 
 
 def generate_volume_mesh_from_surface_mesh(
-    filename: str,
+    filename: str | meshio.Mesh,
     lloyd: bool = False,
     odt: bool = False,
     perturb: bool = True,
     exude: bool = True,
-    max_edge_size_at_feature_edges: float = 0.0,
+    max_edge_size_at_feature_edges: float | Callable[..., float] = 0.0,
     min_facet_angle: float = 0.0,
-    max_radius_surface_delaunay_ball: float = 0.0,
-    max_facet_distance: float = 0.0,
+    max_radius_surface_delaunay_ball: float | Callable[..., float] = 0.0,
+    max_facet_distance: float | Callable[..., float] = 0.0,
     max_circumradius_edge_ratio: float = 0.0,
-    max_cell_circumradius: float = 0.0,
+    max_cell_circumradius: float | Callable[..., float] = 0.0,
     exude_time_limit: float = 0.0,
     exude_sliver_bound: float = 0.0,
     verbose: bool = True,
     reorient: bool = False,
     seed: int = 0,
+    parallel: bool = False,
+    num_threads: int | None = None,
+    lazy: bool = False,
 ):
-    mesh = meshio.read(filename)
-
-    fh, off_file = tempfile.mkstemp(suffix=".off")
-    os.close(fh)
-    meshio.write(off_file, mesh)
-
-    fh, outfile = tempfile.mkstemp(suffix=".mesh")
-    os.close(fh)
-
-    _generate_from_off(
-        off_file,
-        outfile,
+    """Meshes the volume bounded by a closed triangle surface mesh. The sizes may be
+    sizing fields as in `generate_mesh()`.
+    """
+    vertices, faces = _surface_arrays(filename)
+    options = _meshing_options(
         lloyd=lloyd,
         odt=odt,
         perturb=perturb,
@@ -290,14 +621,13 @@ def generate_volume_mesh_from_surface_mesh(
         exude_time_limit=exude_time_limit,
         exude_sliver_bound=exude_sliver_bound,
         verbose=verbose,
-        reorient=reorient,
         seed=seed,
+        num_threads=_get_num_threads(parallel, num_threads),
     )
-
-    mesh = meshio.read(outfile)
-    os.remove(off_file)
-    os.remove(outfile)
-    return mesh
+    result = _generate_from_off_with_sizing_fields(
+        vertices, faces, options, reorient=reorient
+    )
+    return _from_result(result, lazy)
 
 
 def generate_from_inr(
@@ -306,24 +636,31 @@ def generate_from_inr(
     odt: bool = False,
     perturb: bool = True,
     exude: bool = True,
-    max_edge_size_at_feature_edges: float = 0.0,
+    max_edge_size_at_feature_edges: float | Callable[..., float] = 0.0,
     min_facet_angle: float = 0.0,
-    max_radius_surface_delaunay_ball: float = 0.0,
-    max_facet_distance: float = 0.0,
+    max_radius_surface_delaunay_ball: float | Callable[..., float] = 0.0,
+    max_facet_distance: float | Callable[..., float] = 0.0,
     max_circumradius_edge_ratio: float = 0.0,
-    max_cell_circumradius: float | dict[int | str, float] = 0.0,
+    max_cell_circumradius: float
+    | dict[int | str, float]
+    | Callable[..., float] = 0.0,
     exude_time_limit: float = 0.0,
     exude_sliver_bound: float = 0.0,
     verbose: bool = True,
     seed: int = 0,
+    parallel: bool = False,
+    num_threads: int | None = None,
+    lazy: bool = False,
 ):
-    fh, outfile = tempfile.mkstemp(suffix=".mesh")
-    os.close(fh)
-
-    if isinstance(max_cell_circumradius, float):
-        _generate_from_inr(
+    """Meshes the labeled image in an INR file. The sizes may be sizing fields as in
+    `generate_mesh()`, e.g., a `MeshSizingField` with the sizes at the vertices of a
+    previous mesh. `max_cell_circumradius` may also be a dictionary of sizes per
+    subdomain label with an optional "default"; the other sizes must be numbers then.
+    """
+    if isinstance(max_cell_circumradius, dict):
+        result = _generate_from_inr_with_subdomain_sizing(
             inr_filename,
-            outfile,
+            *_split_subdomain_sizing(max_cell_circumradius),
             lloyd=lloyd,
             odt=odt,
             perturb=perturb,
@@ -333,28 +670,12 @@ def generate_from_inr(
             max_radius_surface_delaunay_ball=max_radius_surface_delaunay_ball,
             max_facet_distance=max_facet_distance,
             max_circumradius_edge_ratio=max_circumradius_edge_ratio,
-            max_cell_circumradius=max_cell_circumradius,
-            exude_time_limit=exude_time_limit,
-            exude_sliver_bound=exude_sliver_bound,
             verbose=verbose,
             seed=seed,
+            num_threads=_get_num_threads(parallel, num_threads),
         )
     else:
-        assert isinstance(max_cell_circumradius, dict)
-        if "default" in max_cell_circumradius.keys():
-            default_max_cell_circumradius = max_cell_circumradius.pop("default")
-        else:
-            default_max_cell_circumradius = 0.0
-
-        max_cell_circumradiuss = list(max_cell_circumradius.values())
-        subdomain_labels = list(max_cell_circumradius.keys())
-
-        _generate_from_inr_with_subdomain_sizing(
-            inr_filename,
-            outfile,
-            default_max_cell_circumradius,
-            max_cell_circumradiuss,
-            subdomain_labels,
+        options = _meshing_options(
             lloyd=lloyd,
             odt=odt,
             perturb=perturb,
@@ -364,36 +685,33 @@ def generate_from_inr(
             max_radius_surface_delaunay_ball=max_radius_surface_delaunay_ball,
             max_facet_distance=max_facet_distance,
             max_circumradius_edge_ratio=max_circumradius_edge_ratio,
+            max_cell_circumradius=max_cell_circumradius,
+            exude_time_limit=exude_time_limit,
+            exude_sliver_bound=exude_sliver_bound,
             verbose=verbose,
             seed=seed,
+            num_threads=_get_num_threads(parallel, num_threads),
         )
+        result = _generate_from_inr_with_sizing_fields(inr_filename, options)
 
-    mesh = meshio.read(outfile)
-    os.remove(outfile)
-    return mesh
+    return _from_result(result, lazy)
 
 
 def remesh_surface(
-    filename: str,
-    max_edge_size_at_feature_edges: float = 0.0,
+    filename: str | meshio.Mesh,
+    max_edge_size_at_feature_edges: float | Callable[..., float] = 0.0,
     min_facet_angle: float = 0.0,
-    max_radius_surface_delaunay_ball: float = 0.0,
-    max_facet_distance: float = 0.0,
+    max_radius_surface_delaunay_ball: float | Callable[..., float] = 0.0,
+    max_facet_distance: float | Callable[..., float] = 0.0,
     verbose: bool = True,
     seed: int = 0,
+    lazy: bool = False,
 ):
-    mesh = meshio.read(filename)
-
-    fh, off_file = tempfile.mkstemp(suffix=".off")
-    os.close(fh)
-    meshio.write(off_file, mesh)
-
-    fh, outfile = tempfile.mkstemp(suffix=".off")
-    os.close(fh)
-
-    _remesh_surface(
-        off_file,
-        outfile,
+    """Remeshes a triangle surface mesh. The sizes may be sizing fields as in
+    `generate_mesh()`.
+    """
+    vertices, faces = _surface_arrays(filename)
+    options = _meshing_options(
         max_edge_size_at_feature_edges=max_edge_size_at_feature_edges,
         min_facet_angle=min_facet_angle,
         max_radius_surface_delaunay_ball=max_radius_surface_delaunay_ball,
@@ -401,11 +719,8 @@ def remesh_surface(
         verbose=verbose,
         seed=seed,
     )
-
-    mesh = meshio.read(outfile)
-    os.remove(off_file)
-    os.remove(outfile)
-    return mesh
+    result = _remesh_surface_with_sizing_fields(vertices, faces, options)
+    return _from_result(result, lazy)
 
 
 def save_inr(vol, voxel_size: tuple[float, float, float], fname: str):
@@ -465,25 +780,201 @@ def generate_from_array(
     max_circumradius_edge_ratio: float = 0.0,
     verbose: bool = True,
     seed: int = 0,
+    parallel: bool = False,
+    num_threads: int | None = None,
+    origin: tuple[float, float, float] = (0.0, 0.0, 0.0),
+    lazy: bool = False,
 ):
-    assert vol.dtype in ["uint8", "uint16"]
-    fh, inr_filename = tempfile.mkstemp(suffix=".inr")
-    os.close(fh)
-    save_inr(vol, voxel_size, inr_filename)
-    mesh = generate_from_inr(
-        inr_filename,
-        lloyd,
-        odt,
-        perturb,
-        exude,
-        max_edge_size_at_feature_edges,
-        min_facet_angle,
-        max_radius_surface_delaunay_ball,
-        max_facet_distance,
-        max_circumradius_edge_ratio,
-        max_cell_circumradius,
-        verbose,
-        seed,
+    """Meshes a 3D label volume. The mesher reads the memory of `vol` directly; only
+    arrays that are neither C- nor Fortran-contiguous or not in native byte order are
+    copied first.
+    """
+    assert vol.dtype in ["uint8", "uint16", "float32", "float64"]
+    if not vol.dtype.isnative:
+        vol = vol.astype(vol.dtype.newbyteorder("="))
+    if not (vol.flags.f_contiguous or vol.flags.c_contiguous):
+        vol = np.asfortranarray(vol)
+    # holds a reference to vol
+    image = _ImageArray(vol, voxel_size, origin)
+
+    kwargs = dict(
+        lloyd=lloyd,
+        odt=odt,
+        perturb=perturb,
+        exude=exude,
+        max_edge_size_at_feature_edges=max_edge_size_at_feature_edges,
+        min_facet_angle=min_facet_angle,
+        max_radius_surface_delaunay_ball=max_radius_surface_delaunay_ball,
+        max_facet_distance=max_facet_distance,
+        max_circumradius_edge_ratio=max_circumradius_edge_ratio,
+        verbose=verbose,
+        seed=seed,
+        num_threads=_get_num_threads(parallel, num_threads),
+    )
+    if isinstance(max_cell_circumradius, dict):
+        result = _generate_from_array_with_subdomain_sizing(
+            image, *_split_subdomain_sizing(max_cell_circumradius), **kwargs
+        )
+    else:
+        result = _generate_from_array(
+            image, max_cell_circumradius=float(max_cell_circumradius), **kwargs
+        )
+    return _from_result(result, lazy)
+
+
+def refine_existing(
+    mesh: MeshResult,
+    lloyd: bool = False,
+    odt: bool = False,
+    perturb: bool = True,
+    exude: bool = True,
+    min_edge_size_at_feature_edges: float = 0.0,
+    max_edge_size_at_feature_edges: float | Callable[..., float] = np.finfo(float).max,
+    min_facet_angle: float = 0.0,
+    max_radius_surface_delaunay_ball: float | Callable[..., float] = 0.0,
+    max_facet_distance: float | Callable[..., float] = 0.0,
+    max_circumradius_edge_ratio: float = 0.0,
+    max_cell_circumradius: float | Callable[..., float] = 0.0,
+    exude_time_limit: float = 0.0,
+    exude_sliver_bound: float = 0.0,
+    verbose: bool = True,
+    seed: int = 0,
+    num_threads: int | None = None,
+    lazy: bool = False,
+    deadline: float | None = None,
+    max_vertices: int | None = None,
+    progress: Callable[[str, int, int], None] | None = None,
+    progress_interval: float = 1.0,
+    cancel_token: CancelToken | None = None,
+):
+    """Refines a mesh of `generate_mesh(..., lazy=True)` or
+    `generate_from_inr(..., lazy=True)`, or one restored with `load_mesh()` or
+    `load_mesh_from_inr()`, with new criteria. The existing points are kept and
+    CGAL's refine_mesh_3 inserts new ones until the criteria are met, followed by the
+    optimization steps; see `generate_mesh()` for the parameters. The mesh is modified
+    in place.
+
+    The sizes per subdomain of an image mesh do not carry over. `num_threads` only
+    applies to meshes that were generated in parallel and defaults to all cores. A
+    refinement stopped by the budgets, the cancel token or Ctrl-C leaves a valid mesh
+    with the points inserted so far.
+    """
+    options = _meshing_options(
+        lloyd=lloyd,
+        odt=odt,
+        perturb=perturb,
+        exude=exude,
+        min_edge_size_at_feature_edges=min_edge_size_at_feature_edges,
+        max_edge_size_at_feature_edges=max_edge_size_at_feature_edges,
+        min_facet_angle=min_facet_angle,
+        max_radius_surface_delaunay_ball=max_radius_surface_delaunay_ball,
+        max_facet_distance=max_facet_distance,
+        max_circumradius_edge_ratio=max_circumradius_edge_ratio,
+        max_cell_circumradius=max_cell_circumradius,
+        exude_time_limit=exude_time_limit,
+        exude_sliver_bound=exude_sliver_bound,
+        verbose=verbose,
+        seed=seed,
+        num_threads=_get_num_threads(False, num_threads),
+    )
+    control = _control(
+        deadline, max_vertices, cancel_token, progress, progress_interval
+    )
+    if control is None:
+        mesh._refine(options)
+    else:
+        _warn_if_incomplete(mesh._refine_watched(options, **control))
+    return _from_result(mesh, lazy)
+
+
+def load_mesh(
+    filename: str,
+    domain,
+    extra_feature_edges: list | None = None,
+    bounding_sphere_radius: float = 0.0,
+    bounding_cuboid: list[float] | None = None,
+    parallel: bool = False,
+    num_threads: int | None = None,
+) -> MeshResult:
+    """Restores a mesh of `generate_mesh()` from a file written by
+    `MeshResult.save()`, e.g., to refine it further with `refine_existing()`. The
+    domain, its features and bounds must be the ones the mesh was generated with, and
+    `parallel` must match as well.
+    """
+    extra_feature_edges = [] if extra_feature_edges is None else extra_feature_edges
+    kwargs = dict(
+        extra_feature_edges=extra_feature_edges,
+        num_threads=_get_num_threads(parallel, num_threads),
+    )
+    if bounding_cuboid is not None:
+        kwargs["bounding_cuboid"] = bounding_cuboid
+    else:
+        kwargs["bounding_sphere_radius"] = bounding_sphere_radius
+    return _load_mesh(str(filename), domain, **kwargs)
+
+
+def load_mesh_from_inr(
+    filename: str,
+    inr_filename: str,
+    parallel: bool = False,
+    num_threads: int | None = None,
+) -> MeshResult:
+    """Restores a mesh of `generate_from_inr()` from a file written by
+    `MeshResult.save()`. The image and `parallel` must be the ones the mesh was
+    generated with.
+    """
+    return _load_mesh_from_inr(
+        str(filename),
+        str(inr_filename),
+        num_threads=_get_num_threads(parallel, num_threads),
+    )
+
+
+def _join(blocks: list, empty: np.ndarray) -> np.ndarray:
+    # a single block is passed on as is
+    if len(blocks) == 0:
+        return empty
+    return blocks[0] if len(blocks) == 1 else np.concatenate(blocks)
+
+
+def write(filename, mesh: meshio.Mesh | MeshResult):
+    """Writes a mesh to a file. medit .meshb and VTK XML .vtu files with triangle,
+    tetra, and line cells are written in binary by pygalmesh, straight from the arrays
+    of the mesh; everything else goes to meshio.write. A `MeshResult` is streamed into
+    .meshb and .vtu files chunk by chunk without building the arrays first.
+    """
+    suffix = pathlib.Path(filename).suffix
+    if isinstance(mesh, MeshResult):
+        if suffix == ".meshb":
+            mesh.write_meshb(str(filename))
+            return
+        if suffix == ".vtu":
+            mesh.write_vtu(str(filename))
+            return
+        mesh = _to_meshio(mesh.arrays())
+
+    writer = {".meshb": _write_meshb, ".vtu": _write_vtu}.get(suffix)
+    cell_types = {"triangle": 3, "tetra": 4, "line": 2}
+    if writer is None or any(c.type not in cell_types for c in mesh.cells):
+        meshio.write(filename, mesh)
+        return
+
+    refs = mesh.cell_data.get("medit:ref")
+    arrays = {}
+    for cell_type, nodes in cell_types.items():
+        idx = [k for k, c in enumerate(mesh.cells) if c.type == cell_type]
+        cells = [mesh.cells[k].data for k in idx]
+        labels = [] if refs is None else [refs[k] for k in idx]
+        arrays[cell_type] = _join(cells, np.empty((0, nodes), dtype=np.intc))
+        arrays[cell_type + "_labels"] = _join(labels, np.empty(0, dtype=np.intc))
+
+    writer(
+        str(filename),
+        mesh.points,
+        tetra=arrays["tetra"],
+        tetra_subdomain=arrays["tetra_labels"],
+        triangle=arrays["triangle"],
+        triangle_patch=arrays["triangle_labels"],
+        line=arrays["line"],
+        line_curve=arrays["line_labels"],
     )
-    os.remove(inr_filename)
-    return mesh
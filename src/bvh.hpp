@@ -0,0 +1,278 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace pygalmesh {
+
+// Axis-aligned box {lower corner, upper corner}. Domains return boxes that contain all
+// points at which they are negative; unbounded directions are infinite.
+using BoundingBox = std::array<std::array<double, 3>, 2>;
+
+inline
+BoundingBox
+infinite_box()
+{
+  const double inf = std::numeric_limits<double>::infinity();
+  return {{{-inf, -inf, -inf}, {inf, inf, inf}}};
+}
+
+inline
+bool
+is_finite(const BoundingBox & box)
+{
+  for (int i = 0; i < 3; i++) {
+    if (!std::isfinite(box[0][i]) || !std::isfinite(box[1][i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline
+bool
+contains(const BoundingBox & box, const std::array<double, 3> & x)
+{
+  return
+    box[0][0] <= x[0] && x[0] <= box[1][0] &&
+    box[0][1] <= x[1] && x[1] <= box[1][1] &&
+    box[0][2] <= x[2] && x[2] <= box[1][2];
+}
+
+inline
+BoundingBox
+merge(const BoundingBox & a, const BoundingBox & b)
+{
+  BoundingBox box;
+  for (int i = 0; i < 3; i++) {
+    box[0][i] = std::min(a[0][i], b[0][i]);
+    box[1][i] = std::max(a[1][i], b[1][i]);
+  }
+  return box;
+}
+
+inline
+BoundingBox
+intersect(const BoundingBox & a, const BoundingBox & b)
+{
+  BoundingBox box;
+  for (int i = 0; i < 3; i++) {
+    box[0][i] = std::max(a[0][i], b[0][i]);
+    box[1][i] = std::min(a[1][i], b[1][i]);
+  }
+  return box;
+}
+
+// Euclidean distance from x to the box, 0 inside
+inline
+double
+distance(const BoundingBox & box, const std::array<double, 3> & x)
+{
+  double d2 = 0.0;
+  for (int i = 0; i < 3; i++) {
+    const double d = std::max({box[0][i] - x[i], 0.0, x[i] - box[1][i]});
+    d2 += d * d;
+  }
+  return std::sqrt(d2);
+}
+
+// Bounds of the image of a finite box under the map f, taken over its eight corners.
+// Exact for affine maps.
+template <typename F>
+BoundingBox
+transform_box(const BoundingBox & box, const F & f)
+{
+  if (!is_finite(box)) {
+    return infinite_box();
+  }
+  const double inf = std::numeric_limits<double>::infinity();
+  BoundingBox out = {{{inf, inf, inf}, {-inf, -inf, -inf}}};
+  for (int k = 0; k < 8; k++) {
+    const std::array<double, 3> corner = f({
+        box[k & 1][0],
+        box[(k >> 1) & 1][1],
+        box[(k >> 2) & 1][2]
+        });
+    for (int i = 0; i < 3; i++) {
+      out[0][i] = std::min(out[0][i], corner[i]);
+      out[1][i] = std::max(out[1][i], corner[i]);
+    }
+  }
+  return out;
+}
+
+// A bounding volume hierarchy over a set of boxes, split at the median of the box
+// centers along the longest axis. Unbounded boxes are kept out of the tree and always
+// reported.
+class BoundingVolumeHierarchy
+{
+  public:
+  explicit BoundingVolumeHierarchy(const std::vector<BoundingBox> & boxes)
+  {
+    for (size_t k = 0; k < boxes.size(); k++) {
+      if (is_finite(boxes[k])) {
+        indices_.push_back(k);
+      } else {
+        unbounded_.push_back(k);
+      }
+    }
+    if (!indices_.empty()) {
+      nodes_.resize(1);
+      build(boxes, 0, 0, indices_.size());
+    }
+    for (const auto k: indices_) {
+      boxes_.push_back(boxes[k]);
+    }
+  }
+
+  // Calls f(k) for all boxes k that contain x until f returns true. Returns whether it
+  // was stopped.
+  template <typename F>
+  bool
+  visit(const std::array<double, 3> & x, const F & f) const
+  {
+    for (const auto k: unbounded_) {
+      if (f(k)) {
+        return true;
+      }
+    }
+    if (nodes_.empty()) {
+      return false;
+    }
+    // The tree is balanced, so the depth is logarithmic in the number of boxes.
+    size_t stack[64];
+    size_t top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+      const Node & node = nodes_[stack[--top]];
+      if (!contains(node.box, x)) {
+        continue;
+      }
+      if (node.count > 0) {
+        for (size_t j = node.first; j < node.first + node.count; j++) {
+          if (contains(boxes_[j], x) && f(indices_[j])) {
+            return true;
+          }
+        }
+      } else {
+        stack[top++] = node.first + 1;
+        stack[top++] = node.first;
+      }
+    }
+    return false;
+  }
+
+  // The smallest dist(k) over all boxes k, where dist(k) is the distance from x to
+  // something within box k. Boxes farther from x than the smallest distance so far are
+  // skipped, nearer subtrees are searched first. Infinity if there are no boxes.
+  template <typename F>
+  double
+  min_distance(const std::array<double, 3> & x, const F & dist) const
+  {
+    double best = std::numeric_limits<double>::infinity();
+    for (const auto k: unbounded_) {
+      best = std::min(best, dist(k));
+    }
+    if (nodes_.empty()) {
+      return best;
+    }
+    size_t stack[64];
+    size_t top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+      const Node & node = nodes_[stack[--top]];
+      if (distance(node.box, x) >= best) {
+        continue;
+      }
+      if (node.count > 0) {
+        for (size_t j = node.first; j < node.first + node.count; j++) {
+          if (distance(boxes_[j], x) < best) {
+            best = std::min(best, dist(indices_[j]));
+          }
+        }
+      } else {
+        const bool first_is_nearer =
+          distance(nodes_[node.first].box, x) <= distance(nodes_[node.first + 1].box, x);
+        stack[top++] = first_is_nearer ? node.first + 1 : node.first;
+        stack[top++] = first_is_nearer ? node.first : node.first + 1;
+      }
+    }
+    return best;
+  }
+
+  private:
+  struct Node {
+    BoundingBox box;
+    // leaves: the range [first, first + count) of indices_; inner nodes (count == 0):
+    // the children are nodes first and first + 1
+    size_t first;
+    size_t count;
+  };
+
+  void
+  build(
+      const std::vector<BoundingBox> & boxes,
+      const size_t index,
+      const size_t begin,
+      const size_t end
+      )
+  {
+    BoundingBox box = boxes[indices_[begin]];
+    for (size_t j = begin + 1; j < end; j++) {
+      box = merge(box, boxes[indices_[j]]);
+    }
+    if (end - begin <= leaf_size) {
+      nodes_[index] = {box, begin, end - begin};
+      return;
+    }
+
+    // longest axis of the box centers
+    const auto center = [&](const size_t k, const int i) {
+      return boxes[k][0][i] + boxes[k][1][i];
+    };
+    int axis = 0;
+    double max_extent = -1.0;
+    for (int i = 0; i < 3; i++) {
+      double lo = std::numeric_limits<double>::infinity();
+      double hi = -lo;
+      for (size_t j = begin; j < end; j++) {
+        lo = std::min(lo, center(indices_[j], i));
+        hi = std::max(hi, center(indices_[j], i));
+      }
+      if (hi - lo > max_extent) {
+        max_extent = hi - lo;
+        axis = i;
+      }
+    }
+
+    const size_t mid = begin + (end - begin) / 2;
+    std::nth_element(
+        indices_.begin() + begin, indices_.begin() + mid, indices_.begin() + end,
+        [&](const size_t a, const size_t b) {
+          return center(a, axis) < center(b, axis);
+        });
+
+    // children are stored next to each other
+    const size_t first = nodes_.size();
+    nodes_.resize(first + 2);
+    nodes_[index] = {box, first, 0};
+    build(boxes, first, begin, mid);
+    build(boxes, first + 1, mid, end);
+  }
+
+  private:
+    static constexpr size_t leaf_size = 4;
+    std::vector<size_t> indices_;
+    std::vector<size_t> unbounded_;
+    std::vector<BoundingBox> boxes_;
+    std::vector<Node> nodes_;
+};
+
+} // namespace pygalmesh
+
+#endif // BVH_HPP
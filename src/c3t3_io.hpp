@@ -0,0 +1,56 @@
+#ifndef C3T3_IO_HPP
+#define C3T3_IO_HPP
+
+// Saving and restoring Mesh_3 complexes in CGAL's binary format. The file starts with
+// a signature of the complex type, so it only loads into the same type, i.e., a mesh
+// of the same generator and concurrency mode.
+
+#include <CGAL/IO/File_binary_mesh_3.h>
+#include <CGAL/version_macros.h>
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace pygalmesh {
+
+template <typename C3t3>
+void
+save_c3t3(const std::string & filename, const C3t3 & c3t3)
+{
+  std::ofstream out(filename, std::ios::binary);
+#if CGAL_VERSION_MAJOR > 5 || (CGAL_VERSION_MAJOR >= 5 && CGAL_VERSION_MINOR >= 3)
+  const bool success = out && CGAL::IO::save_binary_file(out, c3t3);
+#else
+  const bool success = out && CGAL::Mesh_3::save_binary_file(out, c3t3);
+#endif
+  out.close();
+  if (!success || out.fail()) {
+    throw std::runtime_error("Could not write \"" + filename + "\".");
+  }
+}
+
+template <typename C3t3>
+void
+load_c3t3(const std::string & filename, C3t3 & c3t3)
+{
+  std::ifstream in(filename, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("Could not open \"" + filename + "\".");
+  }
+#if CGAL_VERSION_MAJOR > 5 || (CGAL_VERSION_MAJOR >= 5 && CGAL_VERSION_MINOR >= 3)
+  const bool success = CGAL::IO::load_binary_file(in, c3t3);
+#else
+  const bool success = CGAL::Mesh_3::load_binary_file(in, c3t3);
+#endif
+  if (!success) {
+    throw std::runtime_error(
+        "Could not load \"" + filename + "\". The mesh must have been saved from the "
+        "same kind of domain, in the same concurrency mode."
+        );
+  }
+}
+
+} // namespace pygalmesh
+
+#endif // C3T3_IO_HPP
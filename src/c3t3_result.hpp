@@ -0,0 +1,328 @@
+#ifndef C3T3_RESULT_HPP
+#define C3T3_RESULT_HPP
+
+// A MeshResult that keeps the Mesh_3 complex and reads the mesh off it on demand.
+// Besides the complex, it only stores the point numbering: the vertex handles in the
+// order of their numbers, and the vertex addresses sorted along with their numbers
+// for the reverse lookup, 24 bytes per point.
+
+#include "mesh_data.hpp"
+#include "mesh_result.hpp"
+
+#include <CGAL/number_utils.h>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace pygalmesh {
+
+// Points are all finite vertices, cells, facets and edges those in the complex, in
+// the order output_to_medit writes them. Facets are oriented such that their normals
+// point into the adjacent cell with the lower subdomain index, i.e., out of the domain
+// on its boundary.
+template <typename C3t3>
+class C3t3Result: public MeshResult
+{
+  typedef typename C3t3::Triangulation Tr;
+  typedef typename Tr::Vertex_handle Vertex_handle;
+
+  public:
+  // Takes over the complex, leaving c3t3 empty. A surface-only result consists of the
+  // facets in the complex and their vertices.
+  explicit C3t3Result(C3t3 & c3t3, const bool surface_only = false):
+    surface_only_(surface_only)
+  {
+    c3t3_.swap(c3t3);
+    number_vertices();
+  }
+
+  const C3t3 &
+  complex() const
+  {
+    return c3t3_;
+  }
+
+  // Swaps the x and z coordinates of the points. The cells and facets are flipped to
+  // keep their orientation.
+  void
+  swap_x_and_z()
+  {
+    swap_x_and_z_ = !swap_x_and_z_;
+  }
+
+  virtual
+  std::size_t
+  num_points() const
+  {
+    return vertices_.size();
+  }
+
+  virtual
+  void
+  copy_points(const std::size_t begin, const std::size_t end, double * out) const
+  {
+    for (std::size_t k = begin; k < end; k++) {
+      put_point(vertices_[k], out + 3 * (k - begin));
+    }
+  }
+
+  virtual
+  void
+  gather_points(const int * indices, const std::size_t n, double * out) const
+  {
+    for (std::size_t k = 0; k < n; k++) {
+      put_point(vertices_[indices[k]], out + 3 * k);
+    }
+  }
+
+  virtual
+  std::size_t
+  num_cells(const CellType type) const
+  {
+    switch (type) {
+      case CellType::tetra:
+        return surface_only_ ? 0 : c3t3_.number_of_cells_in_complex();
+      case CellType::triangle:
+        return c3t3_.number_of_facets_in_complex();
+      case CellType::line:
+        return surface_only_ ? 0 : c3t3_.number_of_edges_in_complex();
+    }
+    return 0;
+  }
+
+  virtual
+  bool
+  has_labels(const CellType) const
+  {
+    return true;
+  }
+
+  virtual
+  std::unique_ptr<CellCursor>
+  cells(const CellType type) const
+  {
+    switch (type) {
+      case CellType::tetra:
+        return std::make_unique<TetraCursor>(*this);
+      case CellType::triangle:
+        return std::make_unique<TriangleCursor>(*this);
+      case CellType::line:
+        return std::make_unique<LineCursor>(*this);
+    }
+    return nullptr;
+  }
+
+  protected:
+  // For modifying the complex; renumber_vertices() must be called afterwards.
+  C3t3 &
+  mutable_complex()
+  {
+    return c3t3_;
+  }
+
+  void
+  renumber_vertices()
+  {
+    vertices_.clear();
+    index_.clear();
+    number_vertices();
+  }
+
+  private:
+  static
+  const void *
+  address(const Vertex_handle & v)
+  {
+    return &*v;
+  }
+
+  void
+  number_vertices()
+  {
+    const Tr & tr = c3t3_.triangulation();
+    std::vector<const void *> used;
+    if (surface_only_) {
+      used.reserve(3 * c3t3_.number_of_facets_in_complex());
+      for (auto f = c3t3_.facets_in_complex_begin(); f != c3t3_.facets_in_complex_end(); ++f) {
+        for (int k = 0; k < 3; k++) {
+          used.push_back(address(f->first->vertex(Tr::vertex_triple_index(f->second, k))));
+        }
+      }
+      std::sort(used.begin(), used.end());
+      used.erase(std::unique(used.begin(), used.end()), used.end());
+    }
+
+    vertices_.reserve(surface_only_ ? used.size() : tr.number_of_vertices());
+    for (auto v = tr.finite_vertices_begin(); v != tr.finite_vertices_end(); ++v) {
+      if (!surface_only_ || std::binary_search(used.begin(), used.end(), address(v))) {
+        vertices_.push_back(v);
+      }
+    }
+    index_.reserve(vertices_.size());
+    for (std::size_t k = 0; k < vertices_.size(); k++) {
+      index_.emplace_back(address(vertices_[k]), int(k));
+    }
+    std::sort(index_.begin(), index_.end());
+  }
+
+  int
+  index(const Vertex_handle & v) const
+  {
+    const auto it = std::lower_bound(
+        index_.begin(), index_.end(), address(v),
+        [](const std::pair<const void *, int> & entry, const void * a) {
+          return entry.first < a;
+        });
+    return it->second;
+  }
+
+  void
+  put_point(const Vertex_handle & v, double * out) const
+  {
+    const auto & p = v->point();
+    out[0] = CGAL::to_double(p.x());
+    out[1] = CGAL::to_double(p.y());
+    out[2] = CGAL::to_double(p.z());
+    if (swap_x_and_z_) {
+      std::swap(out[0], out[2]);
+    }
+  }
+
+  class TetraCursor: public CellCursor
+  {
+    public:
+    explicit TetraCursor(const C3t3Result & result):
+      result_(result),
+      it_(result.c3t3_.cells_in_complex_begin()),
+      end_(result.c3t3_.cells_in_complex_end())
+    {
+      if (result.surface_only_) {
+        it_ = end_;
+      }
+    }
+
+    virtual
+    std::size_t
+    next(const std::size_t max_cells, int * nodes, int * labels)
+    {
+      std::size_t m = 0;
+      for (; m < max_cells && it_ != end_; ++m, ++it_) {
+        if (nodes) {
+          int * t = nodes + 4 * m;
+          for (int i = 0; i < 4; i++) {
+            t[i] = result_.index(it_->vertex(i));
+          }
+          if (result_.swap_x_and_z_) {
+            std::swap(t[0], t[1]);
+          }
+        }
+        if (labels) {
+          labels[m] = int(result_.c3t3_.subdomain_index(it_));
+        }
+      }
+      return m;
+    }
+
+    private:
+      const C3t3Result & result_;
+      typename C3t3::Cells_in_complex_iterator it_;
+      const typename C3t3::Cells_in_complex_iterator end_;
+  };
+
+  class TriangleCursor: public CellCursor
+  {
+    public:
+    explicit TriangleCursor(const C3t3Result & result):
+      result_(result),
+      it_(result.c3t3_.facets_in_complex_begin()),
+      end_(result.c3t3_.facets_in_complex_end())
+    {
+    }
+
+    virtual
+    std::size_t
+    next(const std::size_t max_cells, int * nodes, int * labels)
+    {
+      const C3t3 & c3t3 = result_.c3t3_;
+      std::size_t m = 0;
+      for (; m < max_cells && it_ != end_; ++m, ++it_) {
+        if (nodes) {
+          // The facet vertices are positively oriented w.r.t. the opposite vertex, so
+          // pick the cell with the lower subdomain index.
+          auto facet = *it_;
+          const auto mirror = c3t3.triangulation().mirror_facet(facet);
+          if (c3t3.subdomain_index(mirror.first) < c3t3.subdomain_index(facet.first)) {
+            facet = mirror;
+          }
+          int * t = nodes + 3 * m;
+          for (int k = 0; k < 3; k++) {
+            t[k] = result_.index(facet.first->vertex(Tr::vertex_triple_index(facet.second, k)));
+          }
+          if (result_.swap_x_and_z_) {
+            std::swap(t[1], t[2]);
+          }
+        }
+        if (labels) {
+          labels[m] = patch_number_(c3t3.surface_patch_index(*it_));
+        }
+      }
+      return m;
+    }
+
+    private:
+      const C3t3Result & result_;
+      typename C3t3::Facets_in_complex_iterator it_;
+      const typename C3t3::Facets_in_complex_iterator end_;
+      LabelNumbering<typename C3t3::Surface_patch_index> patch_number_;
+  };
+
+  class LineCursor: public CellCursor
+  {
+    public:
+    explicit LineCursor(const C3t3Result & result):
+      result_(result),
+      it_(result.c3t3_.edges_in_complex_begin()),
+      end_(result.c3t3_.edges_in_complex_end())
+    {
+      if (result.surface_only_) {
+        it_ = end_;
+      }
+    }
+
+    virtual
+    std::size_t
+    next(const std::size_t max_cells, int * nodes, int * labels)
+    {
+      std::size_t m = 0;
+      for (; m < max_cells && it_ != end_; ++m, ++it_) {
+        if (nodes) {
+          const auto & cell = it_->first;
+          nodes[2 * m] = result_.index(cell->vertex(it_->second));
+          nodes[2 * m + 1] = result_.index(cell->vertex(it_->third));
+        }
+        if (labels) {
+          labels[m] = int(result_.c3t3_.curve_index(*it_));
+        }
+      }
+      return m;
+    }
+
+    private:
+      const C3t3Result & result_;
+      typename C3t3::Edges_in_complex_iterator it_;
+      const typename C3t3::Edges_in_complex_iterator end_;
+  };
+
+  private:
+    C3t3 c3t3_;
+    const bool surface_only_;
+    bool swap_x_and_z_ = false;
+    std::vector<Vertex_handle> vertices_;
+    std::vector<std::pair<const void *, int>> index_;
+};
+
+} // namespace pygalmesh
+
+#endif // C3T3_RESULT_HPP
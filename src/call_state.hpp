@@ -0,0 +1,131 @@
+#ifndef CALL_STATE_HPP
+#define CALL_STATE_HPP
+
+// Per-call state of the generators.
+//
+// The generators used to silence output by setting the failbit of the global std::cerr
+// and std::cout, and to seed CGAL::get_default_random() without restoring it. Both leak
+// into other calls running concurrently in different threads. The guards below scope
+// these settings to the calling thread and the duration of the call.
+
+#include <CGAL/Random.h>
+
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+
+namespace pygalmesh {
+
+// whether output of the current thread is suppressed
+inline
+bool &
+is_quiet_thread()
+{
+  static thread_local bool quiet = false;
+  return quiet;
+}
+
+// A stream buffer that forwards to another one unless the writing thread is quiet.
+// It doesn't buffer, so it is as thread-safe as the buffer it forwards to.
+class QuietFilterBuffer: public std::streambuf
+{
+  public:
+  explicit QuietFilterBuffer(std::streambuf * target):
+    target_(target)
+  {
+  }
+
+  protected:
+  virtual
+  int_type
+  overflow(int_type c)
+  {
+    if (is_quiet_thread() || traits_type::eq_int_type(c, traits_type::eof())) {
+      return traits_type::not_eof(c);
+    }
+    return target_->sputc(traits_type::to_char_type(c));
+  }
+
+  virtual
+  std::streamsize
+  xsputn(const char * s, std::streamsize n)
+  {
+    return is_quiet_thread() ? n : target_->sputn(s, n);
+  }
+
+  virtual
+  int
+  sync()
+  {
+    return target_->pubsync();
+  }
+
+  private:
+    std::streambuf * target_;
+};
+
+// Suppresses everything the current thread writes to std::cout and std::cerr while in
+// scope; other threads are not affected. The filters are installed on first use.
+class QuietOutput
+{
+  public:
+  explicit QuietOutput(const bool quiet):
+    previous_(is_quiet_thread())
+  {
+    if (quiet) {
+      install();
+      is_quiet_thread() = true;
+    }
+  }
+
+  ~QuietOutput()
+  {
+    is_quiet_thread() = previous_;
+  }
+
+  QuietOutput(const QuietOutput &) = delete;
+  QuietOutput & operator=(const QuietOutput &) = delete;
+
+  private:
+  static
+  void
+  install()
+  {
+    static std::once_flag flag;
+    std::call_once(flag, []() {
+      // never destroyed, the streams may be used during static destruction
+      std::cout.rdbuf(new QuietFilterBuffer(std::cout.rdbuf()));
+      std::cerr.rdbuf(new QuietFilterBuffer(std::cerr.rdbuf()));
+    });
+  }
+
+  private:
+    const bool previous_;
+};
+
+// Seeds the default random generator of the current thread, which is what CGAL uses
+// internally, and restores the previous one when leaving the scope.
+class ScopedSeed
+{
+  public:
+  explicit ScopedSeed(const int seed):
+    previous_(CGAL::get_default_random())
+  {
+    CGAL::get_default_random() = CGAL::Random(seed);
+  }
+
+  ~ScopedSeed()
+  {
+    CGAL::get_default_random() = previous_;
+  }
+
+  ScopedSeed(const ScopedSeed &) = delete;
+  ScopedSeed & operator=(const ScopedSeed &) = delete;
+
+  private:
+    const CGAL::Random previous_;
+};
+
+} // namespace pygalmesh
+
+#endif // CALL_STATE_HPP
@@ -0,0 +1,495 @@
+#ifndef COMPILED_DOMAIN_HPP
+#define COMPILED_DOMAIN_HPP
+
+#include "domain.hpp"
+#include "primitives.hpp"
+
+#include <Eigen/Dense>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace pygalmesh {
+
+// A domain tree lowered to a flat instruction stream.
+//
+// Every query CGAL makes walks the DomainBase tree through virtual eval() calls and
+// shared_ptr hops. CompiledDomain lowers trees of the built-in operators and
+// primitives into a linear program that operates on a small register file; points
+// occupy three consecutive registers, function values one. All constants live in one
+// contiguous buffer. Nodes the compiler doesn't know about (e.g., domains implemented
+// in Python) are kept as opaque callouts to their own eval(). Large unions are called
+// out to as well, with their children compiled, so they keep their BVH.
+class CompiledDomain: public pygalmesh::DomainBase
+{
+  public:
+  enum class Opcode {
+    // point operations; dst and src are point registers
+    translate,
+    affine,
+    // primitives; dst is a value register, src a point register
+    ball,
+    cuboid,
+    ellipsoid,
+    cylinder,
+    cone,
+    tetrahedron,
+    convex_polyhedron,
+    torus,
+    half_space,
+    callout,
+    // value operations; dst and src are value registers
+    set,
+    min,
+    max,
+    difference,
+    // sign-only evaluation skips to `jump` if dst is nonnegative; no-op otherwise
+    skip_if_outside
+  };
+
+  struct Instruction {
+    Opcode op;
+    int dst;
+    int src;
+    // offset into the constants, or index of the callout
+    int arg;
+    // In sign-only evaluation, min, max and skip_if_outside continue at this
+    // instruction once their result is decided; -1 if there is nothing to skip.
+    int jump;
+  };
+
+  explicit CompiledDomain(
+      const std::shared_ptr<const pygalmesh::DomainBase> & domain
+      ):
+    domain_(domain),
+    num_registers_(0)
+  {
+    // The root point is passed in registers 0, 1, 2.
+    int next_register = 3;
+    result_register_ = lower(*domain_, 0, next_register);
+  }
+
+  virtual ~CompiledDomain() = default;
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    // Register files of typical trees are tiny; keep them on the stack. This also
+    // keeps eval() reentrant and thread-safe.
+    constexpr size_t stack_size = 64;
+    if (num_registers_ <= stack_size) {
+      double registers[stack_size];
+      return run<false>(x, registers);
+    }
+    std::vector<double> registers(num_registers_);
+    return run<false>(x, registers.data());
+  }
+
+  // Only the signs of intermediate values are tracked, so unions stop at the first
+  // child that contains x, intersections at the first that doesn't, and differences
+  // skip the subtrahend if x isn't in the minuend.
+  virtual
+  int
+  classify(const std::array<double, 3> & x) const
+  {
+    constexpr size_t stack_size = 64;
+    double val;
+    if (num_registers_ <= stack_size) {
+      double registers[stack_size];
+      val = run<true>(x, registers);
+    } else {
+      std::vector<double> registers(num_registers_);
+      val = run<true>(x, registers.data());
+    }
+    return val < 0.0 ? -1 : 1;
+  }
+
+  // The batched kernels of the tree already amortize the dispatch over many points.
+  virtual
+  void
+  eval_batch(
+      const double * x, const double * y, const double * z,
+      double * out,
+      const size_t n
+      ) const
+  {
+    domain_->eval_batch(x, y, z, out, n);
+  }
+
+  virtual
+  double
+  get_bounding_sphere_squared_radius() const
+  {
+    return domain_->get_bounding_sphere_squared_radius();
+  }
+
+  virtual
+  BoundingBox
+  get_bounding_box() const
+  {
+    return domain_->get_bounding_box();
+  }
+
+  virtual
+  Features
+  get_features() const
+  {
+    return domain_->get_features();
+  };
+
+  virtual
+  FeatureSet
+  get_feature_set() const
+  {
+    return domain_->get_feature_set();
+  }
+
+  size_t
+  num_instructions() const
+  {
+    return program_.size();
+  }
+
+  size_t
+  num_callouts() const
+  {
+    return callouts_.size();
+  }
+
+  private:
+  int
+  lower(
+      const pygalmesh::DomainBase & domain,
+      const int point,
+      int & next_register
+      )
+  {
+    // nested compiled domains are inlined
+    if (const auto d = dynamic_cast<const CompiledDomain*>(&domain)) {
+      return lower(*d->domain_, point, next_register);
+    }
+
+    // Chains of transformations are folded into one affine map. The child is evaluated
+    // at A^{-1} (x - b).
+    {
+      Eigen::Matrix3d A;
+      Eigen::Vector3d b;
+      std::shared_ptr<const pygalmesh::DomainBase> child;
+      if (Affine::get_chain_map(domain, A, b, child) > 0) {
+        const int p = allocate(next_register, 3);
+        if (A == Eigen::Matrix3d::Identity()) {
+          emit(Opcode::translate, p, point, {b[0], b[1], b[2]});
+        } else {
+          const Eigen::Matrix3d Ainv = Affine::invert(A);
+          const Eigen::Vector3d t = -Ainv * b;
+          emit(Opcode::affine, p, point, {
+              Ainv(0, 0), Ainv(0, 1), Ainv(0, 2), t[0],
+              Ainv(1, 0), Ainv(1, 1), Ainv(1, 2), t[1],
+              Ainv(2, 0), Ainv(2, 1), Ainv(2, 2), t[2]
+              });
+        }
+        return lower(*child, p, next_register);
+      }
+    }
+
+    // Boolean operations
+    if (const auto d = dynamic_cast<const Intersection*>(&domain)) {
+      return lower_reduction(Opcode::max, std::numeric_limits<double>::lowest(), d->domains_, point, next_register);
+    }
+    if (const auto d = dynamic_cast<const Union*>(&domain)) {
+      // Large unions keep their BVH; their children are compiled one by one.
+      if (d->bvh_) {
+        std::vector<std::shared_ptr<const pygalmesh::DomainBase>> children;
+        for (const auto & child: d->domains_) {
+          children.push_back(std::make_shared<const CompiledDomain>(child));
+        }
+        unions_.push_back(std::make_shared<const Union>(children));
+        return lower_callout(*unions_.back(), point, next_register);
+      }
+      return lower_reduction(Opcode::min, std::numeric_limits<double>::max(), d->domains_, point, next_register);
+    }
+    if (const auto d = dynamic_cast<const Difference*>(&domain)) {
+      const int val = lower(*d->domain0_, point, next_register);
+      const size_t skip = program_.size();
+      program_.push_back({Opcode::skip_if_outside, val, -1, -1, -1});
+      const int watermark = next_register;
+      const int val1 = lower(*d->domain1_, point, next_register);
+      program_.push_back({Opcode::difference, val, val1, -1, -1});
+      program_[skip].jump = int(program_.size());
+      next_register = watermark;
+      return val;
+    }
+
+    // primitives
+    if (const auto d = dynamic_cast<const Ball*>(&domain)) {
+      return emit_primitive(Opcode::ball, point, next_register, {
+          d->x0_[0], d->x0_[1], d->x0_[2], d->radius_*d->radius_
+          });
+    }
+    if (const auto d = dynamic_cast<const Cuboid*>(&domain)) {
+      return emit_primitive(Opcode::cuboid, point, next_register, {
+          d->x0_[0], d->x0_[1], d->x0_[2], d->x1_[0], d->x1_[1], d->x1_[2]
+          });
+    }
+    if (const auto d = dynamic_cast<const Ellipsoid*>(&domain)) {
+      return emit_primitive(Opcode::ellipsoid, point, next_register, {
+          d->x0_[0], d->x0_[1], d->x0_[2], d->a0_2_, d->a1_2_, d->a2_2_
+          });
+    }
+    if (const auto d = dynamic_cast<const Cylinder*>(&domain)) {
+      return emit_primitive(Opcode::cylinder, point, next_register, {
+          d->z0_, d->z1_, d->radius_*d->radius_
+          });
+    }
+    if (const auto d = dynamic_cast<const Cone*>(&domain)) {
+      return emit_primitive(Opcode::cone, point, next_register, {
+          d->radius_, d->height_
+          });
+    }
+    if (const auto d = dynamic_cast<const Tetrahedron*>(&domain)) {
+      // barycentric coordinates are Ainv * [x, 1]
+      std::vector<double> constants;
+      for (const auto & row: d->Ainv_) {
+        constants.insert(constants.end(), row.begin(), row.end());
+      }
+      return emit_primitive(Opcode::tetrahedron, point, next_register, constants);
+    }
+    if (const auto d = dynamic_cast<const ConvexPolyhedron*>(&domain)) {
+      // the number of planes, then the planes
+      std::vector<double> constants = {double(d->planes_.size())};
+      for (const auto & plane: d->planes_) {
+        constants.insert(constants.end(), plane.begin(), plane.end());
+      }
+      return emit_primitive(Opcode::convex_polyhedron, point, next_register, constants);
+    }
+    if (const auto d = dynamic_cast<const Torus*>(&domain)) {
+      return emit_primitive(Opcode::torus, point, next_register, {
+          d->major_radius_, d->minor_radius_*d->minor_radius_
+          });
+    }
+    if (const auto d = dynamic_cast<const HalfSpace*>(&domain)) {
+      return emit_primitive(Opcode::half_space, point, next_register, {
+          d->n_[0], d->n_[1], d->n_[2], d->alpha_
+          });
+    }
+
+    // Anything else is evaluated through its own eval().
+    return lower_callout(domain, point, next_register);
+  }
+
+  // Keeps a non-owning pointer; the node is kept alive by domain_.
+  int
+  lower_callout(
+      const pygalmesh::DomainBase & domain,
+      const int point,
+      int & next_register
+      )
+  {
+    const int val = allocate(next_register, 1);
+    program_.push_back({Opcode::callout, val, point, int(callouts_.size()), -1});
+    callouts_.push_back(&domain);
+    return val;
+  }
+
+  int
+  lower_reduction(
+      const Opcode op,
+      const double initial_value,
+      const std::vector<std::shared_ptr<const pygalmesh::DomainBase>> & domains,
+      const int point,
+      int & next_register
+      )
+  {
+    const int val = allocate(next_register, 1);
+    emit(Opcode::set, val, -1, {initial_value});
+    // the registers of the children are reused
+    const int watermark = next_register;
+    std::vector<size_t> accumulations;
+    for (const auto & domain: domains) {
+      const int child = lower(*domain, point, next_register);
+      accumulations.push_back(program_.size());
+      program_.push_back({op, val, child, -1, -1});
+      next_register = watermark;
+    }
+    // once decided, skip the remaining children
+    for (const auto k: accumulations) {
+      program_[k].jump = int(program_.size());
+    }
+    return val;
+  }
+
+  int
+  allocate(int & next_register, const int size)
+  {
+    const int reg = next_register;
+    next_register += size;
+    num_registers_ = std::max(num_registers_, size_t(next_register));
+    return reg;
+  }
+
+  void
+  emit(
+      const Opcode op,
+      const int dst,
+      const int src,
+      const std::vector<double> & constants
+      )
+  {
+    program_.push_back({op, dst, src, int(constants_.size()), -1});
+    constants_.insert(constants_.end(), constants.begin(), constants.end());
+  }
+
+  int
+  emit_primitive(
+      const Opcode op,
+      const int point,
+      int & next_register,
+      const std::vector<double> & constants
+      )
+  {
+    const int val = allocate(next_register, 1);
+    emit(op, val, point, constants);
+    return val;
+  }
+
+  // With sign_only, values are only correct up to their sign, and callouts go through
+  // classify().
+  template <bool sign_only>
+  double
+  run(const std::array<double, 3> & x, double * r) const
+  {
+    r[0] = x[0];
+    r[1] = x[1];
+    r[2] = x[2];
+    const double * c0 = constants_.data();
+    const size_t size = program_.size();
+    for (size_t pc = 0; pc < size; pc++) {
+      const auto & ins = program_[pc];
+      const double * c = c0 + ins.arg;
+      const double * p = r + ins.src;
+      double * q = r + ins.dst;
+      switch (ins.op) {
+        case Opcode::translate:
+          q[0] = p[0] - c[0];
+          q[1] = p[1] - c[1];
+          q[2] = p[2] - c[2];
+          break;
+        case Opcode::affine:
+          q[0] = c[0]*p[0] + c[1]*p[1] + c[2]*p[2] + c[3];
+          q[1] = c[4]*p[0] + c[5]*p[1] + c[6]*p[2] + c[7];
+          q[2] = c[8]*p[0] + c[9]*p[1] + c[10]*p[2] + c[11];
+          break;
+        case Opcode::ball:
+          {
+            const double xx0 = p[0] - c[0];
+            const double yy0 = p[1] - c[1];
+            const double zz0 = p[2] - c[2];
+            *q = xx0*xx0 + yy0*yy0 + zz0*zz0 - c[3];
+          }
+          break;
+        case Opcode::cuboid:
+          *q = std::max(std::max(
+              (p[0] - c[0]) * (p[0] - c[3]),
+              (p[1] - c[1]) * (p[1] - c[4])
+              ),
+              (p[2] - c[2]) * (p[2] - c[5])
+              );
+          break;
+        case Opcode::ellipsoid:
+          {
+            const double xx0 = p[0] - c[0];
+            const double yy0 = p[1] - c[1];
+            const double zz0 = p[2] - c[2];
+            *q = xx0*xx0/c[3] + yy0*yy0/c[4] + zz0*zz0/c[5] - 1.0;
+          }
+          break;
+        case Opcode::cylinder:
+          *q = std::max({p[0]*p[0] + p[1]*p[1] - c[2], c[0] - p[2], p[2] - c[1]});
+          break;
+        case Opcode::cone:
+          {
+            const double rad = c[0] * (1.0 - p[2] / c[1]);
+            *q = (0.0 < p[2] && p[2] < c[1]) ? p[0]*p[0] + p[1]*p[1] - rad*rad : 1.0;
+          }
+          break;
+        case Opcode::tetrahedron:
+          *q = -std::min({
+              c[0]*p[0] + c[1]*p[1] + c[2]*p[2] + c[3],
+              c[4]*p[0] + c[5]*p[1] + c[6]*p[2] + c[7],
+              c[8]*p[0] + c[9]*p[1] + c[10]*p[2] + c[11],
+              c[12]*p[0] + c[13]*p[1] + c[14]*p[2] + c[15]
+              });
+          break;
+        case Opcode::convex_polyhedron:
+          {
+            const size_t num_planes = size_t(c[0]);
+            double val = std::numeric_limits<double>::lowest();
+            for (size_t k = 0; k < num_planes; k++) {
+              const double * plane = c + 1 + 4*k;
+              val = std::max(val, plane[0]*p[0] + plane[1]*p[1] + plane[2]*p[2] - plane[3]);
+            }
+            *q = val;
+          }
+          break;
+        case Opcode::torus:
+          {
+            const double rr = sqrt(p[0]*p[0] + p[1]*p[1]) - c[0];
+            *q = rr*rr + p[2]*p[2] - c[1];
+          }
+          break;
+        case Opcode::half_space:
+          *q = c[0]*p[0] + c[1]*p[1] + c[2]*p[2] - c[3];
+          break;
+        case Opcode::callout:
+          if (sign_only) {
+            *q = callouts_[ins.arg]->classify({p[0], p[1], p[2]});
+          } else {
+            *q = callouts_[ins.arg]->eval({p[0], p[1], p[2]});
+          }
+          break;
+        case Opcode::set:
+          *q = c[0];
+          break;
+        case Opcode::min:
+          *q = std::min(*q, *p);
+          if (sign_only && *q < 0.0) {
+            pc = ins.jump - 1;
+          }
+          break;
+        case Opcode::max:
+          *q = std::max(*q, *p);
+          if (sign_only && *q >= 0.0) {
+            pc = ins.jump - 1;
+          }
+          break;
+        case Opcode::difference:
+          // see Difference::eval
+          *q = (*q < 0.0 && *p >= 0.0) ? *q : std::max(*q, -*p);
+          break;
+        case Opcode::skip_if_outside:
+          if (sign_only && *q >= 0.0) {
+            pc = ins.jump - 1;
+          }
+          break;
+      }
+    }
+    return r[result_register_];
+  }
+
+  private:
+    const std::shared_ptr<const pygalmesh::DomainBase> domain_;
+    std::vector<Instruction> program_;
+    std::vector<double> constants_;
+    std::vector<const pygalmesh::DomainBase*> callouts_;
+    // unions of compiled children, called out to
+    std::vector<std::shared_ptr<const pygalmesh::DomainBase>> unions_;
+    size_t num_registers_;
+    int result_register_;
+};
+
+} // namespace pygalmesh
+
+#endif // COMPILED_DOMAIN_HPP
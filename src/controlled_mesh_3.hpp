@@ -0,0 +1,141 @@
+#ifndef CONTROLLED_MESH_3_HPP
+#define CONTROLLED_MESH_3_HPP
+
+// make_mesh_3 and refine_mesh_3 under a MeshingControl. The refinement gets the stop
+// flag and the vertex budget through the Mesh_3 options; the optimization steps of the
+// options run one by one afterwards, in the order make_mesh_3 runs them, each with the
+// time left as its time limit. Once the run has been stopped, the complex is left as
+// it is, a valid but coarser mesh.
+
+#include "meshing_control.hpp"
+#include "meshing_options.hpp"
+
+#include <CGAL/Mesh_error_code.h>
+#include <CGAL/exude_mesh_3.h>
+#include <CGAL/make_mesh_3.h>
+#include <CGAL/optimize_mesh_3.h>
+#include <CGAL/perturb_mesh_3.h>
+#include <CGAL/refine_mesh_3.h>
+
+#include <string>
+
+namespace pygalmesh {
+
+// Mesh_3 sets error_code if it stops refining before the criteria are met.
+inline
+auto
+control_options(MeshingControl & control, CGAL::Mesh_error_code & error_code)
+{
+  return CGAL::parameters::mesh_3_options(
+      CGAL::parameters::maximal_number_of_vertices = control.max_vertices(),
+      CGAL::parameters::pointer_to_error_code = &error_code,
+      CGAL::parameters::pointer_to_stop_atomic_boolean = control.stop_flag()
+      );
+}
+
+template <typename C3t3>
+void
+enter_phase(MeshingControl & control, const std::string & phase, const C3t3 & c3t3)
+{
+  control.enter_phase(
+      phase, c3t3.triangulation().number_of_vertices(), c3t3.number_of_cells_in_complex()
+      );
+}
+
+template <typename C3t3, typename Domain>
+void
+optimize_controlled(
+    C3t3 & c3t3,
+    const Domain & domain,
+    const MeshingOptions & options,
+    MeshingControl & control,
+    const CGAL::Mesh_error_code error_code
+    )
+{
+  if (error_code == CGAL::CGAL_MESH_3_MAXIMAL_NUMBER_OF_VERTICES_REACHED) {
+    control.note("max_vertices");
+  }
+  if (options.lloyd && !control.should_stop()) {
+    enter_phase(control, "lloyd", c3t3);
+    CGAL::lloyd_optimize_mesh_3(
+        c3t3, domain, CGAL::parameters::time_limit = control.time_limit_for(0.0)
+        );
+  }
+  if (options.odt && !control.should_stop()) {
+    enter_phase(control, "odt", c3t3);
+    CGAL::odt_optimize_mesh_3(
+        c3t3, domain, CGAL::parameters::time_limit = control.time_limit_for(0.0)
+        );
+  }
+  if (options.perturb && !control.should_stop()) {
+    enter_phase(control, "perturb", c3t3);
+    CGAL::perturb_mesh_3(
+        c3t3, domain, CGAL::parameters::time_limit = control.time_limit_for(0.0)
+        );
+  }
+  if (options.exude && !control.should_stop()) {
+    enter_phase(control, "exude", c3t3);
+    CGAL::exude_mesh_3(
+        c3t3,
+        CGAL::parameters::sliver_bound = options.exude_sliver_bound,
+        CGAL::parameters::time_limit = control.time_limit_for(options.exude_time_limit)
+        );
+  }
+  enter_phase(control, "done", c3t3);
+}
+
+template <typename C3t3, typename Domain, typename Criteria>
+C3t3
+make_mesh_3_controlled(
+    const Domain & domain,
+    const Criteria & criteria,
+    const MeshingOptions & options,
+    MeshingControl & control
+    )
+{
+  control.enter_phase("refine", 0, 0);
+  // a run cancelled beforehand stops right after the initialization
+  control.should_stop();
+  CGAL::Mesh_error_code error_code = CGAL::CGAL_MESH_3_NO_ERROR;
+  C3t3 c3t3 = CGAL::make_mesh_3<C3t3>(
+      domain,
+      criteria,
+      CGAL::parameters::no_lloyd(),
+      CGAL::parameters::no_odt(),
+      CGAL::parameters::no_perturb(),
+      CGAL::parameters::no_exude(),
+      control_options(control, error_code)
+      );
+  optimize_controlled(c3t3, domain, options, control, error_code);
+  return c3t3;
+}
+
+template <typename C3t3, typename Domain, typename Criteria>
+void
+refine_mesh_3_controlled(
+    C3t3 & c3t3,
+    const Domain & domain,
+    const Criteria & criteria,
+    const MeshingOptions & options,
+    MeshingControl & control
+    )
+{
+  enter_phase(control, "refine", c3t3);
+  control.should_stop();
+  CGAL::Mesh_error_code error_code = CGAL::CGAL_MESH_3_NO_ERROR;
+  CGAL::refine_mesh_3(
+      c3t3,
+      domain,
+      criteria,
+      CGAL::parameters::no_lloyd(),
+      CGAL::parameters::no_odt(),
+      CGAL::parameters::no_perturb(),
+      CGAL::parameters::no_exude(),
+      control_options(control, error_code)
+      );
+  optimize_controlled(c3t3, domain, options, control, error_code);
+}
+
+} // namespace pygalmesh
+
+#endif // CONTROLLED_MESH_3_HPP
@@ -1,10 +1,17 @@
 #ifndef DOMAIN_HPP
 #define DOMAIN_HPP
 
+#include "bvh.hpp"
+#include "feature_set.hpp"
+#include "simd.hpp"
+
 #include <Eigen/Dense>
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <limits>
 #include <memory>
+#include <stdexcept>
 #include <vector>
 
 namespace pygalmesh {
@@ -20,16 +27,61 @@ class DomainBase
   double
   eval(const std::array<double, 3> & x) const = 0;
 
+  // Evaluates the domain function at n points given in structure-of-arrays layout.
+  // The built-in domains override this with vectorized kernels; the default loops over
+  // eval().
+  virtual
+  void
+  eval_batch(
+      const double * x, const double * y, const double * z,
+      double * out,
+      const size_t n
+      ) const
+  {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = eval({x[i], y[i], z[i]});
+    }
+  }
+
+  // Returns -1 if x is inside the domain (i.e., eval(x) < 0) and 1 otherwise. CGAL's
+  // implicit mesh domains only use the sign of the function, so the Boolean operators
+  // can override this to stop as soon as the result is decided.
+  virtual
+  int
+  classify(const std::array<double, 3> & x) const
+  {
+    return eval(x) < 0.0 ? -1 : 1;
+  }
+
   virtual
   double
   get_bounding_sphere_squared_radius() const = 0;
 
+  // An axis-aligned box that contains all points at which the domain is negative. The
+  // Boolean operators use it to skip children; the default is unbounded.
+  virtual
+  BoundingBox
+  get_bounding_box() const
+  {
+    return infinite_box();
+  }
+
   virtual
   Features
   get_features() const
   {
     return {};
   };
+
+  // The features as a shared, lazily transformed set. The built-in operators override
+  // this such that assembling the features of a tree copies no points; the default
+  // wraps get_features().
+  virtual
+  FeatureSet
+  get_feature_set() const
+  {
+    return FeatureSet(get_features());
+  }
 };
 
 class Translate: public pygalmesh::DomainBase
@@ -41,7 +93,7 @@ class Translate: public pygalmesh::DomainBase
       ):
     domain_(domain),
     direction_(Eigen::Vector3d(direction.data())),
-    translated_features_(translate_features(domain->get_features(), direction_))
+    feature_set_(domain->get_feature_set().transformed(Eigen::Matrix3d::Identity(), direction_))
   {
   }
 
@@ -53,20 +105,7 @@ class Translate: public pygalmesh::DomainBase
       const Eigen::Vector3d & direction
       ) const
   {
-    Features translated_features;
-    for (const auto & feature: features) {
-      std::vector<std::array<double, 3>> translated_feature;
-      for (const auto & point: feature) {
-        const std::array<double, 3> translated_point = {
-          point[0] + direction[0],
-          point[1] + direction[1],
-          point[2] + direction[2]
-        };
-        translated_feature.push_back(translated_point);
-      }
-      translated_features.push_back(translated_feature);
-    }
-    return translated_features;
+    return FeatureSet(features).transformed(Eigen::Matrix3d::Identity(), direction).materialize();
   }
 
   virtual
@@ -81,6 +120,43 @@ class Translate: public pygalmesh::DomainBase
     return domain_->eval(d);
   }
 
+  virtual
+  int
+  classify(const std::array<double, 3> & x) const
+  {
+    return domain_->classify({
+        x[0] - direction_[0],
+        x[1] - direction_[1],
+        x[2] - direction_[2]
+        });
+  }
+
+  virtual
+  void
+  eval_batch(
+      const double * x, const double * y, const double * z,
+      double * out,
+      const size_t n
+      ) const
+  {
+    std::vector<double> buffer(3*n);
+    double * x2 = buffer.data();
+    double * y2 = x2 + n;
+    double * z2 = y2 + n;
+    const double d0 = direction_[0];
+    const double d1 = direction_[1];
+    const double d2 = direction_[2];
+    simd::transform(x, y, z, x2, y2, z2, n, [&](
+          const auto & px, const auto & py, const auto & pz,
+          auto & qx, auto & qy, auto & qz
+          ) {
+      qx = px - d0;
+      qy = py - d1;
+      qz = pz - d2;
+    });
+    domain_->eval_batch(x2, y2, z2, out, n);
+  }
+
   virtual
   double
   get_bounding_sphere_squared_radius() const
@@ -90,17 +166,39 @@ class Translate: public pygalmesh::DomainBase
     return (radius + dir_norm)*(radius + dir_norm);
   }
 
+  virtual
+  BoundingBox
+  get_bounding_box() const
+  {
+    BoundingBox box = domain_->get_bounding_box();
+    for (int i = 0; i < 3; i++) {
+      box[0][i] += direction_[i];
+      box[1][i] += direction_[i];
+    }
+    return box;
+  }
+
   virtual
   Features
   get_features() const
   {
-    return translated_features_;
+    return feature_set_.materialize();
   };
 
+  virtual
+  FeatureSet
+  get_feature_set() const
+  {
+    return feature_set_;
+  }
+
+  friend class Affine;
+  friend class CompiledDomain;
+
   private:
     const std::shared_ptr<const pygalmesh::DomainBase> domain_;
     const Eigen::Vector3d direction_;
-    const Features translated_features_;
+    const FeatureSet feature_set_;
 };
 
 class Rotate: public pygalmesh::DomainBase
@@ -115,7 +213,11 @@ class Rotate: public pygalmesh::DomainBase
     normalized_axis_(Eigen::Vector3d(axis.data()).normalized()),
     sinAngle_(sin(angle)),
     cosAngle_(cos(angle)),
-    rotated_features_(rotate_features(domain_->get_features()))
+    // eval() rotates with the negative angle
+    inverse_rotation_(rotation_matrix(normalized_axis_, -sinAngle_, cosAngle_)),
+    feature_set_(domain_->get_feature_set().transformed(
+          inverse_rotation_.transpose(), Eigen::Vector3d::Zero()
+          ))
   {
   }
 
@@ -142,40 +244,74 @@ class Rotate: public pygalmesh::DomainBase
       + (1.0-cosAngle) * axis.dot(vec) * axis;
   }
 
+  // the matrix of rotate()
+  Eigen::Matrix3d
+  rotation_matrix(
+      const Eigen::Vector3d & axis,
+      const double sinAngle,
+      const double cosAngle
+      ) const
+  {
+    Eigen::Matrix3d cross;
+    cross << 0.0, -axis[2], axis[1],
+             axis[2], 0.0, -axis[0],
+             -axis[1], axis[0], 0.0;
+    return cosAngle * Eigen::Matrix3d::Identity()
+      + sinAngle * cross
+      + (1.0-cosAngle) * axis * axis.transpose();
+  }
+
   virtual
   double
   eval(const std::array<double, 3> & x) const
   {
-    // rotate with negative angle
-    const auto p2 = rotate(
-        Eigen::Vector3d(x.data()),
-        normalized_axis_,
-        -sinAngle_,
-        cosAngle_
-        );
+    const Eigen::Vector3d p2 = inverse_rotation_ * Eigen::Vector3d(x.data());
     return domain_->eval({p2[0], p2[1], p2[2]});
   }
 
+  virtual
+  int
+  classify(const std::array<double, 3> & x) const
+  {
+    const Eigen::Vector3d p2 = inverse_rotation_ * Eigen::Vector3d(x.data());
+    return domain_->classify({p2[0], p2[1], p2[2]});
+  }
+
+  virtual
+  void
+  eval_batch(
+      const double * x, const double * y, const double * z,
+      double * out,
+      const size_t n
+      ) const
+  {
+    std::vector<double> buffer(3*n);
+    double * x2 = buffer.data();
+    double * y2 = x2 + n;
+    double * z2 = y2 + n;
+    const Eigen::Matrix3d & R = inverse_rotation_;
+    const double r00 = R(0, 0), r01 = R(0, 1), r02 = R(0, 2);
+    const double r10 = R(1, 0), r11 = R(1, 1), r12 = R(1, 2);
+    const double r20 = R(2, 0), r21 = R(2, 1), r22 = R(2, 2);
+    simd::transform(x, y, z, x2, y2, z2, n, [&](
+          const auto & px, const auto & py, const auto & pz,
+          auto & qx, auto & qy, auto & qz
+          ) {
+      qx = r00*px + r01*py + r02*pz;
+      qy = r10*px + r11*py + r12*pz;
+      qz = r20*px + r21*py + r22*pz;
+    });
+    domain_->eval_batch(x2, y2, z2, out, n);
+  }
+
   Features
   rotate_features(
       const Features & features
       ) const
   {
-    Features rotated_features;
-    for (const auto & feature: features) {
-      std::vector<std::array<double, 3>> rotated_feature;
-      for (const auto & point: feature) {
-        const auto p2 = rotate(
-            Eigen::Vector3d(point.data()),
-            normalized_axis_,
-            sinAngle_,
-            cosAngle_
-            );
-        rotated_feature.push_back({p2[0], p2[1], p2[2]});
-      }
-      rotated_features.push_back(rotated_feature);
-    }
-    return rotated_features;
+    return FeatureSet(features).transformed(
+        inverse_rotation_.transpose(), Eigen::Vector3d::Zero()
+        ).materialize();
   }
 
   virtual
@@ -185,19 +321,40 @@ class Rotate: public pygalmesh::DomainBase
     return domain_->get_bounding_sphere_squared_radius();
   }
 
+  virtual
+  BoundingBox
+  get_bounding_box() const
+  {
+    return transform_box(domain_->get_bounding_box(), [&](const std::array<double, 3> & x) {
+      const auto p2 = rotate(Eigen::Vector3d(x.data()), normalized_axis_, sinAngle_, cosAngle_);
+      return std::array<double, 3>{p2[0], p2[1], p2[2]};
+    });
+  }
+
   virtual
   Features
   get_features() const
   {
-    return rotated_features_;
+    return feature_set_.materialize();
   };
 
+  virtual
+  FeatureSet
+  get_feature_set() const
+  {
+    return feature_set_;
+  }
+
+  friend class Affine;
+  friend class CompiledDomain;
+
   private:
     const std::shared_ptr<const pygalmesh::DomainBase> domain_;
     const Eigen::Vector3d normalized_axis_;
     const double sinAngle_;
     const double cosAngle_;
-    const Features rotated_features_;
+    const Eigen::Matrix3d inverse_rotation_;
+    const FeatureSet feature_set_;
 };
 
 class Scale: public pygalmesh::DomainBase
@@ -209,7 +366,9 @@ class Scale: public pygalmesh::DomainBase
       ):
     domain_(domain),
     alpha_(alpha),
-    scaled_features_(scale_features(domain_->get_features()))
+    feature_set_(domain_->get_feature_set().transformed(
+          alpha_ * Eigen::Matrix3d::Identity(), Eigen::Vector3d::Zero()
+          ))
   {
     assert(alpha_ > 0.0);
   }
@@ -223,6 +382,37 @@ class Scale: public pygalmesh::DomainBase
     return domain_->eval({x[0]/alpha_, x[1]/alpha_, x[2]/alpha_});
   }
 
+  virtual
+  int
+  classify(const std::array<double, 3> & x) const
+  {
+    return domain_->classify({x[0]/alpha_, x[1]/alpha_, x[2]/alpha_});
+  }
+
+  virtual
+  void
+  eval_batch(
+      const double * x, const double * y, const double * z,
+      double * out,
+      const size_t n
+      ) const
+  {
+    std::vector<double> buffer(3*n);
+    double * x2 = buffer.data();
+    double * y2 = x2 + n;
+    double * z2 = y2 + n;
+    const double alpha = alpha_;
+    simd::transform(x, y, z, x2, y2, z2, n, [&](
+          const auto & px, const auto & py, const auto & pz,
+          auto & qx, auto & qy, auto & qz
+          ) {
+      qx = px / alpha;
+      qy = py / alpha;
+      qz = pz / alpha;
+    });
+    domain_->eval_batch(x2, y2, z2, out, n);
+  }
+
   virtual
   double
   get_bounding_sphere_squared_radius() const
@@ -230,37 +420,49 @@ class Scale: public pygalmesh::DomainBase
     return alpha_*alpha_ * domain_->get_bounding_sphere_squared_radius();
   }
 
+  virtual
+  BoundingBox
+  get_bounding_box() const
+  {
+    BoundingBox box = domain_->get_bounding_box();
+    for (int i = 0; i < 3; i++) {
+      box[0][i] *= alpha_;
+      box[1][i] *= alpha_;
+    }
+    return box;
+  }
+
   Features
   scale_features(
       const Features & features
       ) const
   {
-    Features scaled_features;
-    for (const auto & feature: features) {
-      std::vector<std::array<double, 3>> scaled_feature;
-      for (const auto & point: feature) {
-        scaled_feature.push_back({
-            alpha_ * point[0],
-            alpha_ * point[1],
-            alpha_ * point[2]
-            });
-      }
-      scaled_features.push_back(scaled_feature);
-    }
-    return scaled_features;
+    return FeatureSet(features).transformed(
+        alpha_ * Eigen::Matrix3d::Identity(), Eigen::Vector3d::Zero()
+        ).materialize();
   }
 
   virtual
   Features
   get_features() const
   {
-    return scaled_features_;
+    return feature_set_.materialize();
   };
 
+  virtual
+  FeatureSet
+  get_feature_set() const
+  {
+    return feature_set_;
+  }
+
+  friend class Affine;
+  friend class CompiledDomain;
+
   private:
     std::shared_ptr<const pygalmesh::DomainBase> domain_;
     const double alpha_;
-    const Features scaled_features_;
+    const FeatureSet feature_set_;
 };
 
 class Stretch: public pygalmesh::DomainBase
@@ -273,7 +475,12 @@ class Stretch: public pygalmesh::DomainBase
     domain_(domain),
     normalized_direction_(Eigen::Vector3d(direction.data()).normalized()),
     alpha_(Eigen::Vector3d(direction.data()).norm()),
-    stretched_features_(stretch_features(domain_->get_features()))
+    // scale the component of normalized_direction_ by alpha_
+    feature_set_(domain_->get_feature_set().transformed(
+          Eigen::Matrix3d::Identity()
+          + (alpha_ - 1.0) * normalized_direction_ * normalized_direction_.transpose(),
+          Eigen::Vector3d::Zero()
+          ))
   {
     assert(alpha_ > 0.0);
   }
@@ -292,6 +499,46 @@ class Stretch: public pygalmesh::DomainBase
     return domain_->eval({v2[0], v2[1], v2[2]});
   }
 
+  virtual
+  int
+  classify(const std::array<double, 3> & x) const
+  {
+    const Eigen::Vector3d v(x.data());
+    const double beta = normalized_direction_.dot(v);
+    const auto v2 = beta/alpha_ * normalized_direction_
+       + (v - beta * normalized_direction_);
+    return domain_->classify({v2[0], v2[1], v2[2]});
+  }
+
+  virtual
+  void
+  eval_batch(
+      const double * x, const double * y, const double * z,
+      double * out,
+      const size_t n
+      ) const
+  {
+    std::vector<double> buffer(3*n);
+    double * x2 = buffer.data();
+    double * y2 = x2 + n;
+    double * z2 = y2 + n;
+    const double n0 = normalized_direction_[0];
+    const double n1 = normalized_direction_[1];
+    const double n2 = normalized_direction_[2];
+    const double alpha = alpha_;
+    simd::transform(x, y, z, x2, y2, z2, n, [&](
+          const auto & px, const auto & py, const auto & pz,
+          auto & qx, auto & qy, auto & qz
+          ) {
+      const auto beta = n0*px + n1*py + n2*pz;
+      const auto gamma = beta/alpha - beta;
+      qx = px + gamma*n0;
+      qy = py + gamma*n1;
+      qz = pz + gamma*n2;
+    });
+    domain_->eval_batch(x2, y2, z2, out, n);
+  }
+
   virtual
   double
   get_bounding_sphere_squared_radius() const
@@ -299,48 +546,125 @@ class Stretch: public pygalmesh::DomainBase
     return alpha_*alpha_ * domain_->get_bounding_sphere_squared_radius();
   }
 
+  virtual
+  BoundingBox
+  get_bounding_box() const
+  {
+    return transform_box(domain_->get_bounding_box(), [&](const std::array<double, 3> & x) {
+      // scale the component of normalized_direction_ by alpha_
+      const Eigen::Vector3d v(x.data());
+      const double beta = normalized_direction_.dot(v);
+      const Eigen::Vector3d v2 = beta * alpha_ * normalized_direction_
+         + (v - beta * normalized_direction_);
+      return std::array<double, 3>{v2[0], v2[1], v2[2]};
+    });
+  }
+
   Features
   stretch_features(
       const Features & features
       ) const
   {
-    Features stretched_features;
-    for (const auto & feature: features) {
-      std::vector<std::array<double, 3>> stretched_feature;
-      for (const auto & point: feature) {
-        // scale the component of normalized_direction_ by alpha_
-        const Eigen::Vector3d v(point.data());
-        const double beta = normalized_direction_.dot(v);
-        const auto v2 = beta * alpha_ * normalized_direction_
-           + (v - beta * normalized_direction_);
-        stretched_feature.push_back({v2[0], v2[1], v2[2]});
-      }
-      stretched_features.push_back(stretched_feature);
-    }
-    return stretched_features;
+    return FeatureSet(features).transformed(
+        Eigen::Matrix3d::Identity()
+        + (alpha_ - 1.0) * normalized_direction_ * normalized_direction_.transpose(),
+        Eigen::Vector3d::Zero()
+        ).materialize();
   }
 
   virtual
   Features
   get_features() const
   {
-    return stretched_features_;
+    return feature_set_.materialize();
   };
 
+  virtual
+  FeatureSet
+  get_feature_set() const
+  {
+    return feature_set_;
+  }
+
+  friend class Affine;
+  friend class CompiledDomain;
+
   private:
     std::shared_ptr<const pygalmesh::DomainBase> domain_;
     const Eigen::Vector3d normalized_direction_;
     const double alpha_;
-    const Features stretched_features_;
+    const FeatureSet feature_set_;
 };
 
+// The children of a Boolean operator sorted for short-circuit classification. A child
+// decides the result if it classifies a point as `decisive` (outside for
+// intersections, inside for unions). Assuming independent children, the expected cost
+// of classify() is smallest if they are sorted by time per decided sample. Without
+// samples, the order is kept.
+inline
+std::vector<std::shared_ptr<const pygalmesh::DomainBase>>
+sort_by_cost(
+    const std::vector<std::shared_ptr<const pygalmesh::DomainBase>> & domains,
+    const std::vector<std::array<double, 3>> & samples,
+    const int decisive
+    )
+{
+  if (samples.empty()) {
+    return domains;
+  }
+  std::vector<double> scores;
+  for (const auto & domain: domains) {
+    size_t num_decided = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto & x: samples) {
+      if (domain->classify(x) == decisive) {
+        num_decided++;
+      }
+    }
+    const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+    scores.push_back(
+        num_decided > 0 ? time.count() / num_decided : std::numeric_limits<double>::infinity()
+        );
+  }
+  std::vector<size_t> order(domains.size());
+  for (size_t k = 0; k < order.size(); k++) {
+    order[k] = k;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+    return scores[a] < scores[b];
+  });
+  std::vector<std::shared_ptr<const pygalmesh::DomainBase>> sorted;
+  for (const auto k: order) {
+    sorted.push_back(domains[k]);
+  }
+  return sorted;
+}
+
+inline
+FeatureSet
+concatenate_feature_sets(
+    const std::vector<std::shared_ptr<const pygalmesh::DomainBase>> & domains
+    )
+{
+  std::vector<FeatureSet> sets;
+  for (const auto & domain: domains) {
+    sets.push_back(domain->get_feature_set());
+  }
+  return FeatureSet::concatenate(sets);
+}
+
 class Intersection: public pygalmesh::DomainBase
 {
   public:
+  // If `samples` are given, the children are sorted such that classify() is fast on
+  // points distributed like them. This doesn't change the domain.
   explicit Intersection(
-      std::vector<std::shared_ptr<const pygalmesh::DomainBase>> & domains
+      std::vector<std::shared_ptr<const pygalmesh::DomainBase>> & domains,
+      const std::vector<std::array<double, 3>> & samples = {}
       ):
-    domains_(domains)
+    domains_(sort_by_cost(domains, samples, 1)),
+    box_(intersect_boxes(domains)),
+    feature_set_(concatenate_feature_sets(domains))
   {
   }
 
@@ -358,6 +682,40 @@ class Intersection: public pygalmesh::DomainBase
     return maxval;
   }
 
+  // outside as soon as one child is outside
+  virtual
+  int
+  classify(const std::array<double, 3> & x) const
+  {
+    if (!contains(box_, x)) {
+      return 1;
+    }
+    for (const auto & domain: domains_) {
+      if (domain->classify(x) > 0) {
+        return 1;
+      }
+    }
+    return -1;
+  }
+
+  virtual
+  void
+  eval_batch(
+      const double * x, const double * y, const double * z,
+      double * out,
+      const size_t n
+      ) const
+  {
+    std::fill(out, out + n, std::numeric_limits<double>::lowest());
+    std::vector<double> val(n);
+    for (const auto & domain: domains_) {
+      domain->eval_batch(x, y, z, val.data(), n);
+      simd::combine(out, val.data(), n, [](const auto & a, const auto & b) {
+        return simd::max(a, b);
+      });
+    }
+  }
+
   virtual
   double
   get_bounding_sphere_squared_radius() const
@@ -369,30 +727,68 @@ class Intersection: public pygalmesh::DomainBase
     return min;
   }
 
+  virtual
+  BoundingBox
+  get_bounding_box() const
+  {
+    return box_;
+  }
+
+  BoundingBox
+  intersect_boxes(
+      const std::vector<std::shared_ptr<const pygalmesh::DomainBase>> & domains
+      ) const
+  {
+    BoundingBox box = infinite_box();
+    for (const auto & domain: domains) {
+      box = intersect(box, domain->get_bounding_box());
+    }
+    return box;
+  }
+
   virtual
   Features
   get_features() const
   {
-    Features features;
-    for (const auto & domain: domains_) {
-      const auto f = domain->get_features();
-      features.insert(std::end(features), std::begin(f), std::end(f));
-    }
-    return features;
+    return feature_set_.materialize();
   };
 
+  virtual
+  FeatureSet
+  get_feature_set() const
+  {
+    return feature_set_;
+  }
+
+  friend class Affine;
+  friend class CompiledDomain;
+
   private:
-    std::vector<std::shared_ptr<const pygalmesh::DomainBase>> domains_;
+    const std::vector<std::shared_ptr<const pygalmesh::DomainBase>> domains_;
+    const BoundingBox box_;
+    const FeatureSet feature_set_;
 };
 
 class Union: public pygalmesh::DomainBase
 {
   public:
+  // Unions of at least this many children put their children's bounding boxes into a
+  // BVH, and only the children whose boxes contain the query point are evaluated.
+  // eval() is then exact wherever such a child exists, in particular inside the union.
+  // Outside of all boxes, it takes the child with the nearest box, which is positive
+  // like the minimum but may be larger; the meshers only ask for classify().
+  static constexpr size_t bvh_threshold = 16;
+
+  // If `samples` are given, the children are sorted such that classify() is fast on
+  // points distributed like them. This doesn't change the domain.
   explicit Union(
-      std::vector<std::shared_ptr<const pygalmesh::DomainBase>> & domains
+      std::vector<std::shared_ptr<const pygalmesh::DomainBase>> & domains,
+      const std::vector<std::array<double, 3>> & samples = {}
       ):
-    domains_(domains)
+    domains_(sort_by_cost(domains, samples, -1)),
+    feature_set_(concatenate_feature_sets(domains))
   {
+    build_bvh();
   }
 
   virtual ~Union() = default;
@@ -403,12 +799,142 @@ class Union: public pygalmesh::DomainBase
   {
     // TODO find a differentiable expression
     double minval = std::numeric_limits<double>::max();
+    if (bvh_) {
+      // The children that are inside contain x in their boxes, so a negative minimum
+      // over those is the minimum over all.
+      bool found = false;
+      bvh_->visit(x, [&](const size_t k) {
+        minval = std::min(minval, domains_[k]->eval(x));
+        found = true;
+        return false;
+      });
+      return found ? minval : domains_[nearest_child(x)]->eval(x);
+    }
     for (const auto & domain: domains_) {
       minval = std::min(minval, domain->eval(x));
     }
     return minval;
   }
 
+  // inside as soon as one child is inside
+  virtual
+  int
+  classify(const std::array<double, 3> & x) const
+  {
+    if (bvh_) {
+      const bool inside = bvh_->visit(x, [&](const size_t k) {
+        return domains_[k]->classify(x) < 0;
+      });
+      return inside ? -1 : 1;
+    }
+    if (!contains(box_, x)) {
+      return 1;
+    }
+    for (const auto & domain: domains_) {
+      if (domain->classify(x) < 0) {
+        return -1;
+      }
+    }
+    return 1;
+  }
+
+  virtual
+  void
+  eval_batch(
+      const double * x, const double * y, const double * z,
+      double * out,
+      const size_t n
+      ) const
+  {
+    std::fill(out, out + n, std::numeric_limits<double>::max());
+    if (bvh_) {
+      eval_batch_bvh(x, y, z, out, n);
+      return;
+    }
+    std::vector<double> val(n);
+    for (const auto & domain: domains_) {
+      domain->eval_batch(x, y, z, val.data(), n);
+      simd::combine(out, val.data(), n, [](const auto & a, const auto & b) {
+        return simd::min(a, b);
+      });
+    }
+  }
+
+  // Sorts the points into the children whose boxes contain them and evaluates every
+  // child in one batch on its points. As in eval(), the points outside of all boxes go
+  // to the child with the nearest box.
+  void
+  eval_batch_bvh(
+      const double * x, const double * y, const double * z,
+      double * out,
+      const size_t n
+      ) const
+  {
+    std::vector<std::vector<size_t>> points(domains_.size());
+    for (size_t i = 0; i < n; i++) {
+      const std::array<double, 3> xi = {x[i], y[i], z[i]};
+      bool found = false;
+      bvh_->visit(xi, [&](const size_t k) {
+        points[k].push_back(i);
+        found = true;
+        return false;
+      });
+      if (!found) {
+        points[nearest_child(xi)].push_back(i);
+      }
+    }
+    for (size_t k = 0; k < domains_.size(); k++) {
+      eval_batch_at(*domains_[k], points[k], x, y, z, out);
+    }
+  }
+
+  // The child whose bounding box is nearest to x
+  size_t
+  nearest_child(const std::array<double, 3> & x) const
+  {
+    size_t nearest = 0;
+    double best = std::numeric_limits<double>::infinity();
+    bvh_->min_distance(x, [&](const size_t k) {
+      const double d = distance(boxes_[k], x);
+      if (d < best) {
+        best = d;
+        nearest = k;
+      }
+      return d;
+    });
+    return nearest;
+  }
+
+  // Evaluates a child at the given points and lowers out to its values.
+  static
+  void
+  eval_batch_at(
+      const pygalmesh::DomainBase & domain,
+      const std::vector<size_t> & points,
+      const double * x, const double * y, const double * z,
+      double * out
+      )
+  {
+    const size_t m = points.size();
+    if (m == 0) {
+      return;
+    }
+    std::vector<double> buffer(4*m);
+    double * x2 = buffer.data();
+    double * y2 = x2 + m;
+    double * z2 = y2 + m;
+    double * val = z2 + m;
+    for (size_t j = 0; j < m; j++) {
+      x2[j] = x[points[j]];
+      y2[j] = y[points[j]];
+      z2[j] = z[points[j]];
+    }
+    domain.eval_batch(x2, y2, z2, val, m);
+    for (size_t j = 0; j < m; j++) {
+      out[points[j]] = std::min(out[points[j]], val[j]);
+    }
+  }
+
   virtual
   double
   get_bounding_sphere_squared_radius() const
@@ -420,20 +946,52 @@ class Union: public pygalmesh::DomainBase
     return max;
   }
 
+  virtual
+  BoundingBox
+  get_bounding_box() const
+  {
+    return box_;
+  }
+
   virtual
   Features
   get_features() const
   {
-    Features features;
+    return feature_set_.materialize();
+  };
+
+  virtual
+  FeatureSet
+  get_feature_set() const
+  {
+    return feature_set_;
+  }
+
+  friend class Affine;
+  friend class CompiledDomain;
+
+  private:
+  void
+  build_bvh()
+  {
+    const double inf = std::numeric_limits<double>::infinity();
+    box_ = {{{inf, inf, inf}, {-inf, -inf, -inf}}};
+    boxes_.clear();
     for (const auto & domain: domains_) {
-      const auto f = domain->get_features();
-      features.insert(std::end(features), std::begin(f), std::end(f));
+      boxes_.push_back(domain->get_bounding_box());
+      box_ = merge(box_, boxes_.back());
     }
-    return features;
-  };
+    if (domains_.size() >= bvh_threshold) {
+      bvh_ = std::make_shared<const BoundingVolumeHierarchy>(boxes_);
+    }
+  }
 
   private:
-    std::vector<std::shared_ptr<const pygalmesh::DomainBase>> domains_;
+    const std::vector<std::shared_ptr<const pygalmesh::DomainBase>> domains_;
+    BoundingBox box_;
+    std::vector<BoundingBox> boxes_;
+    std::shared_ptr<const BoundingVolumeHierarchy> bvh_;
+    const FeatureSet feature_set_;
 };
 
 class Difference: public pygalmesh::DomainBase
@@ -444,7 +1002,11 @@ class Difference: public pygalmesh::DomainBase
       std::shared_ptr<const pygalmesh::DomainBase> & domain1
       ):
     domain0_(domain0),
-    domain1_(domain1)
+    domain1_(domain1),
+    feature_set_(FeatureSet::concatenate({
+          domain0->get_feature_set(),
+          domain1->get_feature_set()
+          }))
   {
   }
 
@@ -460,6 +1022,36 @@ class Difference: public pygalmesh::DomainBase
     return (val0 < 0.0 && val1 >= 0.0) ? val0 : std::max(val0, -val1);
   }
 
+  virtual
+  int
+  classify(const std::array<double, 3> & x) const
+  {
+    if (domain0_->classify(x) > 0) {
+      return 1;
+    }
+    return domain1_->classify(x) < 0 ? 1 : -1;
+  }
+
+  virtual
+  void
+  eval_batch(
+      const double * x, const double * y, const double * z,
+      double * out,
+      const size_t n
+      ) const
+  {
+    std::vector<double> val1(n);
+    domain0_->eval_batch(x, y, z, out, n);
+    domain1_->eval_batch(x, y, z, val1.data(), n);
+    simd::combine(out, val1.data(), n, [](const auto & a, const auto & b) {
+      return simd::select(
+          simd::logical_and(simd::lt(a, 0.0), simd::ge(b, 0.0)),
+          a,
+          simd::max(a, -b)
+          );
+    });
+  }
+
   virtual
   double
   get_bounding_sphere_squared_radius() const
@@ -467,24 +1059,323 @@ class Difference: public pygalmesh::DomainBase
     return domain0_->get_bounding_sphere_squared_radius();
   }
 
+  virtual
+  BoundingBox
+  get_bounding_box() const
+  {
+    return domain0_->get_bounding_box();
+  }
+
   virtual
   Features
   get_features() const
   {
-    Features features;
-
-    const auto f0 = domain0_->get_features();
-    features.insert(std::end(features), std::begin(f0), std::end(f0));
+    return feature_set_.materialize();
+  };
 
-    const auto f1 = domain1_->get_features();
-    features.insert(std::end(features), std::begin(f1), std::end(f1));
+  virtual
+  FeatureSet
+  get_feature_set() const
+  {
+    return feature_set_;
+  }
 
-    return features;
-  };
+  friend class Affine;
+  friend class CompiledDomain;
 
   private:
     std::shared_ptr<const pygalmesh::DomainBase> domain0_;
     std::shared_ptr<const pygalmesh::DomainBase> domain1_;
+    const FeatureSet feature_set_;
+};
+
+// The image of a domain under the affine map x -> A x + b, given as the 3x4 matrix
+// [A | b]. A must be invertible.
+class Affine: public pygalmesh::DomainBase
+{
+  public:
+  Affine(
+      const std::shared_ptr<const pygalmesh::DomainBase> & domain,
+      const std::array<std::array<double, 4>, 3> & matrix
+      ):
+    Affine(domain, linear_part(matrix), translation_part(matrix))
+  {
+  }
+
+  Affine(
+      const std::shared_ptr<const pygalmesh::DomainBase> & domain,
+      const Eigen::Matrix3d & A,
+      const Eigen::Vector3d & b
+      ):
+    domain_(domain),
+    A_(A),
+    b_(b),
+    Ainv_(invert(A)),
+    feature_set_(domain_->get_feature_set().transformed(A_, b_))
+  {
+  }
+
+  virtual ~Affine() = default;
+
+  static
+  Eigen::Matrix3d
+  linear_part(const std::array<std::array<double, 4>, 3> & matrix)
+  {
+    Eigen::Matrix3d A;
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        A(i, j) = matrix[i][j];
+      }
+    }
+    return A;
+  }
+
+  static
+  Eigen::Vector3d
+  translation_part(const std::array<std::array<double, 4>, 3> & matrix)
+  {
+    return {matrix[0][3], matrix[1][3], matrix[2][3]};
+  }
+
+  static
+  Eigen::Matrix3d
+  invert(const Eigen::Matrix3d & A)
+  {
+    Eigen::Matrix3d Ainv;
+    bool invertible;
+    A.computeInverseWithCheck(Ainv, invertible);
+    if (!invertible) {
+      throw std::invalid_argument("The affine map must be invertible.");
+    }
+    return Ainv;
+  }
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    const Eigen::Vector3d p2 = Ainv_ * (Eigen::Vector3d(x.data()) - b_);
+    return domain_->eval({p2[0], p2[1], p2[2]});
+  }
+
+  virtual
+  int
+  classify(const std::array<double, 3> & x) const
+  {
+    const Eigen::Vector3d p2 = Ainv_ * (Eigen::Vector3d(x.data()) - b_);
+    return domain_->classify({p2[0], p2[1], p2[2]});
+  }
+
+  virtual
+  void
+  eval_batch(
+      const double * x, const double * y, const double * z,
+      double * out,
+      const size_t n
+      ) const
+  {
+    std::vector<double> buffer(3*n);
+    double * x2 = buffer.data();
+    double * y2 = x2 + n;
+    double * z2 = y2 + n;
+    const Eigen::Matrix3d & M = Ainv_;
+    const double m00 = M(0, 0), m01 = M(0, 1), m02 = M(0, 2);
+    const double m10 = M(1, 0), m11 = M(1, 1), m12 = M(1, 2);
+    const double m20 = M(2, 0), m21 = M(2, 1), m22 = M(2, 2);
+    const double b0 = b_[0];
+    const double b1 = b_[1];
+    const double b2 = b_[2];
+    simd::transform(x, y, z, x2, y2, z2, n, [&](
+          const auto & px, const auto & py, const auto & pz,
+          auto & qx, auto & qy, auto & qz
+          ) {
+      const auto dx = px - b0;
+      const auto dy = py - b1;
+      const auto dz = pz - b2;
+      qx = m00*dx + m01*dy + m02*dz;
+      qy = m10*dx + m11*dy + m12*dz;
+      qz = m20*dx + m21*dy + m22*dz;
+    });
+    domain_->eval_batch(x2, y2, z2, out, n);
+  }
+
+  // The bounding sphere of the domain is centered at the origin. Its image is contained
+  // in the ball around b with the radius scaled by the spectral norm of A.
+  virtual
+  double
+  get_bounding_sphere_squared_radius() const
+  {
+    const double radius = sqrt(domain_->get_bounding_sphere_squared_radius());
+    const double norm = Eigen::JacobiSVD<Eigen::Matrix3d>(A_).singularValues()[0];
+    const double r = b_.norm() + norm * radius;
+    return r*r;
+  }
+
+  virtual
+  BoundingBox
+  get_bounding_box() const
+  {
+    return transform_box(domain_->get_bounding_box(), [&](const std::array<double, 3> & x) {
+      const Eigen::Vector3d p2 = A_ * Eigen::Vector3d(x.data()) + b_;
+      return std::array<double, 3>{p2[0], p2[1], p2[2]};
+    });
+  }
+
+  virtual
+  Features
+  get_features() const
+  {
+    return feature_set_.materialize();
+  };
+
+  virtual
+  FeatureSet
+  get_feature_set() const
+  {
+    return feature_set_;
+  }
+
+  // Rewrites a domain tree such that every chain of nested transformations (Translate,
+  // Rotate, Scale, Stretch, Affine) becomes a single Affine node. Subtrees without
+  // transformations are shared with the input.
+  static
+  std::shared_ptr<const pygalmesh::DomainBase>
+  fuse(const std::shared_ptr<const pygalmesh::DomainBase> & domain)
+  {
+    Eigen::Matrix3d A;
+    Eigen::Vector3d b;
+    std::shared_ptr<const pygalmesh::DomainBase> child;
+    const int length = get_chain_map(*domain, A, b, child);
+    if (length > 0) {
+      const auto fused_child = fuse(child);
+      if (length == 1 && fused_child == child) {
+        return domain;
+      }
+      return std::make_shared<const Affine>(fused_child, A, b);
+    }
+
+    if (const auto d = dynamic_cast<const Intersection*>(domain.get())) {
+      auto domains = d->domains_;
+      if (fuse_all(domains)) {
+        return std::make_shared<const Intersection>(domains);
+      }
+      return domain;
+    }
+    if (const auto d = dynamic_cast<const Union*>(domain.get())) {
+      auto domains = d->domains_;
+      if (fuse_all(domains)) {
+        return std::make_shared<const Union>(domains);
+      }
+      return domain;
+    }
+    if (const auto d = dynamic_cast<const Difference*>(domain.get())) {
+      auto domain0 = fuse(d->domain0_);
+      auto domain1 = fuse(d->domain1_);
+      if (domain0 != d->domain0_ || domain1 != d->domain1_) {
+        return std::make_shared<const Difference>(domain0, domain1);
+      }
+      return domain;
+    }
+    return domain;
+  }
+
+  friend class CompiledDomain;
+
+  private:
+  // If domain is a transformation, gets the map x -> A x + b from the child domain to
+  // the transformed one.
+  static
+  bool
+  get_map(
+      const pygalmesh::DomainBase & domain,
+      Eigen::Matrix3d & A,
+      Eigen::Vector3d & b,
+      std::shared_ptr<const pygalmesh::DomainBase> & child
+      )
+  {
+    const Eigen::Matrix3d I = Eigen::Matrix3d::Identity();
+    if (const auto d = dynamic_cast<const Translate*>(&domain)) {
+      A = I;
+      b = d->direction_;
+      child = d->domain_;
+      return true;
+    }
+    if (const auto d = dynamic_cast<const Rotate*>(&domain)) {
+      A = d->inverse_rotation_.transpose();
+      b = Eigen::Vector3d::Zero();
+      child = d->domain_;
+      return true;
+    }
+    if (const auto d = dynamic_cast<const Scale*>(&domain)) {
+      A = d->alpha_ * I;
+      b = Eigen::Vector3d::Zero();
+      child = d->domain_;
+      return true;
+    }
+    if (const auto d = dynamic_cast<const Stretch*>(&domain)) {
+      const Eigen::Vector3d & n = d->normalized_direction_;
+      A = I + (d->alpha_ - 1.0) * n * n.transpose();
+      b = Eigen::Vector3d::Zero();
+      child = d->domain_;
+      return true;
+    }
+    if (const auto d = dynamic_cast<const Affine*>(&domain)) {
+      A = d->A_;
+      b = d->b_;
+      child = d->domain_;
+      return true;
+    }
+    return false;
+  }
+
+  // Composes the maps of a chain of nested transformations starting at domain. Returns
+  // the length of the chain; child is the first node that isn't a transformation.
+  static
+  int
+  get_chain_map(
+      const pygalmesh::DomainBase & domain,
+      Eigen::Matrix3d & A,
+      Eigen::Vector3d & b,
+      std::shared_ptr<const pygalmesh::DomainBase> & child
+      )
+  {
+    if (!get_map(domain, A, b, child)) {
+      return 0;
+    }
+    int length = 1;
+    Eigen::Matrix3d A2;
+    Eigen::Vector3d b2;
+    std::shared_ptr<const pygalmesh::DomainBase> grandchild;
+    while (get_map(*child, A2, b2, grandchild)) {
+      // the child's map is applied first
+      b = A * b2 + b;
+      A = A * A2;
+      child = grandchild;
+      length++;
+    }
+    return length;
+  }
+
+  // returns whether any of the domains changed
+  static
+  bool
+  fuse_all(std::vector<std::shared_ptr<const pygalmesh::DomainBase>> & domains)
+  {
+    bool changed = false;
+    for (auto & domain: domains) {
+      const auto fused = fuse(domain);
+      changed = changed || fused != domain;
+      domain = fused;
+    }
+    return changed;
+  }
+
+  private:
+    const std::shared_ptr<const pygalmesh::DomainBase> domain_;
+    const Eigen::Matrix3d A_;
+    const Eigen::Vector3d b_;
+    const Eigen::Matrix3d Ainv_;
+    const FeatureSet feature_set_;
 };
 
 } // namespace pygalmesh
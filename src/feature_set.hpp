@@ -0,0 +1,157 @@
+#ifndef FEATURE_SET_HPP
+#define FEATURE_SET_HPP
+
+#include <Eigen/Dense>
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace pygalmesh {
+
+// An immutable, reference-counted collection of feature polylines.
+//
+// Transforming or concatenating feature sets only creates a small node that refers to
+// the operands; the points themselves are shared and never copied. The accumulated
+// affine maps are applied when the set is finally traversed, so deep domain trees cost
+// O(number of nodes) to assemble their features instead of O(depth x points).
+class FeatureSet
+{
+  public:
+  using Polylines = std::vector<std::vector<std::array<double, 3>>>;
+
+  FeatureSet() = default;
+
+  explicit FeatureSet(Polylines polylines)
+  {
+    if (!polylines.empty()) {
+      auto node = std::make_shared<Node>();
+      node->size = polylines.size();
+      node->polylines = std::make_shared<const Polylines>(std::move(polylines));
+      node_ = node;
+    }
+  }
+
+  // the image of the features under x -> A x + b
+  FeatureSet
+  transformed(const Eigen::Matrix3d & A, const Eigen::Vector3d & b) const
+  {
+    if (!node_) {
+      return {};
+    }
+    // Leaves are copied with the composed map, concatenations wrapped.
+    auto node = std::make_shared<Node>();
+    node->size = node_->size;
+    if (node_->polylines) {
+      node->polylines = node_->polylines;
+      node->A = A * node_->A;
+      node->b = A * node_->b + b;
+    } else {
+      node->children = {node_};
+      node->A = A;
+      node->b = b;
+    }
+    return FeatureSet(node);
+  }
+
+  static
+  FeatureSet
+  concatenate(const std::vector<FeatureSet> & sets)
+  {
+    auto node = std::make_shared<Node>();
+    node->size = 0;
+    for (const auto & set: sets) {
+      if (set.node_) {
+        node->children.push_back(set.node_);
+        node->size += set.node_->size;
+      }
+    }
+    if (node->children.empty()) {
+      return {};
+    }
+    if (node->children.size() == 1) {
+      return FeatureSet(node->children[0]);
+    }
+    return FeatureSet(node);
+  }
+
+  size_t
+  size() const
+  {
+    return node_ ? node_->size : 0;
+  }
+
+  // Calls f(polyline, A, b) for every polyline; its actual points are A * x + b.
+  template <typename F>
+  void
+  for_each_polyline(const F & f) const
+  {
+    if (node_) {
+      visit(*node_, Eigen::Matrix3d::Identity(), Eigen::Vector3d::Zero(), f);
+    }
+  }
+
+  Polylines
+  materialize() const
+  {
+    Polylines polylines;
+    polylines.reserve(size());
+    for_each_polyline([&](
+          const std::vector<std::array<double, 3>> & polyline,
+          const Eigen::Matrix3d & A,
+          const Eigen::Vector3d & b
+          ) {
+      std::vector<std::array<double, 3>> points;
+      points.reserve(polyline.size());
+      for (const auto & x: polyline) {
+        const Eigen::Vector3d y = A * Eigen::Vector3d(x.data()) + b;
+        points.push_back({y[0], y[1], y[2]});
+      }
+      polylines.push_back(points);
+    });
+    return polylines;
+  }
+
+  private:
+  // Either a leaf with polylines or a concatenation of children, mapped by A x + b.
+  struct Node {
+    std::shared_ptr<const Polylines> polylines;
+    std::vector<std::shared_ptr<const Node>> children;
+    Eigen::Matrix3d A = Eigen::Matrix3d::Identity();
+    Eigen::Vector3d b = Eigen::Vector3d::Zero();
+    size_t size;
+  };
+
+  explicit FeatureSet(const std::shared_ptr<const Node> & node):
+    node_(node)
+  {
+  }
+
+  template <typename F>
+  static
+  void
+  visit(
+      const Node & node,
+      const Eigen::Matrix3d & A,
+      const Eigen::Vector3d & b,
+      const F & f
+      )
+  {
+    const Eigen::Matrix3d A2 = A * node.A;
+    const Eigen::Vector3d b2 = A * node.b + b;
+    if (node.polylines) {
+      for (const auto & polyline: *node.polylines) {
+        f(polyline, A2, b2);
+      }
+    }
+    for (const auto & child: node.children) {
+      visit(*child, A2, b2, f);
+    }
+  }
+
+  private:
+    std::shared_ptr<const Node> node_;
+};
+
+} // namespace pygalmesh
+
+#endif // FEATURE_SET_HPP
@@ -1,6 +1,14 @@
 #define CGAL_MESH_3_VERBOSE 1
 
 #include "generate.hpp"
+#include "c3t3_io.hpp"
+#include "c3t3_result.hpp"
+#include "call_state.hpp"
+#include "compiled_domain.hpp"
+#include "controlled_mesh_3.hpp"
+#include "mesh_criteria.hpp"
+#include "parallel.hpp"
+#include "partition.hpp"
 
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 
@@ -12,6 +20,12 @@
 
 #include <CGAL/Mesh_domain_with_polyline_features_3.h>
 #include <CGAL/make_mesh_3.h>
+#include <CGAL/refine_mesh_3.h>
+
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <thread>
 
 namespace pygalmesh {
 
@@ -19,15 +33,19 @@ typedef CGAL::Exact_predicates_inexact_constructions_kernel K;
 
 typedef CGAL::Mesh_domain_with_polyline_features_3<CGAL::Labeled_mesh_domain_3<K>> Mesh_domain;
 
-// Triangulation
-typedef CGAL::Mesh_triangulation_3<Mesh_domain>::type Tr;
-typedef CGAL::Mesh_complex_3_in_triangulation_3<Tr> C3t3;
+// Triangulation and criteria, for CGAL::Sequential_tag or CGAL::Parallel_tag
+template <typename Concurrency_tag>
+struct Mesh_types
+{
+  typedef typename CGAL::Mesh_triangulation_3<Mesh_domain, CGAL::Default, Concurrency_tag>::type Tr;
+  typedef CGAL::Mesh_complex_3_in_triangulation_3<Tr> C3t3;
 
-// Mesh Criteria
-typedef CGAL::Mesh_criteria_3<Tr> Mesh_criteria;
-typedef Mesh_criteria::Edge_criteria Edge_criteria;
-typedef Mesh_criteria::Facet_criteria Facet_criteria;
-typedef Mesh_criteria::Cell_criteria Cell_criteria;
+  // Mesh Criteria
+  typedef CGAL::Mesh_criteria_3<Tr> Mesh_criteria;
+  typedef typename Mesh_criteria::Edge_criteria Edge_criteria;
+  typedef typename Mesh_criteria::Facet_criteria Facet_criteria;
+  typedef typename Mesh_criteria::Cell_criteria Cell_criteria;
+};
 
 namespace {
 
@@ -48,158 +66,250 @@ convert_feature_edges(
   return polylines;
 }
 
-template <typename T>
-void
+// Materializes a feature set directly into CGAL polylines; the transformations are
+// applied on the fly.
+std::list<std::vector<K::Point_3>>
+convert_feature_set(
+    const FeatureSet & feature_set
+    )
+{
+  std::list<std::vector<K::Point_3>> polylines;
+  feature_set.for_each_polyline([&](
+        const std::vector<std::array<double, 3>> & feature_edge,
+        const Eigen::Matrix3d & A,
+        const Eigen::Vector3d & b
+        ) {
+    std::vector<K::Point_3> polyline;
+    polyline.reserve(feature_edge.size());
+    for (const auto & point: feature_edge) {
+      const Eigen::Vector3d p = A * Eigen::Vector3d(point.data()) + b;
+      polyline.push_back(K::Point_3(p[0], p[1], p[2]));
+    }
+    polylines.push_back(std::move(polyline));
+  });
+  return polylines;
+}
+
+// The CGAL mesh domain of a DomainBase, including its features. The tree is lowered
+// into a flat program first; the implicit mesh domain only looks at the sign, so
+// classify() suffices.
+class ImplicitDomain
+{
+  public:
+  template <typename Bounds>
+  ImplicitDomain(
+      const std::shared_ptr<pygalmesh::DomainBase> & domain,
+      const Bounds & domain_bounds,
+      const DomainBase::Features & extra_feature_edges
+      ):
+    compiled_domain_(domain),
+    cgal_domain_(Mesh_domain::create_implicit_mesh_domain(
+          [this](K::Point_3 p) {
+            return double(compiled_domain_.classify({p.x(), p.y(), p.z()}));
+          },
+          domain_bounds))
+  {
+    // cgal_domain_.detect_features();
+
+    const auto native_features = convert_feature_set(domain->get_feature_set());
+    cgal_domain_.add_features(native_features.begin(), native_features.end());
+
+    const auto polylines = convert_feature_edges(extra_feature_edges);
+    cgal_domain_.add_features(polylines.begin(), polylines.end());
+  }
+
+  // the mesh domain refers to this object
+  ImplicitDomain(const ImplicitDomain &) = delete;
+  ImplicitDomain & operator=(const ImplicitDomain &) = delete;
+
+  const Mesh_domain &
+  get() const
+  {
+    return cgal_domain_;
+  }
+
+  private:
+    const CompiledDomain compiled_domain_;
+    Mesh_domain cgal_domain_;
+};
+
+// The sizing fields are captured by value, so the criteria may outlive the options.
+template <typename Concurrency_tag>
+typename Mesh_types<Concurrency_tag>::Mesh_criteria
+make_criteria(const MeshingOptions & options)
+{
+  return make_mesh_criteria<typename Mesh_types<Concurrency_tag>::Mesh_criteria, Mesh_domain>(
+      options
+      );
+}
+
+// A mesh of generate_mesh(). It keeps the domain, its bounds and the extra features,
+// so the mesh can be refined further or restored from a file.
+template <typename Concurrency_tag, typename Bounds>
+class ImplicitDomainResult: public C3t3Result<typename Mesh_types<Concurrency_tag>::C3t3>
+{
+  typedef typename Mesh_types<Concurrency_tag>::C3t3 C3t3;
+
+  public:
+  ImplicitDomainResult(
+      C3t3 & c3t3,
+      const std::shared_ptr<pygalmesh::DomainBase> & domain,
+      const Bounds & domain_bounds,
+      const DomainBase::Features & extra_feature_edges
+      ):
+    C3t3Result<C3t3>(c3t3),
+    domain_(domain),
+    domain_bounds_(domain_bounds),
+    extra_feature_edges_(extra_feature_edges)
+  {
+  }
+
+  virtual
+  void
+  save(const std::string & filename) const
+  {
+    save_c3t3(filename, this->complex());
+  }
+
+  virtual
+  void
+  refine(const MeshingOptions & options, MeshingControl * control)
+  {
+    const ScopedSeed scoped_seed(options.seed);
+    const ImplicitDomain cgal_domain(domain_, domain_bounds_, extra_feature_edges_);
+    const QuietOutput quiet_output(!options.verbose);
+    with_concurrency(Concurrency_tag(), options.num_threads, options.verbose, [&](auto) {
+      if (control) {
+        refine_mesh_3_controlled(
+            this->mutable_complex(), cgal_domain.get(), make_criteria<Concurrency_tag>(options),
+            options, *control
+            );
+        return;
+      }
+      CGAL::refine_mesh_3(
+          this->mutable_complex(),
+          cgal_domain.get(),
+          make_criteria<Concurrency_tag>(options),
+          options.lloyd ? CGAL::parameters::lloyd(CGAL::parameters::default_values()) : CGAL::parameters::no_lloyd(),
+          options.odt ? CGAL::parameters::odt(CGAL::parameters::default_values()) : CGAL::parameters::no_odt(),
+          options.perturb ? CGAL::parameters::perturb() : CGAL::parameters::no_perturb(),
+          options.exude ?
+            CGAL::parameters::exude(
+              CGAL::parameters::time_limit = options.exude_time_limit,
+              CGAL::parameters::sliver_bound = options.exude_sliver_bound
+            ) :
+            CGAL::parameters::no_exude()
+          );
+    });
+    this->renumber_vertices();
+  }
+
+  private:
+    const std::shared_ptr<pygalmesh::DomainBase> domain_;
+    const Bounds domain_bounds_;
+    const DomainBase::Features extra_feature_edges_;
+};
+
+template <typename Concurrency_tag, typename T>
+std::shared_ptr<MeshResult>
 generate_mesh(
     const std::shared_ptr<pygalmesh::DomainBase> & domain,
-    const std::string & outfile,
     const T& domain_bounds,
     const DomainBase::Features & extra_feature_edges,
-    const bool lloyd,
-    const bool odt,
-    const bool perturb,
-    const bool exude,
-    //
-    const double min_edge_size_at_feature_edges,
-    //
-    const double max_edge_size_at_feature_edges_value,
-    const std::shared_ptr<pygalmesh::SizingFieldBase> & max_edge_size_at_feature_edges_field,
-    //
-    const double min_facet_angle,
-    //
-    const double max_radius_surface_delaunay_ball_value,
-    const std::shared_ptr<pygalmesh::SizingFieldBase> & max_radius_surface_delaunay_ball_field,
-    //
-    const double max_facet_distance_value,
-    const std::shared_ptr<pygalmesh::SizingFieldBase> & max_facet_distance_field,
-    //
-    const double max_circumradius_edge_ratio,
-    //
-    const double max_cell_circumradius_value,
-    const std::shared_ptr<pygalmesh::SizingFieldBase> & max_cell_circumradius_field,
-    //
-    const double exude_time_limit,
-    const double exude_sliver_bound,
-    //
-    const bool verbose,
-    const int seed
+    const MeshingOptions & options,
+    MeshingControl * control = nullptr
     )
 {
-  CGAL::get_default_random() = CGAL::Random(seed);
-
-  // wrap domain
-  const auto d = [&](K::Point_3 p) {
-    return domain->eval({p.x(), p.y(), p.z()});
-  };
+  typedef typename Mesh_types<Concurrency_tag>::C3t3 C3t3;
 
-  Mesh_domain cgal_domain =
-    Mesh_domain::create_implicit_mesh_domain(d, domain_bounds);
+  const ScopedSeed scoped_seed(options.seed);
 
-  // cgal_domain.detect_features();
+  const ImplicitDomain cgal_domain(domain, domain_bounds, extra_feature_edges);
 
-  const auto native_features = convert_feature_edges(domain->get_features());
-  cgal_domain.add_features(native_features.begin(), native_features.end());
+  const QuietOutput quiet_output(!options.verbose);
 
-  const auto polylines = convert_feature_edges(extra_feature_edges);
-  cgal_domain.add_features(polylines.begin(), polylines.end());
-
-  // perhaps there's a more elegant solution here
-  // see <https://github.com/CGAL/cgal/issues/1286>
-  if (!verbose) {
-    // suppress output
-    std::cerr.setstate(std::ios_base::failbit);
+  if (control) {
+    C3t3 c3t3 = make_mesh_3_controlled<C3t3>(
+        cgal_domain.get(), make_criteria<Concurrency_tag>(options), options, *control
+        );
+    return std::make_shared<ImplicitDomainResult<Concurrency_tag, T>>(
+        c3t3, domain, domain_bounds, extra_feature_edges
+        );
   }
 
-  // Build the float/field values according to
-  // <https://github.com/CGAL/cgal/issues/5044#issuecomment-705526982>.
-
-  // nested ternary operator
-  const auto facet_criteria = max_radius_surface_delaunay_ball_field ? (
-      max_facet_distance_field ?
-      Facet_criteria(
-        min_facet_angle,
-        [&](K::Point_3 p, const int, const Mesh_domain::Index&) {
-          return max_radius_surface_delaunay_ball_field->eval({p.x(), p.y(), p.z()});
-        },
-        [&](K::Point_3 p, const int, const Mesh_domain::Index&) {
-          return max_facet_distance_field->eval({p.x(), p.y(), p.z()});
-        }
-      ) : Facet_criteria(
-        min_facet_angle,
-        [&](K::Point_3 p, const int, const Mesh_domain::Index&) {
-          return max_radius_surface_delaunay_ball_field->eval({p.x(), p.y(), p.z()});
-        },
-        max_facet_distance_value
-      )
-    ) : (
-      max_facet_distance_field ?
-      Facet_criteria(
-        min_facet_angle,
-        max_radius_surface_delaunay_ball_value,
-         [&](K::Point_3 p, const int, const Mesh_domain::Index&) {
-           return max_facet_distance_field->eval({p.x(), p.y(), p.z()});
-         }
-      ) : Facet_criteria(
-        min_facet_angle,
-        max_radius_surface_delaunay_ball_value,
-        max_facet_distance_value
-      )
-    );
-
-  const auto edge_criteria = max_edge_size_at_feature_edges_field ?
-    Edge_criteria(
-      [&](K::Point_3 p, const int, const Mesh_domain::Index&) {
-        return max_edge_size_at_feature_edges_field->eval({p.x(), p.y(), p.z()});
-      },
-      min_edge_size_at_feature_edges
-    ) : Edge_criteria(
-      max_edge_size_at_feature_edges_value,
-      min_edge_size_at_feature_edges
-    );
-
-  const auto cell_criteria = max_cell_circumradius_field ?
-     Cell_criteria(
-         max_circumradius_edge_ratio,
-         [&](K::Point_3 p, const int, const Mesh_domain::Index&) {
-           return max_cell_circumradius_field->eval({p.x(), p.y(), p.z()});
-          }) : Cell_criteria(max_circumradius_edge_ratio, max_cell_circumradius_value);
-
-  const auto criteria = Mesh_criteria(edge_criteria, facet_criteria, cell_criteria);
-
   // Mesh generation
   C3t3 c3t3 = CGAL::make_mesh_3<C3t3>(
-      cgal_domain,
-      criteria,
-      lloyd ? CGAL::parameters::lloyd(CGAL::parameters::default_values()) : CGAL::parameters::no_lloyd(),
-      odt ? CGAL::parameters::odt(CGAL::parameters::default_values()) : CGAL::parameters::no_odt(),
-      perturb ? CGAL::parameters::perturb() : CGAL::parameters::no_perturb(),
-      exude ?
+      cgal_domain.get(),
+      make_criteria<Concurrency_tag>(options),
+      options.lloyd ? CGAL::parameters::lloyd(CGAL::parameters::default_values()) : CGAL::parameters::no_lloyd(),
+      options.odt ? CGAL::parameters::odt(CGAL::parameters::default_values()) : CGAL::parameters::no_odt(),
+      options.perturb ? CGAL::parameters::perturb() : CGAL::parameters::no_perturb(),
+      options.exude ?
         CGAL::parameters::exude(
-          CGAL::parameters::time_limit = exude_time_limit,
-          CGAL::parameters::sliver_bound = exude_sliver_bound
+          CGAL::parameters::time_limit = options.exude_time_limit,
+          CGAL::parameters::sliver_bound = options.exude_sliver_bound
         ) :
         CGAL::parameters::no_exude()
       );
-  if (!verbose) {
-    std::cerr.clear();
-  }
 
-  // Output
-  std::ofstream medit_file(outfile);
-  c3t3.output_to_medit(medit_file);
-  medit_file.close();
-
-  return;
+  return std::make_shared<ImplicitDomainResult<Concurrency_tag, T>>(
+      c3t3, domain, domain_bounds, extra_feature_edges
+      );
 }
 
+// Restores a mesh saved by ImplicitDomainResult::save().
+template <typename Concurrency_tag, typename T>
+std::shared_ptr<MeshResult>
+load_mesh(
+    const std::string & filename,
+    const std::shared_ptr<pygalmesh::DomainBase> & domain,
+    const T& domain_bounds,
+    const DomainBase::Features & extra_feature_edges
+    )
+{
+  typename Mesh_types<Concurrency_tag>::C3t3 c3t3;
+  load_c3t3(filename, c3t3);
+  return std::make_shared<ImplicitDomainResult<Concurrency_tag, T>>(
+      c3t3, domain, domain_bounds, extra_feature_edges
+      );
 }
 
-void
-generate_mesh(
+K::Sphere_3
+bounding_sphere(
     const std::shared_ptr<pygalmesh::DomainBase> & domain,
-    const std::string & outfile,
-    const DomainBase::Features & extra_feature_edges,
-    const double bounding_sphere_radius,
+    const double bounding_sphere_radius
+    )
+{
+  const double bounding_sphere_radius2 = bounding_sphere_radius > 0 ?
+    bounding_sphere_radius*bounding_sphere_radius :
+    // some wiggle room
+    1.01 * domain->get_bounding_sphere_squared_radius();
+
+  return K::Sphere_3(CGAL::ORIGIN, bounding_sphere_radius2);
+}
+
+K::Iso_cuboid_3
+bounding_cuboid_with_margin(const std::array<double, 6> & bounding_cuboid)
+{
+  // some wiggle room
+  const double eps = 0.01 * std::max({
+    std::abs(bounding_cuboid[3] - bounding_cuboid[0]),
+    std::abs(bounding_cuboid[4] - bounding_cuboid[1]),
+    std::abs(bounding_cuboid[5] - bounding_cuboid[2])
+  });
+
+  return K::Iso_cuboid_3(
+      bounding_cuboid[0] - eps,
+      bounding_cuboid[1] - eps,
+      bounding_cuboid[2] - eps,
+      bounding_cuboid[3] + eps,
+      bounding_cuboid[4] + eps,
+      bounding_cuboid[5] + eps
+      );
+}
+
+MeshingOptions
+to_options(
     const bool lloyd,
     const bool odt,
     const bool perturb,
@@ -227,32 +337,142 @@ generate_mesh(
     const double exude_sliver_bound,
     //
     const bool verbose,
-    const int seed
+    const int seed,
+    const int num_threads
     )
 {
-  const double bounding_sphere_radius2 = bounding_sphere_radius > 0 ?
-    bounding_sphere_radius*bounding_sphere_radius :
-    // some wiggle room
-    1.01 * domain->get_bounding_sphere_squared_radius();
+  MeshingOptions options;
+  options.lloyd = lloyd;
+  options.odt = odt;
+  options.perturb = perturb;
+  options.exude = exude;
+  options.min_edge_size_at_feature_edges = min_edge_size_at_feature_edges;
+  options.max_edge_size_at_feature_edges_value = max_edge_size_at_feature_edges_value;
+  options.max_edge_size_at_feature_edges_field = max_edge_size_at_feature_edges_field;
+  options.min_facet_angle = min_facet_angle;
+  options.max_radius_surface_delaunay_ball_value = max_radius_surface_delaunay_ball_value;
+  options.max_radius_surface_delaunay_ball_field = max_radius_surface_delaunay_ball_field;
+  options.max_facet_distance_value = max_facet_distance_value;
+  options.max_facet_distance_field = max_facet_distance_field;
+  options.max_circumradius_edge_ratio = max_circumradius_edge_ratio;
+  options.max_cell_circumradius_value = max_cell_circumradius_value;
+  options.max_cell_circumradius_field = max_cell_circumradius_field;
+  options.exude_time_limit = exude_time_limit;
+  options.exude_sliver_bound = exude_sliver_bound;
+  options.verbose = verbose;
+  options.seed = seed;
+  options.num_threads = num_threads;
+  return options;
+}
 
-  generate_mesh(
-    domain, outfile, K::Sphere_3(CGAL::ORIGIN, bounding_sphere_radius2),
-    extra_feature_edges, lloyd, odt, perturb, exude,
-    min_edge_size_at_feature_edges, max_edge_size_at_feature_edges_value, max_edge_size_at_feature_edges_field,
-    min_facet_angle,
-    max_radius_surface_delaunay_ball_value, max_radius_surface_delaunay_ball_field,
-    max_facet_distance_value, max_facet_distance_field,
-    max_circumradius_edge_ratio,
-    max_cell_circumradius_value, max_cell_circumradius_field,
-    exude_time_limit, exude_sliver_bound,
-    verbose, seed);
+// samples per block edge for finding the curves along which the blocks cut the domain
+constexpr int block_samples = 64;
+
+// Meshes one block of a partitioned domain, with the grid lines of counts intervals
+// on the faces it shares with a neighbor in cuboid. Of the edges, only those on the
+// input features are kept, labeled by the number of the feature.
+MeshData
+mesh_block(
+    const std::shared_ptr<const CompiledDomain> & domain,
+    const Block & block,
+    const Block & cuboid,
+    const std::array<int, 3> & counts,
+    const std::vector<Polyline> & features,
+    const MeshingOptions & options
+    )
+{
+  std::vector<int> origin;
+  std::vector<Polyline> block_edges = clip_polylines(features, block, origin);
+  const size_t num_input_features = block_edges.size();
+  const auto cuts = block_features(*domain, block, cuboid, block_samples, counts);
+  block_edges.insert(block_edges.end(), cuts.begin(), cuts.end());
+
+  const K::Iso_cuboid_3 bounds = bounding_cuboid_with_margin({
+      block.lo[0], block.lo[1], block.lo[2],
+      block.hi[0], block.hi[1], block.hi[2]
+      });
+  const auto result = generate_mesh<CGAL::Sequential_tag>(
+      std::make_shared<BlockDomain>(domain, block), bounds, block_edges, options
+      );
+  MeshData data = collect_mesh_data(*result);
+
+  // curves are numbered 1, 2, ... in the order they were added
+  size_t m = 0;
+  for (size_t k = 0; k < data.edge_curves.size(); k++) {
+    const int curve = data.edge_curves[k];
+    if (curve >= 1 && size_t(curve) <= num_input_features) {
+      data.edges[2 * m] = data.edges[2 * k];
+      data.edges[2 * m + 1] = data.edges[2 * k + 1];
+      data.edge_curves[m] = origin[curve - 1] + 1;
+      m++;
+    }
+  }
+  data.edges.resize(2 * m);
+  data.edge_curves.resize(m);
+  return data;
 }
 
-void
-generate_mesh(
+}
+
+std::shared_ptr<MeshResult>
+generate_mesh(const MeshJob & job, MeshingControl * control)
+{
+  std::shared_ptr<MeshResult> result;
+  with_concurrency(job.options.num_threads, job.options.verbose, [&](auto tag) {
+    if (job.has_bounding_cuboid) {
+      result = generate_mesh<decltype(tag)>(
+          job.domain, bounding_cuboid_with_margin(job.bounding_cuboid),
+          job.extra_feature_edges, job.options, control
+          );
+    } else {
+      result = generate_mesh<decltype(tag)>(
+          job.domain, bounding_sphere(job.domain, job.bounding_sphere_radius),
+          job.extra_feature_edges, job.options, control
+          );
+    }
+  });
+  return result;
+}
+
+std::shared_ptr<MeshResult>
+load_mesh(
+    const std::string & filename,
+    const std::shared_ptr<pygalmesh::DomainBase> & domain,
+    const DomainBase::Features & extra_feature_edges,
+    const double bounding_sphere_radius,
+    const int num_threads
+    )
+{
+  const K::Sphere_3 bounds = bounding_sphere(domain, bounding_sphere_radius);
+  std::shared_ptr<MeshResult> result;
+  with_concurrency(num_threads, false, [&](auto tag) {
+    result = load_mesh<decltype(tag)>(filename, domain, bounds, extra_feature_edges);
+  });
+  return result;
+}
+
+std::shared_ptr<MeshResult>
+load_mesh(
+    const std::string & filename,
+    const std::shared_ptr<pygalmesh::DomainBase> & domain,
+    const std::array<double, 6> bounding_cuboid,
+    const DomainBase::Features & extra_feature_edges,
+    const int num_threads
+    )
+{
+  const K::Iso_cuboid_3 cuboid = bounding_cuboid_with_margin(bounding_cuboid);
+  std::shared_ptr<MeshResult> result;
+  with_concurrency(num_threads, false, [&](auto tag) {
+    result = load_mesh<decltype(tag)>(filename, domain, cuboid, extra_feature_edges);
+  });
+  return result;
+}
+
+MeshData
+generate_mesh_partitioned(
     const std::shared_ptr<pygalmesh::DomainBase> & domain,
-    const std::string & outfile,
     const std::array<double, 6> bounding_cuboid,
+    const std::array<int, 3> num_blocks,
     const DomainBase::Features & extra_feature_edges,
     const bool lloyd,
     const bool odt,
@@ -281,35 +501,114 @@ generate_mesh(
     const double exude_sliver_bound,
     //
     const bool verbose,
-    const int seed
+    const int seed,
+    const int num_workers
     )
 {
-  // some wiggle room
-  const double eps = 0.01 * std::max({
-    std::abs(bounding_cuboid[3] - bounding_cuboid[0]),
-    std::abs(bounding_cuboid[4] - bounding_cuboid[1]),
-    std::abs(bounding_cuboid[5] - bounding_cuboid[2])
-  });
+  const auto grid = block_grid(bounding_cuboid, num_blocks);
+  const std::vector<Block> blocks = split_cuboid(grid);
+  const MeshingOptions options = to_options(
+      lloyd, odt, perturb, exude,
+      min_edge_size_at_feature_edges, max_edge_size_at_feature_edges_value, max_edge_size_at_feature_edges_field,
+      min_facet_angle,
+      max_radius_surface_delaunay_ball_value, max_radius_surface_delaunay_ball_field,
+      max_facet_distance_value, max_facet_distance_field,
+      max_circumradius_edge_ratio,
+      max_cell_circumradius_value, max_cell_circumradius_field,
+      exude_time_limit, exude_sliver_bound,
+      verbose, seed, 0
+      );
 
-  K::Iso_cuboid_3 cuboid(
-      bounding_cuboid[0] - eps,
-      bounding_cuboid[1] - eps,
-      bounding_cuboid[2] - eps,
-      bounding_cuboid[3] + eps,
-      bounding_cuboid[4] + eps,
-      bounding_cuboid[5] + eps
+  // compiled once, evaluated by all workers
+  const auto compiled_domain = std::make_shared<const CompiledDomain>(domain);
+  std::vector<Polyline> features = domain->get_feature_set().materialize();
+  features.insert(features.end(), extra_feature_edges.begin(), extra_feature_edges.end());
+
+  // The same grid lines on both sides of a face, so the intervals depend on the
+  // feature edge size only.
+  const Block cuboid = {
+    {bounding_cuboid[0], bounding_cuboid[1], bounding_cuboid[2]},
+    {bounding_cuboid[3], bounding_cuboid[4], bounding_cuboid[5]}
+  };
+  double edge_size = options.max_edge_size_at_feature_edges_value;
+  if (options.max_edge_size_at_feature_edges_field) {
+    for (const auto & block: blocks) {
+      edge_size = std::min(edge_size, options.max_edge_size_at_feature_edges_field->eval(block.lo));
+    }
+  }
+  const std::array<int, 3> counts = face_grid_counts(blocks[0], edge_size, block_samples);
+
+  std::vector<MeshData> parts(blocks.size());
+  std::vector<std::exception_ptr> errors(blocks.size());
+  std::atomic<size_t> next_block(0);
+  const auto work = [&]() {
+    const QuietOutput quiet_output(!verbose);
+    for (size_t b = next_block++; b < blocks.size(); b = next_block++) {
+      try {
+        parts[b] = mesh_block(compiled_domain, blocks[b], cuboid, counts, features, options);
+      } catch (...) {
+        errors[b] = std::current_exception();
+      }
+    }
+  };
+  const size_t num_threads = std::min(
+      blocks.size(),
+      size_t(num_workers > 0 ? num_workers : std::max(1u, std::thread::hardware_concurrency()))
       );
+  std::vector<std::thread> threads;
+  for (size_t k = 1; k < num_threads; k++) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto & thread: threads) {
+    thread.join();
+  }
+  for (const auto & error: errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  MeshData data;
+  for (auto & part: parts) {
+    const int offset = int(data.points.size() / 3);
+    data.points.insert(data.points.end(), part.points.begin(), part.points.end());
+    const auto append = [&](std::vector<int> & cells, const std::vector<int> & more) {
+      for (const int k: more) {
+        cells.push_back(k + offset);
+      }
+    };
+    append(data.tetras, part.tetras);
+    append(data.triangles, part.triangles);
+    append(data.edges, part.edges);
+    const auto append_labels = [](std::vector<int> & labels, const std::vector<int> & more) {
+      labels.insert(labels.end(), more.begin(), more.end());
+    };
+    append_labels(data.tetra_subdomains, part.tetra_subdomains);
+    append_labels(data.triangle_patches, part.triangle_patches);
+    append_labels(data.edge_curves, part.edge_curves);
+    part = MeshData();
+  }
 
-  generate_mesh(
-    domain, outfile, cuboid, extra_feature_edges, lloyd, odt, perturb, exude,
-    min_edge_size_at_feature_edges, max_edge_size_at_feature_edges_value, max_edge_size_at_feature_edges_field,
-    min_facet_angle,
-    max_radius_surface_delaunay_ball_value, max_radius_surface_delaunay_ball_field,
-    max_facet_distance_value, max_facet_distance_field,
-    max_circumradius_edge_ratio,
-    max_cell_circumradius_value, max_cell_circumradius_field,
-    exude_time_limit, exude_sliver_bound,
-    verbose, seed);
+  // Only points on the planes between blocks can appear in more than one block.
+  // Points on protected curves are placed exactly, other surface points up to the
+  // default relative error bound of the mesh domain, 1e-3 of its diameter, off.
+  std::array<std::vector<double>, 3> interfaces;
+  double extent = 0.0;
+  double block_diameter2 = 0.0;
+  for (int a = 0; a < 3; a++) {
+    interfaces[a].assign(grid[a].begin() + 1, grid[a].end() - 1);
+    extent = std::max(extent, bounding_cuboid[a + 3] - bounding_cuboid[a]);
+    block_diameter2 += (grid[a][1] - grid[a][0]) * (grid[a][1] - grid[a][0]);
+  }
+  weld_points(data, interfaces, 1.0e-10 * extent);
+  if (drop_facets_on_planes(data, interfaces, 2.0e-3 * std::sqrt(block_diameter2)) > 0) {
+    throw std::runtime_error(
+        "The blocks don't conform on the faces between them. "
+        "Try a smaller max_edge_size_at_feature_edges."
+        );
+  }
+  return data;
 }
 
 } // namespace pygalmesh
@@ -2,6 +2,10 @@
 #define GENERATE_HPP
 
 #include "domain.hpp"
+#include "mesh_data.hpp"
+#include "mesh_result.hpp"
+#include "meshing_control.hpp"
+#include "meshing_options.hpp"
 #include "sizing_field.hpp"
 
 #include <functional>
@@ -11,11 +15,32 @@
 
 namespace pygalmesh {
 
-void generate_mesh(
+// The input of one generate_mesh() call, for running many of them in a batch.
+struct MeshJob {
+  std::shared_ptr<pygalmesh::DomainBase> domain;
+  DomainBase::Features extra_feature_edges;
+  double bounding_sphere_radius = 0.0;
+  // used instead of the bounding sphere if set
+  bool has_bounding_cuboid = false;
+  std::array<double, 6> bounding_cuboid = {};
+  MeshingOptions options;
+};
+
+// The control, if given, bounds the run in time and vertices and may stop it early;
+// the mesh is returned as far as it got. Without one, this is a plain make_mesh_3()
+// call.
+std::shared_ptr<MeshResult> generate_mesh(const MeshJob & job, MeshingControl * control = nullptr);
+
+// Meshes the domain in num_blocks blocks of the bounding cuboid, num_workers at a time
+// (0 for one per core), and merges the blocks. The curves along which the blocks cut
+// the domain, and a grid of lines on the faces between blocks, are protected on both
+// sides, so the blocks mesh these faces alike. The points on them are welded; throws
+// if a facet on a face between blocks has no twin on the other side.
+MeshData generate_mesh_partitioned(
     const std::shared_ptr<pygalmesh::DomainBase> & domain,
-    const std::string & outfile,
+    const std::array<double, 6> bounding_cuboid,
+    const std::array<int, 3> num_blocks,
     const DomainBase::Features & extra_feature_edges = {},
-    const double bounding_sphere_radius = 0.0,
     const bool lloyd = false,
     const bool odt = false,
     const bool perturb = true,
@@ -43,42 +68,27 @@ void generate_mesh(
     const double exude_sliver_bound = 0.0,
     //
     const bool verbose = true,
-    const int seed = 0
+    const int seed = 0,
+    const int num_workers = 0
+    );
+
+// Restores a mesh written by MeshResult::save() for generate_mesh(). The domain,
+// bounds and features must be the ones it was generated with, as well as whether it
+// was generated in parallel (num_threads != 0).
+std::shared_ptr<MeshResult> load_mesh(
+    const std::string & filename,
+    const std::shared_ptr<pygalmesh::DomainBase> & domain,
+    const DomainBase::Features & extra_feature_edges = {},
+    const double bounding_sphere_radius = 0.0,
+    const int num_threads = 0
     );
 
-void generate_mesh(
+std::shared_ptr<MeshResult> load_mesh(
+    const std::string & filename,
     const std::shared_ptr<pygalmesh::DomainBase> & domain,
-    const std::string & outfile,
     const std::array<double, 6> bounding_cuboid,
     const DomainBase::Features & extra_feature_edges = {},
-    const bool lloyd = false,
-    const bool odt = false,
-    const bool perturb = true,
-    const bool exude = true,
-    //
-    const double min_edge_size_at_feature_edges = 0.0,
-    //
-    const double max_edge_size_at_feature_edges_value = std::numeric_limits<double>::max(),
-    const std::shared_ptr<pygalmesh::SizingFieldBase> & max_edge_size_at_feature_edges_field = nullptr,
-    //
-    const double min_facet_angle = 0.0,
-    //
-    const double max_radius_surface_delaunay_ball_value = 0.0,
-    const std::shared_ptr<pygalmesh::SizingFieldBase> & max_radius_surface_delaunay_ball_field = nullptr,
-    //
-    const double max_facet_distance_value = 0.0,
-    const std::shared_ptr<pygalmesh::SizingFieldBase> & max_facet_distance_field = nullptr,
-    //
-    const double max_circumradius_edge_ratio = 0.0,
-    //
-    const double max_cell_circumradius_value = 0.0,
-    const std::shared_ptr<pygalmesh::SizingFieldBase> & max_cell_circumradius_field = nullptr,
-    //
-    const double exude_time_limit = 0.0,
-    const double exude_sliver_bound = 0.0,
-    //
-    const bool verbose = true,
-    const int seed = 0
+    const int num_threads = 0
     );
 
 } // namespace pygalmesh
@@ -1,11 +1,20 @@
 #define CGAL_MESH_3_VERBOSE 1
 
 #include "generate_from_inr.hpp"
+#include "c3t3_io.hpp"
+#include "c3t3_result.hpp"
+#include "call_state.hpp"
+#include "controlled_mesh_3.hpp"
+#include "mesh_criteria.hpp"
+#include "parallel.hpp"
 
 #include <cassert>
+#include <new>
+#include <stdexcept>
 
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/Image_3.h>
+#include <CGAL/ImageIO.h>
 
 #include <CGAL/Mesh_triangulation_3.h>
 #include <CGAL/Mesh_complex_3_in_triangulation_3.h>
@@ -15,6 +24,7 @@
 
 #include <CGAL/Mesh_domain_with_polyline_features_3.h>
 #include <CGAL/make_mesh_3.h>
+#include <CGAL/refine_mesh_3.h>
 
 namespace pygalmesh {
 
@@ -22,22 +32,90 @@ typedef CGAL::Exact_predicates_inexact_constructions_kernel K;
 
 typedef CGAL::Labeled_mesh_domain_3<K> Mesh_domain;
 
-// Triangulation
-typedef CGAL::Mesh_triangulation_3<Mesh_domain>::type Tr;
-typedef CGAL::Mesh_complex_3_in_triangulation_3<Tr> C3t3;
+// Triangulation and criteria, for CGAL::Sequential_tag or CGAL::Parallel_tag
+template <typename Concurrency_tag>
+struct Mesh_types
+{
+  typedef typename CGAL::Mesh_triangulation_3<Mesh_domain, CGAL::Default, Concurrency_tag>::type Tr;
+  typedef CGAL::Mesh_complex_3_in_triangulation_3<Tr> C3t3;
 
-// Mesh Criteria
-typedef CGAL::Mesh_criteria_3<Tr> Mesh_criteria;
-typedef Mesh_criteria::Facet_criteria Facet_criteria;
-typedef Mesh_criteria::Cell_criteria Cell_criteria;
+  // Mesh Criteria
+  typedef CGAL::Mesh_criteria_3<Tr> Mesh_criteria;
+};
 
 typedef CGAL::Mesh_constant_domain_field_3<Mesh_domain::R,
                                            Mesh_domain::Index> Sizing_field_cell;
 
-void
-generate_from_inr(
-    const std::string & inr_filename,
-    const std::string & outfile,
+namespace {
+
+// A mesh of an image file. It keeps the image, so the mesh can be refined further or
+// restored from a file. Per-subdomain cell sizes do not carry over to a refinement.
+template <typename Concurrency_tag>
+class ImageDomainResult: public C3t3Result<typename Mesh_types<Concurrency_tag>::C3t3>
+{
+  typedef typename Mesh_types<Concurrency_tag>::C3t3 C3t3;
+  typedef typename Mesh_types<Concurrency_tag>::Mesh_criteria Mesh_criteria;
+
+  public:
+  ImageDomainResult(C3t3 & c3t3, const CGAL::Image_3 & image):
+    C3t3Result<C3t3>(c3t3),
+    image_(image)
+  {
+  }
+
+  virtual
+  void
+  save(const std::string & filename) const
+  {
+    save_c3t3(filename, this->complex());
+  }
+
+  virtual
+  void
+  refine(const MeshingOptions & options, MeshingControl * control)
+  {
+    const ScopedSeed scoped_seed(options.seed);
+    Mesh_domain cgal_domain = Mesh_domain::create_labeled_image_mesh_domain(image_);
+
+    const auto criteria = make_mesh_criteria<Mesh_criteria, Mesh_domain>(options);
+
+    const QuietOutput quiet_output(!options.verbose);
+    with_concurrency(Concurrency_tag(), options.num_threads, options.verbose, [&](auto) {
+      if (control) {
+        refine_mesh_3_controlled(this->mutable_complex(), cgal_domain, criteria, options, *control);
+        return;
+      }
+      CGAL::refine_mesh_3(
+          this->mutable_complex(),
+          cgal_domain,
+          criteria,
+          options.lloyd ? CGAL::parameters::lloyd(CGAL::parameters::default_values()) : CGAL::parameters::no_lloyd(),
+          options.odt ? CGAL::parameters::odt(CGAL::parameters::default_values()) : CGAL::parameters::no_odt(),
+          options.perturb ? CGAL::parameters::perturb() : CGAL::parameters::no_perturb(),
+          options.exude ?
+            CGAL::parameters::exude(
+              CGAL::parameters::time_limit = options.exude_time_limit,
+              CGAL::parameters::sliver_bound = options.exude_sliver_bound
+            ) :
+            CGAL::parameters::no_exude()
+          );
+    });
+    this->renumber_vertices();
+  }
+
+  private:
+    // shares the data with the image the mesh was generated from
+    const CGAL::Image_3 image_;
+};
+
+// Meshes an image domain; max_cell_circumradius is a number or a sizing field. If
+// refinable_image is given, it is kept with the result for further refinement; it must
+// own its data. With reversed_axes, the x and z axes of the mesh are swapped back, see
+// wrap_image_array().
+template <typename Concurrency_tag, typename Cell_size>
+std::shared_ptr<MeshResult>
+mesh_image(
+    const Mesh_domain & cgal_domain,
     const bool lloyd,
     const bool odt,
     const bool perturb,
@@ -47,21 +125,15 @@ generate_from_inr(
     const double max_radius_surface_delaunay_ball,
     const double max_facet_distance,
     const double max_circumradius_edge_ratio,
-    const double max_cell_circumradius,
+    const Cell_size & max_cell_circumradius,
     const double exude_time_limit,
     const double exude_sliver_bound,
-    const bool verbose,
-    const int seed
+    const CGAL::Image_3 * refinable_image,
+    const bool reversed_axes
     )
 {
-  CGAL::get_default_random() = CGAL::Random(seed);
-
-  CGAL::Image_3 image;
-  const bool success = image.read(inr_filename.c_str());
-  if (!success) {
-    throw "Could not read image file";
-  }
-  Mesh_domain cgal_domain = Mesh_domain::create_labeled_image_mesh_domain(image);
+  typedef typename Mesh_types<Concurrency_tag>::C3t3 C3t3;
+  typedef typename Mesh_types<Concurrency_tag>::Mesh_criteria Mesh_criteria;
 
   Mesh_criteria criteria(
       CGAL::parameters::edge_size=max_edge_size_at_feature_edges,
@@ -72,11 +144,6 @@ generate_from_inr(
       CGAL::parameters::cell_size=max_cell_circumradius
       );
 
-  // Mesh generation
-  if (!verbose) {
-    // suppress output
-    std::cerr.setstate(std::ios_base::failbit);
-  }
   C3t3 c3t3 = CGAL::make_mesh_3<C3t3>(
       cgal_domain,
       criteria,
@@ -90,22 +157,60 @@ generate_from_inr(
         ) :
         CGAL::parameters::no_exude()
       );
-  if (!verbose) {
-    std::cerr.clear();
-  }
 
-  // Output
-  std::ofstream medit_file(outfile);
-  c3t3.output_to_medit(medit_file);
-  medit_file.close();
-  return;
+  if (refinable_image) {
+    return std::make_shared<ImageDomainResult<Concurrency_tag>>(c3t3, *refinable_image);
+  }
+  auto result = std::make_shared<C3t3Result<C3t3>>(c3t3);
+  if (reversed_axes) {
+    result->swap_x_and_z();
+  }
+  return result;
 }
 
+// Meshes a labeled image with a uniform bound on the cell size.
+std::shared_ptr<MeshResult>
+mesh_labeled_image(
+    const CGAL::Image_3 & image,
+    const bool lloyd,
+    const bool odt,
+    const bool perturb,
+    const bool exude,
+    const double max_edge_size_at_feature_edges,
+    const double min_facet_angle,
+    const double max_radius_surface_delaunay_ball,
+    const double max_facet_distance,
+    const double max_circumradius_edge_ratio,
+    const double max_cell_circumradius,
+    const double exude_time_limit,
+    const double exude_sliver_bound,
+    const bool verbose,
+    const int num_threads,
+    const bool refinable,
+    const bool reversed_axes
+    )
+{
+  Mesh_domain cgal_domain = Mesh_domain::create_labeled_image_mesh_domain(image);
+
+  const QuietOutput quiet_output(!verbose);
+  std::shared_ptr<MeshResult> result;
+  with_concurrency(num_threads, verbose, [&](auto tag) {
+    result = mesh_image<decltype(tag)>(
+        cgal_domain, lloyd, odt, perturb, exude,
+        max_edge_size_at_feature_edges, min_facet_angle,
+        max_radius_surface_delaunay_ball, max_facet_distance,
+        max_circumradius_edge_ratio, max_cell_circumradius,
+        exude_time_limit, exude_sliver_bound,
+        refinable ? &image : nullptr, reversed_axes
+        );
+  });
+  return result;
+}
 
-void
-generate_from_inr_with_subdomain_sizing(
-    const std::string & inr_filename,
-    const std::string & outfile,
+// Meshes a labeled image with a cell size bound per subdomain label.
+std::shared_ptr<MeshResult>
+mesh_labeled_image_with_subdomain_sizing(
+    const CGAL::Image_3 & image,
     const double default_max_cell_circumradius,
     const std::vector<double> & max_cell_circumradiuss,
     const std::vector<int> & cell_labels,
@@ -121,59 +226,241 @@ generate_from_inr_with_subdomain_sizing(
     const double exude_time_limit,
     const double exude_sliver_bound,
     const bool verbose,
-    const int seed
+    const int num_threads,
+    const bool refinable,
+    const bool reversed_axes
     )
 {
-  CGAL::get_default_random() = CGAL::Random(seed);
+  Mesh_domain cgal_domain = Mesh_domain::create_labeled_image_mesh_domain(image);
 
+  Sizing_field_cell max_cell_circumradius(default_max_cell_circumradius);
+  const int ndimensions = 3;
+  for(std::vector<double>::size_type i(0); i < max_cell_circumradiuss.size(); ++i)
+    max_cell_circumradius.set_size(max_cell_circumradiuss[i], ndimensions, cgal_domain.index_from_subdomain_index(cell_labels[i]));
+
+  const QuietOutput quiet_output(!verbose);
+  std::shared_ptr<MeshResult> result;
+  with_concurrency(num_threads, verbose, [&](auto tag) {
+    result = mesh_image<decltype(tag)>(
+        cgal_domain, lloyd, odt, perturb, exude,
+        max_edge_size_at_feature_edges, min_facet_angle,
+        max_radius_surface_delaunay_ball, max_facet_distance,
+        max_circumradius_edge_ratio, max_cell_circumradius,
+        exude_time_limit, exude_sliver_bound,
+        refinable ? &image : nullptr, reversed_axes
+        );
+  });
+  return result;
+}
+
+// Meshes a labeled image with the criteria of the options, which may include sizing
+// fields.
+std::shared_ptr<MeshResult>
+mesh_labeled_image_with_options(
+    const CGAL::Image_3 & image,
+    const MeshingOptions & options
+    )
+{
+  Mesh_domain cgal_domain = Mesh_domain::create_labeled_image_mesh_domain(image);
+
+  const QuietOutput quiet_output(!options.verbose);
+  std::shared_ptr<MeshResult> result;
+  with_concurrency(options.num_threads, options.verbose, [&](auto tag) {
+    typedef typename Mesh_types<decltype(tag)>::C3t3 C3t3;
+    C3t3 c3t3 = CGAL::make_mesh_3<C3t3>(
+        cgal_domain,
+        make_mesh_criteria<typename Mesh_types<decltype(tag)>::Mesh_criteria, Mesh_domain>(options),
+        options.lloyd ? CGAL::parameters::lloyd(CGAL::parameters::default_values()) : CGAL::parameters::no_lloyd(),
+        options.odt ? CGAL::parameters::odt(CGAL::parameters::default_values()) : CGAL::parameters::no_odt(),
+        options.perturb ? CGAL::parameters::perturb() : CGAL::parameters::no_perturb(),
+        options.exude ?
+          CGAL::parameters::exude(
+            CGAL::parameters::time_limit = options.exude_time_limit,
+            CGAL::parameters::sliver_bound = options.exude_sliver_bound
+          ) :
+          CGAL::parameters::no_exude()
+        );
+    result = std::make_shared<ImageDomainResult<decltype(tag)>>(c3t3, image);
+  });
+  return result;
+}
+
+CGAL::Image_3
+read_image(const std::string & inr_filename)
+{
   CGAL::Image_3 image;
   const bool success = image.read(inr_filename.c_str());
   if (!success) {
     throw "Could not read image file";
   }
-  Mesh_domain cgal_domain = Mesh_domain::create_labeled_image_mesh_domain(image);
+  return image;
+}
 
-  Sizing_field_cell max_cell_circumradius(default_max_cell_circumradius);
-  const int ndimensions = 3;
-  for(std::vector<double>::size_type i(0); i < max_cell_circumradiuss.size(); ++i)
-    max_cell_circumradius.set_size(max_cell_circumradiuss[i], ndimensions, cgal_domain.index_from_subdomain_index(cell_labels[i]));
+// Wraps the buffer of an array in an image header without copying. The image x axis
+// is the fastest varying one, so a C-ordered array is read with its axes reversed.
+CGAL::Image_3
+wrap_image_array(const ImageArray & array)
+{
+  const int axes[3] = {
+    array.fortran_order ? 0 : 2,
+    1,
+    array.fortran_order ? 2 : 0
+  };
 
-  Mesh_criteria criteria(
-      CGAL::parameters::edge_size=max_edge_size_at_feature_edges,
-      CGAL::parameters::facet_angle=min_facet_angle,
-      CGAL::parameters::facet_size=max_radius_surface_delaunay_ball,
-      CGAL::parameters::facet_distance=max_facet_distance,
-      CGAL::parameters::cell_radius_edge_ratio=max_circumradius_edge_ratio,
-      CGAL::parameters::cell_size=max_cell_circumradius
+  _image * im = ::_initImage();
+  if (im == nullptr) {
+    throw std::bad_alloc();
+  }
+  im->xdim = array.shape[axes[0]];
+  im->ydim = array.shape[axes[1]];
+  im->zdim = array.shape[axes[2]];
+  im->vdim = 1;
+  im->vx = array.voxel_size[axes[0]];
+  im->vy = array.voxel_size[axes[1]];
+  im->vz = array.voxel_size[axes[2]];
+  im->tx = float(array.origin[axes[0]]);
+  im->ty = float(array.origin[axes[1]]);
+  im->tz = float(array.origin[axes[2]]);
+  im->wdim = array.itemsize;
+  im->wordKind = array.is_float ? WK_FLOAT : WK_FIXED;
+  im->sign = array.is_float ? SGN_UNKNOWN : SGN_UNSIGNED;
+  im->endianness = ::_getEndianness();
+  im->data = const_cast<void *>(array.data);
+  // the header is freed with the image, the data is left alone
+  return CGAL::Image_3(im, CGAL::Image_3::DO_NOT_OWN_THE_DATA);
+}
+
+}
+
+std::shared_ptr<MeshResult>
+generate_from_inr_with_subdomain_sizing(
+    const std::string & inr_filename,
+    const double default_max_cell_circumradius,
+    const std::vector<double> & max_cell_circumradiuss,
+    const std::vector<int> & cell_labels,
+    const bool lloyd,
+    const bool odt,
+    const bool perturb,
+    const bool exude,
+    const double max_edge_size_at_feature_edges,
+    const double min_facet_angle,
+    const double max_radius_surface_delaunay_ball,
+    const double max_facet_distance,
+    const double max_circumradius_edge_ratio,
+    const double exude_time_limit,
+    const double exude_sliver_bound,
+    const bool verbose,
+    const int seed,
+    const int num_threads
+    )
+{
+  const ScopedSeed scoped_seed(seed);
+  return mesh_labeled_image_with_subdomain_sizing(
+      read_image(inr_filename),
+      default_max_cell_circumradius, max_cell_circumradiuss, cell_labels,
+      lloyd, odt, perturb, exude,
+      max_edge_size_at_feature_edges, min_facet_angle,
+      max_radius_surface_delaunay_ball, max_facet_distance,
+      max_circumradius_edge_ratio,
+      exude_time_limit, exude_sliver_bound, verbose, num_threads, true, false
       );
+}
 
-  // Mesh generation
-  if (!verbose) {
-    // suppress output
-    std::cerr.setstate(std::ios_base::failbit);
-  }
-  C3t3 c3t3 = CGAL::make_mesh_3<C3t3>(
-      cgal_domain,
-      criteria,
-      lloyd ? CGAL::parameters::lloyd(CGAL::parameters::default_values()) : CGAL::parameters::no_lloyd(),
-      odt ? CGAL::parameters::odt(CGAL::parameters::default_values()) : CGAL::parameters::no_odt(),
-      perturb ? CGAL::parameters::perturb() : CGAL::parameters::no_perturb(),
-      exude ?
-        CGAL::parameters::exude(
-          CGAL::parameters::time_limit = exude_time_limit,
-          CGAL::parameters::sliver_bound = exude_sliver_bound
-        ) :
-        CGAL::parameters::no_exude()
+
+std::shared_ptr<MeshResult>
+generate_from_inr_with_sizing_fields(
+    const std::string & inr_filename,
+    const MeshingOptions & options
+    )
+{
+  const ScopedSeed scoped_seed(options.seed);
+  return mesh_labeled_image_with_options(read_image(inr_filename), options);
+}
+
+
+std::shared_ptr<MeshResult>
+generate_from_array(
+    const ImageArray & array,
+    const bool lloyd,
+    const bool odt,
+    const bool perturb,
+    const bool exude,
+    const double max_edge_size_at_feature_edges,
+    const double min_facet_angle,
+    const double max_radius_surface_delaunay_ball,
+    const double max_facet_distance,
+    const double max_circumradius_edge_ratio,
+    const double max_cell_circumradius,
+    const double exude_time_limit,
+    const double exude_sliver_bound,
+    const bool verbose,
+    const int seed,
+    const int num_threads
+    )
+{
+  const ScopedSeed scoped_seed(seed);
+  return mesh_labeled_image(
+      wrap_image_array(array), lloyd, odt, perturb, exude,
+      max_edge_size_at_feature_edges, min_facet_angle,
+      max_radius_surface_delaunay_ball, max_facet_distance,
+      max_circumradius_edge_ratio, max_cell_circumradius,
+      exude_time_limit, exude_sliver_bound, verbose, num_threads,
+      false, !array.fortran_order
       );
-  if (!verbose) {
-    std::cerr.clear();
-  }
+}
+
+
+std::shared_ptr<MeshResult>
+generate_from_array_with_subdomain_sizing(
+    const ImageArray & array,
+    const double default_max_cell_circumradius,
+    const std::vector<double> & max_cell_circumradiuss,
+    const std::vector<int> & cell_labels,
+    const bool lloyd,
+    const bool odt,
+    const bool perturb,
+    const bool exude,
+    const double max_edge_size_at_feature_edges,
+    const double min_facet_angle,
+    const double max_radius_surface_delaunay_ball,
+    const double max_facet_distance,
+    const double max_circumradius_edge_ratio,
+    const double exude_time_limit,
+    const double exude_sliver_bound,
+    const bool verbose,
+    const int seed,
+    const int num_threads
+    )
+{
+  const ScopedSeed scoped_seed(seed);
+  return mesh_labeled_image_with_subdomain_sizing(
+      wrap_image_array(array),
+      default_max_cell_circumradius, max_cell_circumradiuss, cell_labels,
+      lloyd, odt, perturb, exude,
+      max_edge_size_at_feature_edges, min_facet_angle,
+      max_radius_surface_delaunay_ball, max_facet_distance,
+      max_circumradius_edge_ratio,
+      exude_time_limit, exude_sliver_bound, verbose, num_threads,
+      false, !array.fortran_order
+      );
+}
+
 
-  // Output
-  std::ofstream medit_file(outfile);
-  c3t3.output_to_medit(medit_file);
-  medit_file.close();
-  return;
+std::shared_ptr<MeshResult>
+load_mesh_from_inr(
+    const std::string & filename,
+    const std::string & inr_filename,
+    const int num_threads
+    )
+{
+  const CGAL::Image_3 image = read_image(inr_filename);
+  std::shared_ptr<MeshResult> result;
+  with_concurrency(num_threads, false, [&](auto tag) {
+    typename Mesh_types<decltype(tag)>::C3t3 c3t3;
+    load_c3t3(filename, c3t3);
+    result = std::make_shared<ImageDomainResult<decltype(tag)>>(c3t3, image);
+  });
+  return result;
 }
 
 } // namespace pygalmesh
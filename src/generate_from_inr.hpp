@@ -1,14 +1,61 @@
 #ifndef GENERATE_FROM_INR_HPP
 #define GENERATE_FROM_INR_HPP
 
+#include "mesh_result.hpp"
+
+#include <array>
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace pygalmesh {
 
-void generate_from_inr(
+// A 3D label volume in memory, e.g., the buffer of a NumPy array. Only unsigned
+// integer and floating point data in native byte order is supported. The buffer must
+// outlive the generator call.
+struct ImageArray {
+  const void * data;
+  std::array<std::size_t, 3> shape;
+  bool fortran_order;  // contiguous with the first axis varying fastest
+  bool is_float;
+  unsigned int itemsize;  // bytes
+  std::array<double, 3> voxel_size;
+  std::array<double, 3> origin;
+};
+
+std::shared_ptr<MeshResult>
+generate_from_inr_with_subdomain_sizing(
+    const std::string & inr_filename,
+    const double default_max_cell_circumradius,
+    const std::vector<double> & max_cell_circumradiuss,
+    const std::vector<int> & cell_labels,
+    const bool lloyd = false,
+    const bool odt = false,
+    const bool perturb  = true,
+    const bool exude = true,
+    const double max_edge_size_at_feature_edges = 0.0,
+    const double min_facet_angle = 0.0,
+    const double max_radius_surface_delaunay_ball = 0.0,
+    const double max_facet_distance = 0.0,
+    const double max_circumradius_edge_ratio = 0.0,
+    const double exude_time_limit = 0.0,
+    const double exude_sliver_bound = 0.0,
+    const bool verbose = true,
+    const int seed = 0,
+    const int num_threads = 0
+    );
+
+// Meshes the labels of an .inr image. The sizes in options may be sizing fields,
+// e.g., a MeshSizingField of the previous mesh in an adaptive loop.
+std::shared_ptr<MeshResult>
+generate_from_inr_with_sizing_fields(
     const std::string & inr_filename,
-    const std::string & outfile,
+    const MeshingOptions & options
+    );
+
+std::shared_ptr<MeshResult> generate_from_array(
+    const ImageArray & array,
     const bool lloyd = false,
     const bool odt = false,
     const bool perturb = true,
@@ -22,13 +69,13 @@ void generate_from_inr(
     const double exude_time_limit = 0.0,
     const double exude_sliver_bound = 0.0,
     const bool verbose = true,
-    const int seed = 0
+    const int seed = 0,
+    const int num_threads = 0
     );
 
-void
-generate_from_inr_with_subdomain_sizing(
-    const std::string & inr_filename,
-    const std::string & outfile,
+std::shared_ptr<MeshResult>
+generate_from_array_with_subdomain_sizing(
+    const ImageArray & array,
     const double default_max_cell_circumradius,
     const std::vector<double> & max_cell_circumradiuss,
     const std::vector<int> & cell_labels,
@@ -44,7 +91,18 @@ generate_from_inr_with_subdomain_sizing(
     const double exude_time_limit = 0.0,
     const double exude_sliver_bound = 0.0,
     const bool verbose = true,
-    const int seed = 0
+    const int seed = 0,
+    const int num_threads = 0
+    );
+
+// Restores a mesh written by MeshResult::save() for
+// generate_from_inr_with_sizing_fields(). The image must be the one it was generated
+// from, and num_threads must be 0 exactly if it was generated sequentially.
+std::shared_ptr<MeshResult>
+load_mesh_from_inr(
+    const std::string & filename,
+    const std::string & inr_filename,
+    const int num_threads = 0
     );
 
 } // namespace pygalmesh
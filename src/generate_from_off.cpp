@@ -1,4 +1,9 @@
 #include "generate_from_off.hpp"
+#include "c3t3_result.hpp"
+#include "call_state.hpp"
+#include "mesh_criteria.hpp"
+#include "parallel.hpp"
+#include "polygon_soup.hpp"
 
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/Mesh_complex_3_in_triangulation_3.h>
@@ -8,19 +13,13 @@
 #include <CGAL/make_mesh_3.h>
 #include <CGAL/refine_mesh_3.h>
 
-// IO
-#include <CGAL/IO/Polyhedron_iostream.h>
-
 // for re-orientation
 #include <CGAL/Polygon_mesh_processing/orient_polygon_soup.h>
 #include <CGAL/Polygon_mesh_processing/polygon_soup_to_polygon_mesh.h>
 #include <CGAL/Polygon_mesh_processing/orientation.h>
 
-#include <CGAL/version_macros.h>
-
-#if CGAL_VERSION_MAJOR > 5 || (CGAL_VERSION_MAJOR >= 5 && CGAL_VERSION_MINOR >= 3)
-  #include <CGAL/IO/OFF.h>
-#endif
+#include <sstream>
+#include <stdexcept>
 
 // for sharp features
 //#include <CGAL/Polyhedral_mesh_domain_with_features_3.h>
@@ -35,82 +34,29 @@ typedef CGAL::Polyhedral_mesh_domain_3<Polyhedron, K> Mesh_domain;
 //typedef CGAL::Polyhedral_mesh_domain_with_features_3<K> Mesh_domain;
 //typedef CGAL::Mesh_polyhedron_3<K>::type Polyhedron;
 
-// Triangulation
-typedef CGAL::Mesh_triangulation_3<Mesh_domain>::type Tr;
+// Triangulation and criteria, for CGAL::Sequential_tag or CGAL::Parallel_tag
+template <typename Concurrency_tag>
+struct Mesh_types
+{
+  typedef typename CGAL::Mesh_triangulation_3<Mesh_domain, CGAL::Default, Concurrency_tag>::type Tr;
 
-typedef CGAL::Mesh_complex_3_in_triangulation_3<Tr> C3t3;
+  typedef CGAL::Mesh_complex_3_in_triangulation_3<Tr> C3t3;
 
-// Criteria
-typedef CGAL::Mesh_criteria_3<Tr> Mesh_criteria;
+  // Criteria
+  typedef CGAL::Mesh_criteria_3<Tr> Mesh_criteria;
+};
 
 // To avoid verbose function and named parameters call
 using namespace CGAL::parameters;
 
-void generate_from_off(
-    const std::string& infile,
-    const std::string& outfile,
-    const bool lloyd,
-    const bool odt,
-    const bool perturb,
-    const bool exude,
-    const double max_edge_size_at_feature_edges,
-    const double min_facet_angle,
-    const double max_radius_surface_delaunay_ball,
-    const double max_facet_distance,
-    const double max_circumradius_edge_ratio,
-    const double max_cell_circumradius,
-    const double exude_time_limit,
-    const double exude_sliver_bound,
-    const bool verbose,
-    const bool reorient,
-    const int seed
-) {
-  CGAL::get_default_random() = CGAL::Random(seed);
-
-  std::ifstream input(infile);
-  Polyhedron polyhedron;
-  // fix the orientation of the faces of the input file
-  if (reorient) {
-    std::stringstream msg;
-    msg << "fixing face orientation for \"" << infile <<"\""<< std::endl;
-    std::vector<K::Point_3> points;
-    std::vector<std::vector<std::size_t> > polygons;
-
-    if(
-      !input ||
-#if CGAL_VERSION_MAJOR > 5 || (CGAL_VERSION_MAJOR >= 5 && CGAL_VERSION_MINOR >= 3)
-      !CGAL::IO::read_OFF(input, points, polygons) ||
-#else
-      !CGAL::read_OFF(input, points, polygons) ||
-#endif
-      points.empty()
-    )
-    {
-      std::stringstream msg;
-      msg << "Cannot read .off file \"" << infile <<"\""<< std::endl;
-      throw std::runtime_error(msg.str());
-    }
-    // orient the polygons
-    CGAL::Polygon_mesh_processing::orient_polygon_soup(points, polygons);
-    // create the polyhedron
-    CGAL::Polygon_mesh_processing::polygon_soup_to_polygon_mesh(points, polygons, polyhedron);
-
-  } else {
-
-    // Create input polyhedron
-    input >> polyhedron;
-    if (!input.good()) {
-      // Even if the mesh exists, it may not be valid, see
-      // <https://github.com/CGAL/cgal/issues/4632>
-      std::stringstream msg;
-      msg << "Invalid input file \"" << infile << "\"" << std::endl;
-      msg << "If this is due to wrong face orientation, retry with the option --reorient \"" << std::endl;
-      throw std::runtime_error(msg.str());
-    }
-  }
-
-  input.close();
+namespace {
 
+// Meshes the volume bounded by a closed polyhedron.
+std::shared_ptr<MeshResult>
+mesh_polyhedron(
+    const Polyhedron & polyhedron,
+    const MeshingOptions & options
+) {
   // Create domain
   Mesh_domain cgal_domain(polyhedron);
 
@@ -118,42 +64,67 @@ void generate_from_off(
   // cgal_domain.detect_features();
 
 
-  // Mesh criteria
-  Mesh_criteria criteria(
-      CGAL::parameters::edge_size = max_edge_size_at_feature_edges,
-      CGAL::parameters::facet_angle = min_facet_angle,
-      CGAL::parameters::facet_size = max_radius_surface_delaunay_ball,
-      CGAL::parameters::facet_distance = max_facet_distance,
-      CGAL::parameters::cell_radius_edge_ratio = max_circumradius_edge_ratio,
-      CGAL::parameters::cell_size = max_cell_circumradius);
+  const QuietOutput quiet_output(!options.verbose);
+  std::shared_ptr<MeshResult> result;
+  with_concurrency(options.num_threads, options.verbose, [&](auto tag) {
+    typedef typename Mesh_types<decltype(tag)>::C3t3 C3t3;
+    typedef typename Mesh_types<decltype(tag)>::Mesh_criteria Mesh_criteria;
+
+    C3t3 c3t3 = CGAL::make_mesh_3<C3t3>(
+        cgal_domain,
+        make_mesh_criteria<Mesh_criteria, Mesh_domain>(options),
+        options.lloyd ? CGAL::parameters::lloyd(CGAL::parameters::default_values()) : CGAL::parameters::no_lloyd(),
+        options.odt ? CGAL::parameters::odt(CGAL::parameters::default_values()) : CGAL::parameters::no_odt(),
+        options.perturb ? CGAL::parameters::perturb() : CGAL::parameters::no_perturb(),
+        options.exude ?
+          CGAL::parameters::exude(
+            CGAL::parameters::time_limit = options.exude_time_limit,
+            CGAL::parameters::sliver_bound = options.exude_sliver_bound
+          ) :
+          CGAL::parameters::no_exude()
+        );
+
+    result = std::make_shared<C3t3Result<C3t3>>(c3t3);
+  });
+
+  return result;
+}
 
-  // Mesh generation
-  if (!verbose) {
-    // suppress output
-    std::cerr.setstate(std::ios_base::failbit);
-  }
-  C3t3 c3t3 = CGAL::make_mesh_3<C3t3>(
-      cgal_domain, criteria,
-      lloyd ? CGAL::parameters::lloyd(CGAL::parameters::default_values()) : CGAL::parameters::no_lloyd(),
-      odt ? CGAL::parameters::odt(CGAL::parameters::default_values()) : CGAL::parameters::no_odt(),
-      perturb ? CGAL::parameters::perturb() : CGAL::parameters::no_perturb(),
-      exude ?
-        CGAL::parameters::exude(
-          CGAL::parameters::time_limit = exude_time_limit,
-          CGAL::parameters::sliver_bound = exude_sliver_bound
-        ) :
-        CGAL::parameters::no_exude()
-      );
-  if (!verbose) {
-    std::cerr.clear();
+Polyhedron
+polyhedron_from_arrays(
+    const VertexArray & vertices,
+    const FaceArray & faces,
+    const bool reorient
+) {
+  std::vector<K::Point_3> points;
+  std::vector<std::vector<std::size_t> > polygons;
+  to_polygon_soup(vertices, faces, points, polygons);
+
+  Polyhedron polyhedron;
+  if (reorient) {
+    // orient the polygons
+    CGAL::Polygon_mesh_processing::orient_polygon_soup(points, polygons);
+  } else if (!CGAL::Polygon_mesh_processing::is_polygon_soup_a_polygon_mesh(polygons)) {
+    std::stringstream msg;
+    msg << "Invalid input surface mesh" << std::endl;
+    msg << "If this is due to wrong face orientation, retry with reorient=True" << std::endl;
+    throw std::runtime_error(msg.str());
   }
+  CGAL::Polygon_mesh_processing::polygon_soup_to_polygon_mesh(points, polygons, polyhedron);
+  return polyhedron;
+}
 
-  // Output
-  std::ofstream medit_file(outfile);
-  c3t3.output_to_medit(medit_file);
-  medit_file.close();
+}
 
-  return;
+std::shared_ptr<MeshResult>
+generate_from_off_with_sizing_fields(
+    const VertexArray & vertices,
+    const FaceArray & faces,
+    const MeshingOptions & options,
+    const bool reorient
+) {
+  const ScopedSeed scoped_seed(options.seed);
+  return mesh_polyhedron(polyhedron_from_arrays(vertices, faces, reorient), options);
 }
 
 }  // namespace pygalmesh
@@ -1,20 +1,26 @@
 #define CGAL_MESH_3_VERBOSE 1
 
 #include "generate_periodic.hpp"
+#include "call_state.hpp"
+#include "compiled_domain.hpp"
+#include "mesh_criteria.hpp"
+#include "mesh_data.hpp"
 
 #include <CGAL/Periodic_3_mesh_3/config.h>
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/make_periodic_3_mesh_3.h>
 #include <CGAL/optimize_periodic_3_mesh_3.h>
-#include <CGAL/Periodic_3_mesh_3/IO/File_medit.h>
 #include <CGAL/Periodic_3_mesh_triangulation_3.h>
 #include <CGAL/Labeled_mesh_domain_3.h>
 #include <CGAL/Mesh_complex_3_in_triangulation_3.h>
 #include <CGAL/Mesh_criteria_3.h>
 #include <CGAL/number_type_config.h> // CGAL_PI
+#include <array>
 #include <cmath>
 #include <iostream>
-#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <tuple>
 
 
 namespace pygalmesh {
@@ -48,28 +54,84 @@ typedef CGAL::Mesh_criteria_3<Tr>                           Periodic_mesh_criter
 // To avoid verbose function and named parameters call
 using namespace CGAL::parameters;
 
-void
-generate_periodic_mesh(
+namespace {
+
+// Extracts the cells and facets in the complex, unrolled into number_of_copies (1, 2,
+// 4, or 8) adjacent copies of the period along x, then y, then z. Points are the
+// distinct pairs of a vertex and its offset, like output_periodic_mesh_to_medit.
+MeshData
+extract_periodic_mesh_data(const C3t3 & c3t3, const int number_of_copies)
+{
+  const Tr & tr = c3t3.triangulation();
+  const Iso_cuboid & period = tr.domain();
+  const double width[3] = {
+    period.xmax() - period.xmin(),
+    period.ymax() - period.ymin(),
+    period.zmax() - period.zmin()
+  };
+
+  MeshData data;
+  std::map<std::tuple<Tr::Vertex_handle, int, int, int>, int> index;
+  // index of the periodic copy of vertex i of cell c, shifted by the given periods
+  const auto vertex_index = [&](const Tr::Cell_handle & c, const int i, const std::array<int, 3> & shift) {
+    const auto pp = tr.periodic_point(c, i);
+    const std::array<int, 3> off = {
+      pp.second.x() + shift[0], pp.second.y() + shift[1], pp.second.z() + shift[2]
+    };
+    const auto it = index.emplace(
+        std::make_tuple(c->vertex(i), off[0], off[1], off[2]), int(index.size())
+        );
+    if (it.second) {
+      data.points.push_back(CGAL::to_double(pp.first.x()) + off[0] * width[0]);
+      data.points.push_back(CGAL::to_double(pp.first.y()) + off[1] * width[1]);
+      data.points.push_back(CGAL::to_double(pp.first.z()) + off[2] * width[2]);
+    }
+    return it.first->second;
+  };
+
+  LabelNumbering<C3t3::Surface_patch_index> patch_number;
+  for (int k = 0; k < number_of_copies; k++) {
+    const std::array<int, 3> shift = {k & 1, (k >> 1) & 1, (k >> 2) & 1};
+    for (auto c = c3t3.cells_in_complex_begin(); c != c3t3.cells_in_complex_end(); ++c) {
+      for (int i = 0; i < 4; i++) {
+        data.tetras.push_back(vertex_index(c, i, shift));
+      }
+      data.tetra_subdomains.push_back(int(c3t3.subdomain_index(c)));
+    }
+    for (auto f = c3t3.facets_in_complex_begin(); f != c3t3.facets_in_complex_end(); ++f) {
+      // orient out of the cell with the lower subdomain index, cf. extract_mesh_data
+      auto facet = *f;
+      const auto mirror = tr.mirror_facet(facet);
+      if (c3t3.subdomain_index(mirror.first) < c3t3.subdomain_index(facet.first)) {
+        facet = mirror;
+      }
+      for (int j = 0; j < 3; j++) {
+        const int i = Tr::vertex_triple_index(facet.second, j);
+        data.triangles.push_back(vertex_index(facet.first, i, shift));
+      }
+      data.triangle_patches.push_back(patch_number(c3t3.surface_patch_index(*f)));
+    }
+  }
+  return data;
+}
+
+}
+
+MeshData
+generate_periodic_mesh_with_sizing_fields(
     const std::shared_ptr<pygalmesh::DomainBase> & domain,
-    const std::string & outfile,
     const std::array<double, 6> bounding_cuboid,
-    const bool lloyd,
-    const bool odt,
-    const bool perturb,
-    const bool exude,
+    const MeshingOptions & options,
     const bool manifold,
-    const double max_edge_size_at_feature_edges,
-    const double min_facet_angle,
-    const double max_radius_surface_delaunay_ball,
-    const double max_facet_distance,
-    const double max_circumradius_edge_ratio,
-    const double max_cell_circumradius,
-    const int number_of_copies_in_output,
-    const bool verbose,
-    const int seed
+    const int number_of_copies_in_output
     )
 {
-  CGAL::get_default_random() = CGAL::Random(seed);
+  if (number_of_copies_in_output != 1 && number_of_copies_in_output != 2 &&
+      number_of_copies_in_output != 4 && number_of_copies_in_output != 8) {
+    throw std::invalid_argument("number_of_copies_in_output must be 1, 2, 4, or 8");
+  }
+
+  const ScopedSeed scoped_seed(options.seed);
 
   K::Iso_cuboid_3 cuboid(
       bounding_cuboid[0],
@@ -80,46 +142,27 @@ generate_periodic_mesh(
       bounding_cuboid[5]
       );
 
-  // wrap domain
+  // wrap domain; the tree is lowered into a flat program first. The implicit mesh
+  // domain only looks at the sign, so classify() suffices.
+  const CompiledDomain compiled_domain(domain);
   const auto d = [&](K::Point_3 p) {
-    return domain->eval({p.x(), p.y(), p.z()});
+    return double(compiled_domain.classify({p.x(), p.y(), p.z()}));
   };
   Periodic_mesh_domain cgal_domain =
     Periodic_mesh_domain::create_implicit_mesh_domain(d, cuboid);
 
-  Mesh_criteria criteria(
-      CGAL::parameters::edge_size=max_edge_size_at_feature_edges,
-      CGAL::parameters::facet_angle=min_facet_angle,
-      CGAL::parameters::facet_size=max_radius_surface_delaunay_ball,
-      CGAL::parameters::facet_distance=max_facet_distance,
-      CGAL::parameters::cell_radius_edge_ratio=max_circumradius_edge_ratio,
-      CGAL::parameters::cell_size=max_cell_circumradius
-      );
-
-  // Mesh generation
-  if (!verbose) {
-    // suppress output
-    std::cerr.setstate(std::ios_base::failbit);
-  }
+  const QuietOutput quiet_output(!options.verbose);
   C3t3 c3t3 = CGAL::make_periodic_3_mesh_3<C3t3>(
       cgal_domain,
-      criteria,
+      make_mesh_criteria<Mesh_criteria, Periodic_mesh_domain>(options),
       manifold ? CGAL::parameters::manifold() : CGAL::parameters::non_manifold(),
-      lloyd ? CGAL::parameters::lloyd(CGAL::parameters::default_values()) : CGAL::parameters::no_lloyd(),
-      odt ? CGAL::parameters::odt(CGAL::parameters::default_values()) : CGAL::parameters::no_odt(),
-      perturb ? CGAL::parameters::perturb() : CGAL::parameters::no_perturb(),
-      exude ? CGAL::parameters::exude() : CGAL::parameters::no_exude()
+      options.lloyd ? CGAL::parameters::lloyd(CGAL::parameters::default_values()) : CGAL::parameters::no_lloyd(),
+      options.odt ? CGAL::parameters::odt(CGAL::parameters::default_values()) : CGAL::parameters::no_odt(),
+      options.perturb ? CGAL::parameters::perturb() : CGAL::parameters::no_perturb(),
+      options.exude ? CGAL::parameters::exude() : CGAL::parameters::no_exude()
       );
-  if (!verbose) {
-    std::cerr.clear();
-  }
-
-  // Output
-  std::ofstream medit_file(outfile);
-  CGAL::output_periodic_mesh_to_medit(medit_file, c3t3, number_of_copies_in_output);
-  medit_file.close();
 
-  return;
+  return extract_periodic_mesh_data(c3t3, number_of_copies_in_output);
 }
 
 } // namespace pygalmesh
@@ -2,6 +2,8 @@
 #define GENERATE_PERIODIC_HPP
 
 #include "domain.hpp"
+#include "mesh_data.hpp"
+#include "meshing_options.hpp"
 
 #include <memory>
 #include <string>
@@ -9,24 +11,15 @@
 
 namespace pygalmesh {
 
-void generate_periodic_mesh(
+// Meshes the domain periodically in the bounding cuboid. The sizes in options may be
+// sizing fields; they are evaluated at points in and around the bounding cuboid, which is the
+// period.
+MeshData generate_periodic_mesh_with_sizing_fields(
     const std::shared_ptr<pygalmesh::DomainBase> & domain,
-    const std::string & outfile,
     const std::array<double, 6> bounding_cuboid,
-    const bool lloyd = false,
-    const bool odt = false,
-    const bool perturb = true,
-    const bool exude = true,
+    const MeshingOptions & options,
     const bool manifold = false,
-    const double max_edge_size_at_feature_edges = 0.0,  // std::numeric_limits<double>::max(),
-    const double min_facet_angle = 0.0,
-    const double max_radius_surface_delaunay_ball = 0.0,
-    const double max_facet_distance = 0.0,
-    const double max_circumradius_edge_ratio = 0.0,
-    const double max_cell_circumradius = 0.0,
-    const int number_of_copies_in_output = 1,
-    const bool verbose = true,
-    const int seed = 0
+    const int number_of_copies_in_output = 1
     );
 
 } // namespace pygalmesh
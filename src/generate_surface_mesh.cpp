@@ -1,14 +1,17 @@
 #define CGAL_SURFACE_MESHER_VERBOSE 1
 
 #include "generate_surface_mesh.hpp"
+#include "call_state.hpp"
+#include "compiled_domain.hpp"
+#include "mesh_data.hpp"
 
 #include <CGAL/Surface_mesh_default_triangulation_3.h>
 #include <CGAL/Complex_2_in_triangulation_3.h>
 #include <CGAL/make_surface_mesh.h>
-#include <fstream>
-#include <CGAL/IO/Complex_2_in_triangulation_3_file_writer.h>
 #include <CGAL/Implicit_surface_3.h>
 
+#include <unordered_map>
+
 namespace pygalmesh {
 
 // default triangulation for Surface_mesher
@@ -22,7 +25,7 @@ class CgalDomainWrapper
 {
   public:
   explicit CgalDomainWrapper(const std::shared_ptr<DomainBase> & domain):
-    domain_(domain)
+    domain_(std::make_shared<CompiledDomain>(domain))
   {
   }
 
@@ -36,15 +39,14 @@ class CgalDomainWrapper
   }
 
   private:
-  const std::shared_ptr<DomainBase> domain_;
+  const std::shared_ptr<const CompiledDomain> domain_;
 };
 
 typedef CGAL::Implicit_surface_3<GT, CgalDomainWrapper> Surface_3;
 
-void
+MeshData
 generate_surface_mesh(
     const std::shared_ptr<pygalmesh::DomainBase> & domain,
-    const std::string & outfile,
     const double bounding_sphere_radius,
     const double min_facet_angle,
     const double max_radius_surface_delaunay_ball,
@@ -53,7 +55,7 @@ generate_surface_mesh(
     const int seed
     )
 {
-  CGAL::get_default_random() = CGAL::Random(seed);
+  const ScopedSeed scoped_seed(seed);
 
   const double bounding_sphere_radius2 = bounding_sphere_radius > 0 ?
     bounding_sphere_radius*bounding_sphere_radius :
@@ -75,28 +77,34 @@ generate_surface_mesh(
       max_facet_distance
       );
 
-  if (!verbose) {
-    // suppress output
-    std::cout.setstate(std::ios_base::failbit);
-    std::cerr.setstate(std::ios_base::failbit);
-  }
+  const QuietOutput quiet_output(!verbose);
   CGAL::make_surface_mesh(
       c2t3,
       surface,
       criteria,
       CGAL::Non_manifold_tag()
       );
-  if (!verbose) {
-    std::cout.clear();
-    std::cerr.clear();
-  }
 
-  // Output
-  std::ofstream off_file(outfile);
-  CGAL::output_surface_facets_to_off(off_file, c2t3);
-  off_file.close();
-
-  return;
+  // Output; the facets of the complex carry no orientation, so orient them as
+  // output_surface_facets_to_off does.
+  MeshData data;
+  std::unordered_map<Tr::Vertex_handle, int> index;
+  for (auto v = tr.finite_vertices_begin(); v != tr.finite_vertices_end(); ++v) {
+    index.emplace(v, int(index.size()));
+    data.points.push_back(v->point().x());
+    data.points.push_back(v->point().y());
+    data.points.push_back(v->point().z());
+  }
+  data.triangles.reserve(3 * c2t3.number_of_facets());
+  for (auto f = c2t3.facets_begin(); f != c2t3.facets_end(); ++f) {
+    for (int k = 0; k < 3; k++) {
+      const int i = Tr::vertex_triple_index(f->second, k);
+      data.triangles.push_back(index.at(f->first->vertex(i)));
+    }
+  }
+  remove_unused_points(data);
+  orient_triangles(data);
+  return data;
 }
 
 } // namespace pygalmesh
@@ -2,15 +2,15 @@
 #define GENERATE_SURFACE_MESH_HPP
 
 #include "domain.hpp"
+#include "mesh_data.hpp"
 
 #include <memory>
 #include <string>
 
 namespace pygalmesh {
 
-void generate_surface_mesh(
+MeshData generate_surface_mesh(
     const std::shared_ptr<pygalmesh::DomainBase> & domain,
-    const std::string & outfile,
     const double bounding_sphere_radius = 0.0,
     const double min_facet_angle = 0.0,
     const double max_radius_surface_delaunay_ball = 0.0,
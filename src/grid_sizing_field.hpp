@@ -0,0 +1,367 @@
+#ifndef GRID_SIZING_FIELD_HPP
+#define GRID_SIZING_FIELD_HPP
+
+// A sizing field sampled on a regular grid and interpolated in between, evaluated
+// without any call into Python.
+//
+// The samples are stored in bricks of 4 x 4 x 4, 512 bytes each, so the 8 samples of
+// a trilinear lookup are almost always within one brick and the 64 of a tricubic one
+// within a few, wherever the field is evaluated. Outside of the grid, the points are
+// clamped onto it, i.e., the field is continued constantly along the grid lines.
+
+#include "sizing_field.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace pygalmesh {
+
+class GridSizingField: public SizingFieldBase
+{
+  public:
+  enum class Interpolation { linear, cubic };
+
+  // values[(i * shape[1] + j) * shape[2] + k] is the size at
+  // origin + (i, j, k) * spacing, component-wise.
+  GridSizingField(
+      const double * values,
+      const std::array<std::size_t, 3> & shape,
+      const std::array<double, 3> & origin,
+      const std::array<double, 3> & spacing,
+      const Interpolation interpolation = Interpolation::linear
+      ):
+    shape_(shape),
+    origin_(origin),
+    spacing_(spacing),
+    interpolation_(interpolation)
+  {
+    for (int a = 0; a < 3; a++) {
+      if (shape[a] == 0) {
+        throw std::invalid_argument("The grid must have at least one sample per axis.");
+      }
+      if (!(spacing[a] > 0.0)) {
+        throw std::invalid_argument("The grid spacing must be positive.");
+      }
+      bricks_[a] = (shape[a] + brick - 1) / brick;
+    }
+    data_.resize(bricks_[0] * bricks_[1] * bricks_[2] * brick * brick * brick);
+    min_ = max_ = values[0];
+    for (std::size_t i = 0; i < shape[0]; i++) {
+      for (std::size_t j = 0; j < shape[1]; j++) {
+        for (std::size_t k = 0; k < shape[2]; k++) {
+          const double v = values[(i * shape[1] + j) * shape[2] + k];
+          data_[offset(i, j, k)] = v;
+          min_ = std::min(min_, v);
+          max_ = std::max(max_, v);
+        }
+      }
+    }
+  }
+
+  virtual ~GridSizingField() = default;
+
+  static
+  Interpolation
+  to_interpolation(const std::string & name)
+  {
+    if (name == "linear") {
+      return Interpolation::linear;
+    }
+    if (name == "cubic") {
+      return Interpolation::cubic;
+    }
+    throw std::invalid_argument("Unknown interpolation \"" + name + "\".");
+  }
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    // the cell of each coordinate and the position in it
+    std::array<std::size_t, 3> cell;
+    std::array<double, 3> t;
+    for (int a = 0; a < 3; a++) {
+      const double last = double(shape_[a] - 1);
+      const double s = std::min(std::max((x[a] - origin_[a]) / spacing_[a], 0.0), last);
+      cell[a] = std::min(std::size_t(s), shape_[a] > 1 ? shape_[a] - 2 : 0);
+      t[a] = s - double(cell[a]);
+    }
+    return interpolation_ == Interpolation::linear ? linear(cell, t) : cubic(cell, t);
+  }
+
+  private:
+  static constexpr std::size_t brick = 4;
+
+  std::size_t
+  offset(const std::size_t i, const std::size_t j, const std::size_t k) const
+  {
+    const std::size_t b = ((i / brick) * bricks_[1] + j / brick) * bricks_[2] + k / brick;
+    return ((b * brick + i % brick) * brick + j % brick) * brick + k % brick;
+  }
+
+  // the sample at the index clamped to the grid
+  double
+  at(const std::ptrdiff_t i, const std::ptrdiff_t j, const std::ptrdiff_t k) const
+  {
+    const auto clamp = [&](const std::ptrdiff_t n, const int a) {
+      return std::size_t(std::min(std::max<std::ptrdiff_t>(n, 0), std::ptrdiff_t(shape_[a]) - 1));
+    };
+    return data_[offset(clamp(i, 0), clamp(j, 1), clamp(k, 2))];
+  }
+
+  // The sample at the index, extended linearly beyond the grid by one sample, so that
+  // the cubic interpolation reproduces linear fields up to the boundary.
+  double
+  extended(const std::array<std::ptrdiff_t, 3> & index) const
+  {
+    for (int a = 0; a < 3; a++) {
+      const std::ptrdiff_t n = shape_[a];
+      if (n > 1 && (index[a] < 0 || index[a] >= n)) {
+        std::array<std::ptrdiff_t, 3> inner = index;
+        std::array<std::ptrdiff_t, 3> next = index;
+        inner[a] = index[a] < 0 ? 0 : n - 1;
+        next[a] = index[a] < 0 ? 1 : n - 2;
+        return 2.0 * extended(inner) - extended(next);
+      }
+    }
+    return at(index[0], index[1], index[2]);
+  }
+
+  double
+  linear(const std::array<std::size_t, 3> & c, const std::array<double, 3> & t) const
+  {
+    const std::ptrdiff_t i = c[0];
+    const std::ptrdiff_t j = c[1];
+    const std::ptrdiff_t k = c[2];
+    const auto lerp = [](const double a, const double b, const double s) {
+      return a + s * (b - a);
+    };
+    const double v00 = lerp(at(i, j, k), at(i, j, k + 1), t[2]);
+    const double v01 = lerp(at(i, j + 1, k), at(i, j + 1, k + 1), t[2]);
+    const double v10 = lerp(at(i + 1, j, k), at(i + 1, j, k + 1), t[2]);
+    const double v11 = lerp(at(i + 1, j + 1, k), at(i + 1, j + 1, k + 1), t[2]);
+    return lerp(lerp(v00, v01, t[1]), lerp(v10, v11, t[1]), t[0]);
+  }
+
+  // Catmull-Rom weights of the samples at -1, 0, 1, 2
+  static
+  std::array<double, 4>
+  cubic_weights(const double s)
+  {
+    const double s2 = s * s;
+    const double s3 = s2 * s;
+    return {
+      0.5 * (-s3 + 2.0 * s2 - s),
+      0.5 * (3.0 * s3 - 5.0 * s2 + 2.0),
+      0.5 * (-3.0 * s3 + 4.0 * s2 + s),
+      0.5 * (s3 - s2)
+    };
+  }
+
+  // Tricubic Catmull-Rom interpolation. It reproduces the samples but may overshoot
+  // between them, so the result is kept within the range of the samples; that way, a
+  // positive field stays positive.
+  double
+  cubic(const std::array<std::size_t, 3> & c, const std::array<double, 3> & t) const
+  {
+    const auto wx = cubic_weights(t[0]);
+    const auto wy = cubic_weights(t[1]);
+    const auto wz = cubic_weights(t[2]);
+    double value = 0.0;
+    for (int a = 0; a < 4; a++) {
+      const std::ptrdiff_t i = std::ptrdiff_t(c[0]) + a - 1;
+      double vy = 0.0;
+      for (int b = 0; b < 4; b++) {
+        const std::ptrdiff_t j = std::ptrdiff_t(c[1]) + b - 1;
+        double vz = 0.0;
+        for (int d = 0; d < 4; d++) {
+          vz += wz[d] * extended({i, j, std::ptrdiff_t(c[2]) + d - 1});
+        }
+        vy += wy[b] * vz;
+      }
+      value += wx[a] * vy;
+    }
+    return std::min(std::max(value, min_), max_);
+  }
+
+  private:
+    const std::array<std::size_t, 3> shape_;
+    const std::array<double, 3> origin_;
+    const std::array<double, 3> spacing_;
+    const Interpolation interpolation_;
+    std::array<std::size_t, 3> bricks_;
+    std::vector<double> data_;
+    double min_;
+    double max_;
+};
+
+// The largest field below the given one whose values grow by at most rate per unit
+// length, i.e., the minimum over y of field(y) + rate * |x - y|. It is computed on a
+// grid over the bounding cuboid with n intervals along its longest side, and
+// interpolated trilinearly in between. Every sample keeps the sample y it takes the
+// minimum from, and forward and backward sweeps pass these on to the 26 neighbors, as
+// in vector distance transforms; the lengths are exact, only rarely is a better y
+// missed.
+class GradedSizingField: public SizingFieldBase
+{
+  public:
+  GradedSizingField(
+      const std::shared_ptr<const SizingFieldBase> & field,
+      const double rate,
+      const std::array<double, 6> & bounding_cuboid,
+      const int n
+      ):
+    grid_(limit(*field, rate, bounding_cuboid, n))
+  {
+  }
+
+  virtual ~GradedSizingField() = default;
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    return grid_.eval(x);
+  }
+
+  private:
+  static
+  GridSizingField
+  limit(
+      const SizingFieldBase & field,
+      const double rate,
+      const std::array<double, 6> & bounding_cuboid,
+      const int n
+      )
+  {
+    if (!(rate >= 0.0)) {
+      throw std::invalid_argument("The growth rate must not be negative.");
+    }
+    if (n < 1) {
+      throw std::invalid_argument("Need at least one grid interval.");
+    }
+    double extent = 0.0;
+    for (int a = 0; a < 3; a++) {
+      if (!(bounding_cuboid[a] < bounding_cuboid[a + 3])) {
+        throw std::invalid_argument("The bounding cuboid must have positive extent.");
+      }
+      extent = std::max(extent, bounding_cuboid[a + 3] - bounding_cuboid[a]);
+    }
+    std::array<std::size_t, 3> shape;
+    std::array<double, 3> origin;
+    std::array<double, 3> spacing;
+    for (int a = 0; a < 3; a++) {
+      const double length = bounding_cuboid[a + 3] - bounding_cuboid[a];
+      const std::size_t intervals = std::max(1, int(std::ceil(n * length / extent)));
+      shape[a] = intervals + 1;
+      origin[a] = bounding_cuboid[a];
+      spacing[a] = length / intervals;
+    }
+
+    const std::ptrdiff_t nx = shape[0];
+    const std::ptrdiff_t ny = shape[1];
+    const std::ptrdiff_t nz = shape[2];
+    const auto index = [&](const std::ptrdiff_t i, const std::ptrdiff_t j, const std::ptrdiff_t k) {
+      return (i * ny + j) * nz + k;
+    };
+    const auto position = [&](const std::ptrdiff_t i, const std::ptrdiff_t j, const std::ptrdiff_t k) {
+      return std::array<double, 3>{
+        origin[0] + i * spacing[0],
+        origin[1] + j * spacing[1],
+        origin[2] + k * spacing[2]
+      };
+    };
+
+    // the field at the samples, and the sample each takes its limited value from
+    std::vector<double> samples(nx * ny * nz);
+    std::vector<std::ptrdiff_t> source(samples.size());
+    std::vector<double> values(samples.size());
+    for (std::ptrdiff_t i = 0; i < nx; i++) {
+      for (std::ptrdiff_t j = 0; j < ny; j++) {
+        for (std::ptrdiff_t k = 0; k < nz; k++) {
+          const std::ptrdiff_t s = index(i, j, k);
+          samples[s] = field.eval(position(i, j, k));
+          source[s] = s;
+          values[s] = samples[s];
+        }
+      }
+    }
+
+    // the neighbors before a sample in the scan order
+    std::vector<std::array<int, 3>> steps;
+    for (int di = -1; di <= 1; di++) {
+      for (int dj = -1; dj <= 1; dj++) {
+        for (int dk = -1; dk <= 1; dk++) {
+          if (di < 0 || (di == 0 && (dj < 0 || (dj == 0 && dk < 0)))) {
+            steps.push_back({di, dj, dk});
+          }
+        }
+      }
+    }
+
+    // tries the sources of the neighbors in direction sign * step
+    const auto relax = [&](const std::ptrdiff_t i, const std::ptrdiff_t j, const std::ptrdiff_t k, const int sign) {
+      const std::ptrdiff_t s = index(i, j, k);
+      bool changed = false;
+      for (const auto & step: steps) {
+        const std::ptrdiff_t ni = i + sign * step[0];
+        const std::ptrdiff_t nj = j + sign * step[1];
+        const std::ptrdiff_t nk = k + sign * step[2];
+        if (ni < 0 || nj < 0 || nk < 0 || ni >= nx || nj >= ny || nk >= nz) {
+          continue;
+        }
+        const std::ptrdiff_t y = source[index(ni, nj, nk)];
+        if (y == source[s]) {
+          continue;
+        }
+        const std::ptrdiff_t yi = y / (ny * nz);
+        const std::ptrdiff_t yj = (y / nz) % ny;
+        const std::ptrdiff_t yk = y % nz;
+        const double dx = (i - yi) * spacing[0];
+        const double dy = (j - yj) * spacing[1];
+        const double dz = (k - yk) * spacing[2];
+        const double candidate = samples[y] + rate * std::sqrt(dx * dx + dy * dy + dz * dz);
+        if (candidate < values[s]) {
+          values[s] = candidate;
+          source[s] = y;
+          changed = true;
+        }
+      }
+      return changed;
+    };
+
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (std::ptrdiff_t i = 0; i < nx; i++) {
+        for (std::ptrdiff_t j = 0; j < ny; j++) {
+          for (std::ptrdiff_t k = 0; k < nz; k++) {
+            changed = relax(i, j, k, 1) || changed;
+          }
+        }
+      }
+      for (std::ptrdiff_t i = nx - 1; i >= 0; i--) {
+        for (std::ptrdiff_t j = ny - 1; j >= 0; j--) {
+          for (std::ptrdiff_t k = nz - 1; k >= 0; k--) {
+            changed = relax(i, j, k, -1) || changed;
+          }
+        }
+      }
+    }
+
+    return GridSizingField(values.data(), shape, origin, spacing);
+  }
+
+  private:
+    const GridSizingField grid_;
+};
+
+} // namespace pygalmesh
+
+#endif // GRID_SIZING_FIELD_HPP
@@ -0,0 +1,156 @@
+#ifndef JOB_POOL_HPP
+#define JOB_POOL_HPP
+
+// A pool of worker threads for a fixed batch of independent jobs.
+//
+// The jobs are dealt out to the workers round-robin. Each worker takes its own jobs
+// front to back and, once it runs out, steals from the back of the others' queues, so
+// a few expensive jobs don't leave the rest of the workers idle. The results are handed
+// out in the order the jobs finish.
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pygalmesh {
+
+template <typename Result>
+class JobPool
+{
+  public:
+  // Runs run(0), ..., run(num_jobs - 1) on num_workers threads, or as many as there
+  // are cores if num_workers is not positive.
+  JobPool(
+      const std::size_t num_jobs,
+      const int num_workers,
+      const std::function<Result(std::size_t)> & run
+      ):
+    run_(run),
+    num_pending_(num_jobs)
+  {
+    const std::size_t n = std::max<std::size_t>(1, std::min(
+        num_jobs,
+        std::size_t(num_workers > 0 ? num_workers : std::max(1u, std::thread::hardware_concurrency()))
+        ));
+    queues_.reserve(n);
+    for (std::size_t w = 0; w < n; w++) {
+      queues_.push_back(std::make_unique<Queue>());
+    }
+    for (std::size_t k = 0; k < num_jobs; k++) {
+      queues_[k % n]->jobs.push_back(k);
+    }
+    threads_.reserve(n);
+    for (std::size_t w = 0; w < n; w++) {
+      threads_.emplace_back([this, w]() { work(w); });
+    }
+  }
+
+  // Jobs that haven't started are dropped; running ones are waited for.
+  ~JobPool()
+  {
+    for (auto & queue: queues_) {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      queue->jobs.clear();
+    }
+    for (auto & thread: threads_) {
+      thread.join();
+    }
+  }
+
+  JobPool(const JobPool &) = delete;
+  JobPool & operator=(const JobPool &) = delete;
+
+  // Waits for the next job to finish. Returns false if all results have been handed
+  // out. error is set if the job threw.
+  bool
+  next(std::size_t & job, Result & result, std::exception_ptr & error)
+  {
+    std::unique_lock<std::mutex> lock(done_mutex_);
+    done_changed_.wait(lock, [&]() { return !done_.empty() || num_pending_ == 0; });
+    if (done_.empty()) {
+      return false;
+    }
+    job = done_.front().job;
+    result = std::move(done_.front().result);
+    error = done_.front().error;
+    done_.pop_front();
+    return true;
+  }
+
+  private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::size_t> jobs;
+  };
+
+  struct Done {
+    std::size_t job;
+    Result result;
+    std::exception_ptr error;
+  };
+
+  bool
+  take(const std::size_t w, std::size_t & job)
+  {
+    {
+      Queue & own = *queues_[w];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.jobs.empty()) {
+        job = own.jobs.front();
+        own.jobs.pop_front();
+        return true;
+      }
+    }
+    for (std::size_t k = 1; k < queues_.size(); k++) {
+      Queue & other = *queues_[(w + k) % queues_.size()];
+      std::lock_guard<std::mutex> lock(other.mutex);
+      if (!other.jobs.empty()) {
+        job = other.jobs.back();
+        other.jobs.pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void
+  work(const std::size_t w)
+  {
+    std::size_t job;
+    while (take(w, job)) {
+      Done done{job, Result(), nullptr};
+      try {
+        done.result = run_(job);
+      } catch (...) {
+        done.error = std::current_exception();
+      }
+      {
+        std::lock_guard<std::mutex> lock(done_mutex_);
+        done_.push_back(std::move(done));
+        num_pending_--;
+      }
+      done_changed_.notify_all();
+    }
+  }
+
+  private:
+    const std::function<Result(std::size_t)> run_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex done_mutex_;
+    std::condition_variable done_changed_;
+    std::deque<Done> done_;
+    // jobs not finished yet; once the pool is being destroyed, some never will be
+    std::size_t num_pending_;
+};
+
+} // namespace pygalmesh
+
+#endif // JOB_POOL_HPP
@@ -0,0 +1,86 @@
+#ifndef MESH_CRITERIA_HPP
+#define MESH_CRITERIA_HPP
+
+// The Mesh_3 criteria of MeshingOptions for any mesh domain. Each size is either the
+// value or, if set, the sizing field; the fields are captured by value, so the criteria
+// may outlive the options.
+
+#include "meshing_options.hpp"
+
+namespace pygalmesh {
+
+template <typename Mesh_criteria, typename Mesh_domain>
+Mesh_criteria
+make_mesh_criteria(const MeshingOptions & options)
+{
+  typedef typename Mesh_criteria::Edge_criteria Edge_criteria;
+  typedef typename Mesh_criteria::Facet_criteria Facet_criteria;
+  typedef typename Mesh_criteria::Cell_criteria Cell_criteria;
+  typedef typename Mesh_domain::R::Point_3 Point_3;
+  typedef typename Mesh_domain::Index Index;
+
+  const auto & max_radius_surface_delaunay_ball_field = options.max_radius_surface_delaunay_ball_field;
+  const auto & max_facet_distance_field = options.max_facet_distance_field;
+  const auto & max_edge_size_at_feature_edges_field = options.max_edge_size_at_feature_edges_field;
+  const auto & max_cell_circumradius_field = options.max_cell_circumradius_field;
+
+  // Build the float/field values according to
+  // <https://github.com/CGAL/cgal/issues/5044#issuecomment-705526982>.
+
+  // nested ternary operator
+  const auto facet_criteria = max_radius_surface_delaunay_ball_field ? (
+      max_facet_distance_field ?
+      Facet_criteria(
+        options.min_facet_angle,
+        [max_radius_surface_delaunay_ball_field](Point_3 p, const int, const Index&) {
+          return max_radius_surface_delaunay_ball_field->eval({p.x(), p.y(), p.z()});
+        },
+        [max_facet_distance_field](Point_3 p, const int, const Index&) {
+          return max_facet_distance_field->eval({p.x(), p.y(), p.z()});
+        }
+      ) : Facet_criteria(
+        options.min_facet_angle,
+        [max_radius_surface_delaunay_ball_field](Point_3 p, const int, const Index&) {
+          return max_radius_surface_delaunay_ball_field->eval({p.x(), p.y(), p.z()});
+        },
+        options.max_facet_distance_value
+      )
+    ) : (
+      max_facet_distance_field ?
+      Facet_criteria(
+        options.min_facet_angle,
+        options.max_radius_surface_delaunay_ball_value,
+         [max_facet_distance_field](Point_3 p, const int, const Index&) {
+           return max_facet_distance_field->eval({p.x(), p.y(), p.z()});
+         }
+      ) : Facet_criteria(
+        options.min_facet_angle,
+        options.max_radius_surface_delaunay_ball_value,
+        options.max_facet_distance_value
+      )
+    );
+
+  const auto edge_criteria = max_edge_size_at_feature_edges_field ?
+    Edge_criteria(
+      [max_edge_size_at_feature_edges_field](Point_3 p, const int, const Index&) {
+        return max_edge_size_at_feature_edges_field->eval({p.x(), p.y(), p.z()});
+      },
+      options.min_edge_size_at_feature_edges
+    ) : Edge_criteria(
+      options.max_edge_size_at_feature_edges_value,
+      options.min_edge_size_at_feature_edges
+    );
+
+  const auto cell_criteria = max_cell_circumradius_field ?
+     Cell_criteria(
+         options.max_circumradius_edge_ratio,
+         [max_cell_circumradius_field](Point_3 p, const int, const Index&) {
+           return max_cell_circumradius_field->eval({p.x(), p.y(), p.z()});
+          }) : Cell_criteria(options.max_circumradius_edge_ratio, options.max_cell_circumradius_value);
+
+  return Mesh_criteria(edge_criteria, facet_criteria, cell_criteria);
+}
+
+} // namespace pygalmesh
+
+#endif // MESH_CRITERIA_HPP
@@ -0,0 +1,161 @@
+#ifndef MESH_DATA_HPP
+#define MESH_DATA_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace pygalmesh {
+
+// A generated mesh in flat, contiguous arrays, row-major. The bindings hand the
+// buffers to NumPy without copying.
+struct MeshData {
+  std::vector<double> points;  // 3 per point
+  std::vector<int> tetras;  // 4 per cell
+  std::vector<int> tetra_subdomains;
+  std::vector<int> triangles;  // 3 per facet
+  std::vector<int> triangle_patches;
+  std::vector<int> edges;  // 2 per edge
+  std::vector<int> edge_curves;
+};
+
+// Numbers the distinct values of a label type 1, 2, ... in the order of appearance.
+// Used for surface patch indices, which are pairs of subdomain indices for most mesh
+// domains.
+template <typename T>
+class LabelNumbering
+{
+  public:
+  int
+  operator()(const T & label)
+  {
+    return numbers_.emplace(label, int(numbers_.size()) + 1).first->second;
+  }
+
+  private:
+    std::map<T, int> numbers_;
+};
+
+// Drops the points that no cell, facet or edge refers to and renumbers the rest.
+inline
+void
+remove_unused_points(MeshData & data)
+{
+  const size_t n = data.points.size() / 3;
+  std::vector<int> new_index(n, -1);
+  for (auto * cells: {&data.tetras, &data.triangles, &data.edges}) {
+    for (const int k: *cells) {
+      new_index[k] = 0;
+    }
+  }
+  int count = 0;
+  for (size_t k = 0; k < n; k++) {
+    if (new_index[k] == 0) {
+      new_index[k] = count;
+      for (int i = 0; i < 3; i++) {
+        data.points[3 * count + i] = data.points[3 * k + i];
+      }
+      count++;
+    }
+  }
+  data.points.resize(3 * count);
+  for (auto * cells: {&data.tetras, &data.triangles, &data.edges}) {
+    for (int & k: *cells) {
+      k = new_index[k];
+    }
+  }
+}
+
+// Orients the triangles consistently across manifold edges, and every connected
+// component such that it encloses a positive volume, i.e., with outward normals if it
+// is closed.
+inline
+void
+orient_triangles(MeshData & data)
+{
+  const size_t n = data.triangles.size() / 3;
+  int * t = data.triangles.data();
+
+  // triangles by undirected edge
+  std::unordered_map<long long, std::vector<size_t>> edge_triangles;
+  const long long num_points = data.points.size() / 3;
+  const auto key = [&](int a, int b) {
+    if (a > b) {
+      std::swap(a, b);
+    }
+    return a * num_points + b;
+  };
+  for (size_t k = 0; k < n; k++) {
+    for (int i = 0; i < 3; i++) {
+      edge_triangles[key(t[3*k + i], t[3*k + (i + 1) % 3])].push_back(k);
+    }
+  }
+  // whether triangle k traverses the edge a -> b
+  const auto has_edge = [&](const size_t k, const int a, const int b) {
+    for (int i = 0; i < 3; i++) {
+      if (t[3*k + i] == a && t[3*k + (i + 1) % 3] == b) {
+        return true;
+      }
+    }
+    return false;
+  };
+  const auto flip = [&](const size_t k) {
+    std::swap(t[3*k + 1], t[3*k + 2]);
+  };
+
+  std::vector<bool> visited(n, false);
+  std::vector<size_t> component;
+  for (size_t start = 0; start < n; start++) {
+    if (visited[start]) {
+      continue;
+    }
+    // breadth-first traversal of the component
+    component.clear();
+    component.push_back(start);
+    visited[start] = true;
+    for (size_t j = 0; j < component.size(); j++) {
+      const size_t k = component[j];
+      for (int i = 0; i < 3; i++) {
+        const int a = t[3*k + i];
+        const int b = t[3*k + (i + 1) % 3];
+        const auto & neighbors = edge_triangles[key(a, b)];
+        if (neighbors.size() != 2) {
+          continue;
+        }
+        const size_t other = neighbors[0] == k ? neighbors[1] : neighbors[0];
+        if (!visited[other]) {
+          // the neighbor must traverse the shared edge the other way
+          if (has_edge(other, a, b)) {
+            flip(other);
+          }
+          visited[other] = true;
+          component.push_back(other);
+        }
+      }
+    }
+
+    double volume = 0.0;
+    for (const size_t k: component) {
+      const double * p = &data.points[3 * t[3*k]];
+      const double * q = &data.points[3 * t[3*k + 1]];
+      const double * r = &data.points[3 * t[3*k + 2]];
+      volume +=
+        p[0] * (q[1] * r[2] - q[2] * r[1]) +
+        p[1] * (q[2] * r[0] - q[0] * r[2]) +
+        p[2] * (q[0] * r[1] - q[1] * r[0]);
+    }
+    if (volume < 0.0) {
+      for (const size_t k: component) {
+        flip(k);
+      }
+    }
+  }
+}
+
+} // namespace pygalmesh
+
+#endif // MESH_DATA_HPP
@@ -0,0 +1,325 @@
+#ifndef MESH_IO_HPP
+#define MESH_IO_HPP
+
+// Binary mesh writers: medit .meshb (libMeshb version 3) and VTK XML .vtu with raw
+// appended data. Both read the mesh in chunks of a fixed number of points or cells
+// and write every block through one large buffer, so the memory they need does not
+// grow with the mesh.
+
+#include "mesh_result.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace pygalmesh {
+
+static_assert(sizeof(int) == sizeof(int32_t), "The writers assume 32-bit int.");
+
+// number of points or cells read at a time
+constexpr std::size_t write_chunk_size = 1 << 16;
+
+// Calls f(nodes, labels, n) for consecutive chunks of the cells of a type. Either
+// array is only filled if requested.
+template <typename F>
+void
+for_each_cell_chunk(
+    const MeshResult & mesh,
+    const CellType type,
+    const bool with_nodes,
+    const bool with_labels,
+    const F & f
+    )
+{
+  std::vector<int> nodes(with_nodes ? nodes_per_cell(type) * write_chunk_size : 0);
+  std::vector<int> labels(with_labels ? write_chunk_size : 0);
+  const auto cursor = mesh.cells(type);
+  while (true) {
+    const std::size_t n = cursor->next(
+        write_chunk_size,
+        with_nodes ? nodes.data() : nullptr,
+        with_labels ? labels.data() : nullptr
+        );
+    if (n == 0) {
+      break;
+    }
+    f(nodes.data(), labels.data(), n);
+  }
+}
+
+// Calls f(points, n) for consecutive chunks of the points.
+template <typename F>
+void
+for_each_point_chunk(const MeshResult & mesh, const F & f)
+{
+  std::vector<double> points(3 * write_chunk_size);
+  for (std::size_t k = 0; k < mesh.num_points(); k += write_chunk_size) {
+    const std::size_t n = std::min(write_chunk_size, mesh.num_points() - k);
+    mesh.copy_points(k, k + n, points.data());
+    f(points.data(), n);
+  }
+}
+
+// Appends raw values to a buffer and hands it to the file in large chunks.
+class BufferedWriter
+{
+  public:
+  explicit BufferedWriter(const std::string & filename):
+    file_(filename, std::ios::binary),
+    filename_(filename)
+  {
+    if (!file_) {
+      throw std::runtime_error("Could not open \"" + filename + "\" for writing.");
+    }
+    buffer_.reserve(capacity);
+  }
+
+  ~BufferedWriter()
+  {
+    // errors are reported by close()
+    if (file_.is_open()) {
+      file_.write(buffer_.data(), buffer_.size());
+    }
+  }
+
+  template <typename T>
+  void
+  put(const T & value)
+  {
+    write(&value, sizeof(T));
+  }
+
+  void
+  write(const void * data, const size_t size)
+  {
+    if (buffer_.size() + size > capacity) {
+      flush();
+    }
+    if (size > capacity) {
+      file_.write(static_cast<const char *>(data), size);
+    } else {
+      const char * p = static_cast<const char *>(data);
+      buffer_.insert(buffer_.end(), p, p + size);
+    }
+    position_ += size;
+  }
+
+  // number of bytes written so far
+  uint64_t
+  position() const
+  {
+    return position_;
+  }
+
+  void
+  close()
+  {
+    flush();
+    file_.close();
+    if (file_.fail()) {
+      throw std::runtime_error("Failed to write \"" + filename_ + "\".");
+    }
+  }
+
+  private:
+  void
+  flush()
+  {
+    file_.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+  }
+
+  private:
+    static constexpr size_t capacity = size_t(1) << 22;
+    std::ofstream file_;
+    const std::string filename_;
+    std::vector<char> buffer_;
+    uint64_t position_ = 0;
+};
+
+// <https://github.com/LoicMarechal/libMeshb>. Version 3 has 32-bit integers, 64-bit
+// reals and 64-bit file positions. Indices are 1-based.
+inline
+void
+write_meshb(const std::string & filename, const MeshResult & mesh)
+{
+  const int32_t GmfDimension = 3;
+  const int32_t GmfVertices = 4;
+  const int32_t GmfEdges = 5;
+  const int32_t GmfTriangles = 6;
+  const int32_t GmfTetrahedra = 8;
+  const int32_t GmfEnd = 54;
+
+  BufferedWriter out(filename);
+  // the reader detects the byte order from the code
+  out.put(int32_t(1));
+  out.put(int32_t(3));
+
+  // keyword header: keyword, position of the next keyword, number of entries
+  const auto begin_block = [&](const int32_t keyword, const size_t count, const size_t record_size) {
+    out.put(keyword);
+    out.put(int64_t(out.position() + sizeof(int64_t) + sizeof(int32_t) + count * record_size));
+    out.put(int32_t(count));
+  };
+
+  out.put(GmfDimension);
+  out.put(int64_t(out.position() + sizeof(int64_t) + sizeof(int32_t)));
+  out.put(int32_t(3));
+
+  begin_block(GmfVertices, mesh.num_points(), 3 * sizeof(double) + sizeof(int32_t));
+  for_each_point_chunk(mesh, [&](const double * points, const size_t n) {
+    for (size_t k = 0; k < n; k++) {
+      out.write(points + 3 * k, 3 * sizeof(double));
+      out.put(int32_t(0));
+    }
+  });
+
+  const auto write_cells = [&](const int32_t keyword, const CellType type) {
+    const size_t count = mesh.num_cells(type);
+    if (count == 0) {
+      return;
+    }
+    const int nodes = nodes_per_cell(type);
+    const bool has_labels = mesh.has_labels(type);
+    begin_block(keyword, count, (nodes + 1) * sizeof(int32_t));
+    for_each_cell_chunk(mesh, type, true, has_labels, [&](const int * cells, const int * labels, const size_t n) {
+      for (size_t k = 0; k < n; k++) {
+        for (int i = 0; i < nodes; i++) {
+          out.put(int32_t(cells[nodes * k + i] + 1));
+        }
+        out.put(int32_t(has_labels ? labels[k] : 0));
+      }
+    });
+  };
+  write_cells(GmfEdges, CellType::line);
+  write_cells(GmfTriangles, CellType::triangle);
+  write_cells(GmfTetrahedra, CellType::tetra);
+
+  out.put(GmfEnd);
+  out.put(int64_t(0));
+  out.close();
+}
+
+// <https://docs.vtk.org/en/latest/design_documents/VTKFileFormats.html>. Cells are
+// ordered triangles, tetrahedra, edges; the labels go to the cell data "medit:ref" if
+// all cells have one.
+inline
+void
+write_vtu(const std::string & filename, const MeshResult & mesh)
+{
+  const CellType types[3] = {CellType::triangle, CellType::tetra, CellType::line};
+  size_t num_cells = 0;
+  size_t num_nodes = 0;
+  bool has_labels = true;
+  for (const CellType type: types) {
+    num_cells += mesh.num_cells(type);
+    num_nodes += nodes_per_cell(type) * mesh.num_cells(type);
+    has_labels = has_labels && mesh.has_labels(type);
+  }
+
+  // Each appended block is preceded by its size in bytes.
+  const uint64_t points_size = 3 * mesh.num_points() * sizeof(double);
+  const uint64_t connectivity_size = num_nodes * sizeof(int32_t);
+  const uint64_t offsets_size = num_cells * sizeof(int64_t);
+  const uint64_t types_size = num_cells * sizeof(uint8_t);
+  const uint64_t refs_size = num_cells * sizeof(int32_t);
+  uint64_t offset = 0;
+  const auto next_offset = [&](const uint64_t size) {
+    const uint64_t current = offset;
+    offset += sizeof(uint64_t) + size;
+    return current;
+  };
+
+  const uint16_t one = 1;
+  unsigned char first_byte;
+  std::memcpy(&first_byte, &one, 1);
+  const char * byte_order = first_byte == 1 ? "LittleEndian" : "BigEndian";
+
+  std::ostringstream header;
+  header
+    << "<?xml version=\"1.0\"?>\n"
+    << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"" << byte_order
+    << "\" header_type=\"UInt64\">\n"
+    << "<UnstructuredGrid>\n"
+    << "<Piece NumberOfPoints=\"" << mesh.num_points() << "\" NumberOfCells=\"" << num_cells << "\">\n"
+    << "<Points>\n"
+    << "<DataArray type=\"Float64\" NumberOfComponents=\"3\" format=\"appended\" offset=\""
+    << next_offset(points_size) << "\"/>\n"
+    << "</Points>\n"
+    << "<Cells>\n"
+    << "<DataArray type=\"Int32\" Name=\"connectivity\" format=\"appended\" offset=\""
+    << next_offset(connectivity_size) << "\"/>\n"
+    << "<DataArray type=\"Int64\" Name=\"offsets\" format=\"appended\" offset=\""
+    << next_offset(offsets_size) << "\"/>\n"
+    << "<DataArray type=\"UInt8\" Name=\"types\" format=\"appended\" offset=\""
+    << next_offset(types_size) << "\"/>\n"
+    << "</Cells>\n";
+  if (has_labels) {
+    header
+      << "<CellData>\n"
+      << "<DataArray type=\"Int32\" Name=\"medit:ref\" format=\"appended\" offset=\""
+      << next_offset(refs_size) << "\"/>\n"
+      << "</CellData>\n";
+  }
+  header
+    << "</Piece>\n"
+    << "</UnstructuredGrid>\n"
+    << "<AppendedData encoding=\"raw\">\n_";
+  const std::string head = header.str();
+
+  BufferedWriter out(filename);
+  out.write(head.data(), head.size());
+
+  out.put(points_size);
+  for_each_point_chunk(mesh, [&](const double * points, const size_t n) {
+    out.write(points, 3 * n * sizeof(double));
+  });
+
+  out.put(connectivity_size);
+  for (const CellType type: types) {
+    const int nodes = nodes_per_cell(type);
+    for_each_cell_chunk(mesh, type, true, false, [&](const int * cells, const int *, const size_t n) {
+      out.write(cells, nodes * n * sizeof(int32_t));
+    });
+  }
+
+  out.put(offsets_size);
+  int64_t end = 0;
+  for (const CellType type: types) {
+    for (size_t k = 0; k < mesh.num_cells(type); k++) {
+      end += nodes_per_cell(type);
+      out.put(end);
+    }
+  }
+
+  // VTK_TRIANGLE, VTK_TETRA, VTK_LINE
+  const uint8_t vtk_types[3] = {5, 10, 3};
+  out.put(types_size);
+  for (int b = 0; b < 3; b++) {
+    for (size_t k = 0; k < mesh.num_cells(types[b]); k++) {
+      out.put(vtk_types[b]);
+    }
+  }
+
+  if (has_labels) {
+    out.put(refs_size);
+    for (const CellType type: types) {
+      for_each_cell_chunk(mesh, type, false, true, [&](const int *, const int * labels, const size_t n) {
+        out.write(labels, n * sizeof(int32_t));
+      });
+    }
+  }
+
+  const std::string tail = "\n</AppendedData>\n</VTKFile>\n";
+  out.write(tail.data(), tail.size());
+  out.close();
+}
+
+} // namespace pygalmesh
+
+#endif // MESH_IO_HPP
@@ -0,0 +1,286 @@
+#ifndef MESH_RESULT_HPP
+#define MESH_RESULT_HPP
+
+// Generated meshes behind one interface, so they can be read out piece by piece
+// instead of being converted to arrays as a whole. Points are numbered 0, 1, ...;
+// cells refer to them by their numbers.
+
+#include "mesh_data.hpp"
+#include "meshing_control.hpp"
+#include "meshing_options.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace pygalmesh {
+
+enum class CellType { tetra, triangle, line };
+
+inline
+int
+nodes_per_cell(const CellType type)
+{
+  switch (type) {
+    case CellType::tetra: return 4;
+    case CellType::triangle: return 3;
+    case CellType::line: return 2;
+  }
+  throw std::invalid_argument("Unknown cell type.");
+}
+
+// Reads the cells of one type front to back.
+class CellCursor
+{
+  public:
+  virtual ~CellCursor() = default;
+
+  // Writes up to max_cells cells to nodes and their labels to labels; either may be
+  // null. Returns the number of cells read, 0 at the end.
+  virtual
+  std::size_t
+  next(const std::size_t max_cells, int * nodes, int * labels) = 0;
+};
+
+class MeshResult
+{
+  public:
+  virtual ~MeshResult() = default;
+
+  virtual
+  std::size_t
+  num_points() const = 0;
+
+  // Copies the coordinates of the points begin, ..., end - 1, 3 per point.
+  virtual
+  void
+  copy_points(const std::size_t begin, const std::size_t end, double * out) const = 0;
+
+  // Copies the coordinates of the n points with the given numbers, 3 per point.
+  virtual
+  void
+  gather_points(const int * indices, const std::size_t n, double * out) const = 0;
+
+  virtual
+  std::size_t
+  num_cells(const CellType type) const = 0;
+
+  // Whether the cells of the type carry subdomain, patch or curve labels.
+  virtual
+  bool
+  has_labels(const CellType type) const = 0;
+
+  virtual
+  std::unique_ptr<CellCursor>
+  cells(const CellType type) const = 0;
+
+  // Writes the underlying Mesh_3 complex to a binary file that the load functions of
+  // the generator restore.
+  virtual
+  void
+  save(const std::string &) const
+  {
+    throw std::runtime_error(
+        "Only meshes of generate_mesh and generate_from_inr can be saved."
+        );
+  }
+
+  // Refines the mesh further with new criteria, see CGAL::refine_mesh_3. Cursors
+  // into the mesh are invalidated. The control, if given, may stop the refinement
+  // early.
+  virtual
+  void
+  refine(const MeshingOptions &, MeshingControl *)
+  {
+    throw std::runtime_error(
+        "Only meshes of generate_mesh and generate_from_inr can be refined."
+        );
+  }
+};
+
+// Non-owning view of mesh arrays, row-major like MeshData. Label pointers may be
+// null.
+struct MeshArrays {
+  const double * points = nullptr;
+  std::size_t num_points = 0;
+  const int * tetras = nullptr;
+  const int * tetra_subdomains = nullptr;
+  std::size_t num_tetras = 0;
+  const int * triangles = nullptr;
+  const int * triangle_patches = nullptr;
+  std::size_t num_triangles = 0;
+  const int * edges = nullptr;
+  const int * edge_curves = nullptr;
+  std::size_t num_edges = 0;
+
+  MeshArrays() = default;
+
+  explicit MeshArrays(const MeshData & data):
+    points(data.points.data()),
+    num_points(data.points.size() / 3),
+    tetras(data.tetras.data()),
+    tetra_subdomains(data.tetra_subdomains.empty() ? nullptr : data.tetra_subdomains.data()),
+    num_tetras(data.tetras.size() / 4),
+    triangles(data.triangles.data()),
+    triangle_patches(data.triangle_patches.empty() ? nullptr : data.triangle_patches.data()),
+    num_triangles(data.triangles.size() / 3),
+    edges(data.edges.data()),
+    edge_curves(data.edge_curves.empty() ? nullptr : data.edge_curves.data()),
+    num_edges(data.edges.size() / 2)
+  {
+  }
+};
+
+// A MeshResult on top of existing arrays. They must outlive it.
+class ArrayMeshResult: public MeshResult
+{
+  public:
+  explicit ArrayMeshResult(const MeshArrays & arrays):
+    arrays_(arrays)
+  {
+  }
+
+  virtual
+  std::size_t
+  num_points() const
+  {
+    return arrays_.num_points;
+  }
+
+  virtual
+  void
+  copy_points(const std::size_t begin, const std::size_t end, double * out) const
+  {
+    std::copy(arrays_.points + 3 * begin, arrays_.points + 3 * end, out);
+  }
+
+  virtual
+  void
+  gather_points(const int * indices, const std::size_t n, double * out) const
+  {
+    for (std::size_t k = 0; k < n; k++) {
+      std::copy_n(arrays_.points + 3 * std::size_t(indices[k]), 3, out + 3 * k);
+    }
+  }
+
+  virtual
+  std::size_t
+  num_cells(const CellType type) const
+  {
+    return block(type).count;
+  }
+
+  virtual
+  bool
+  has_labels(const CellType type) const
+  {
+    const Block b = block(type);
+    return b.count == 0 || b.labels != nullptr;
+  }
+
+  virtual
+  std::unique_ptr<CellCursor>
+  cells(const CellType type) const
+  {
+    return std::make_unique<Cursor>(block(type), nodes_per_cell(type));
+  }
+
+  private:
+  struct Block {
+    const int * nodes;
+    const int * labels;
+    std::size_t count;
+  };
+
+  Block
+  block(const CellType type) const
+  {
+    switch (type) {
+      case CellType::tetra:
+        return {arrays_.tetras, arrays_.tetra_subdomains, arrays_.num_tetras};
+      case CellType::triangle:
+        return {arrays_.triangles, arrays_.triangle_patches, arrays_.num_triangles};
+      case CellType::line:
+        return {arrays_.edges, arrays_.edge_curves, arrays_.num_edges};
+    }
+    throw std::invalid_argument("Unknown cell type.");
+  }
+
+  class Cursor: public CellCursor
+  {
+    public:
+    Cursor(const Block & block, const int nodes):
+      block_(block),
+      nodes_(nodes)
+    {
+    }
+
+    virtual
+    std::size_t
+    next(const std::size_t max_cells, int * nodes, int * labels)
+    {
+      const std::size_t m = std::min(max_cells, block_.count - position_);
+      if (nodes) {
+        std::memcpy(nodes, block_.nodes + nodes_ * position_, nodes_ * m * sizeof(int));
+      }
+      if (labels) {
+        if (block_.labels) {
+          std::memcpy(labels, block_.labels + position_, m * sizeof(int));
+        } else {
+          std::fill_n(labels, m, 0);
+        }
+      }
+      position_ += m;
+      return m;
+    }
+
+    private:
+      const Block block_;
+      const std::size_t nodes_;
+      std::size_t position_ = 0;
+  };
+
+  private:
+    const MeshArrays arrays_;
+};
+
+// Reads all of a mesh into arrays. Labels are left empty for cell types without.
+inline
+MeshData
+collect_mesh_data(const MeshResult & result)
+{
+  MeshData data;
+  data.points.resize(3 * result.num_points());
+  result.copy_points(0, result.num_points(), data.points.data());
+
+  const auto collect = [&](const CellType type, std::vector<int> & cells, std::vector<int> & labels) {
+    const std::size_t count = result.num_cells(type);
+    cells.resize(nodes_per_cell(type) * count);
+    if (result.has_labels(type)) {
+      labels.resize(count);
+    }
+    const int nodes = nodes_per_cell(type);
+    const auto cursor = result.cells(type);
+    std::size_t k = 0;
+    while (k < count) {
+      const std::size_t m = cursor->next(
+          count - k, cells.data() + nodes * k, labels.empty() ? nullptr : labels.data() + k
+          );
+      if (m == 0) {
+        throw std::runtime_error("Mesh has fewer cells than announced.");
+      }
+      k += m;
+    }
+  };
+  collect(CellType::tetra, data.tetras, data.tetra_subdomains);
+  collect(CellType::triangle, data.triangles, data.triangle_patches);
+  collect(CellType::line, data.edges, data.edge_curves);
+  return data;
+}
+
+} // namespace pygalmesh
+
+#endif // MESH_RESULT_HPP
@@ -0,0 +1,228 @@
+#ifndef MESH_SIZING_FIELD_HPP
+#define MESH_SIZING_FIELD_HPP
+
+// A sizing field given by sizes at the vertices of a tetrahedral mesh, e.g., the
+// previous mesh of an adaptive remeshing loop. The size at a point is interpolated
+// linearly in the tetrahedron that contains it; points outside of the mesh get the size
+// of the nearest vertex.
+//
+// The tetrahedron is located with a bounding volume hierarchy of the cells. The mesher
+// asks for sizes at points close to one another, so the last cell found on a thread is
+// tried first.
+
+#include "bvh.hpp"
+#include "sizing_field.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace pygalmesh {
+
+class MeshSizingField: public SizingFieldBase
+{
+  public:
+  MeshSizingField(
+      const std::vector<std::array<double, 3>> & points,
+      const std::vector<std::array<int, 4>> & cells,
+      const std::vector<double> & sizes
+      ):
+    points_(points),
+    sizes_(sizes),
+    cells_(to_cells(points, cells)),
+    cell_tree_(cell_boxes(points, cells_)),
+    point_tree_(point_boxes(points))
+  {
+    if (points.empty()) {
+      throw std::invalid_argument("Need at least one point.");
+    }
+    if (sizes.size() != points.size()) {
+      throw std::invalid_argument("Need one size per point.");
+    }
+  }
+
+  virtual ~MeshSizingField() = default;
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    // the field and the cell last found on this thread
+    thread_local const MeshSizingField * last_field = nullptr;
+    thread_local std::size_t last_cell = 0;
+
+    std::array<double, 4> weights;
+    if (last_field == this && last_cell < cells_.size() && barycentric(cells_[last_cell], x, weights)) {
+      return interpolate(cells_[last_cell], weights);
+    }
+    std::size_t found = cells_.size();
+    cell_tree_.visit(x, [&](const std::size_t k) {
+      if (barycentric(cells_[k], x, weights)) {
+        found = k;
+        return true;
+      }
+      return false;
+    });
+    if (found < cells_.size()) {
+      last_field = this;
+      last_cell = found;
+      return interpolate(cells_[found], weights);
+    }
+
+    std::size_t nearest = 0;
+    double nearest_distance = std::numeric_limits<double>::infinity();
+    point_tree_.min_distance(x, [&](const std::size_t k) {
+      const auto & p = points_[k];
+      const double d = std::sqrt(
+          (x[0] - p[0]) * (x[0] - p[0]) +
+          (x[1] - p[1]) * (x[1] - p[1]) +
+          (x[2] - p[2]) * (x[2] - p[2])
+          );
+      if (d < nearest_distance) {
+        nearest_distance = d;
+        nearest = k;
+      }
+      return d;
+    });
+    return sizes_[nearest];
+  }
+
+  private:
+  // A cell with the inverse of the matrix of its edges from the first vertex, which
+  // maps x - origin to the last three barycentric coordinates.
+  struct Cell {
+    std::array<int, 4> vertices;
+    std::array<double, 3> origin;
+    std::array<std::array<double, 3>, 3> inverse;
+  };
+
+  static
+  bool
+  barycentric(const Cell & cell, const std::array<double, 3> & x, std::array<double, 4> & weights)
+  {
+    // accepts points on the faces despite round-off
+    const double tol = 1.0e-12;
+    const std::array<double, 3> d = {
+      x[0] - cell.origin[0], x[1] - cell.origin[1], x[2] - cell.origin[2]
+    };
+    weights[0] = 1.0;
+    for (int i = 0; i < 3; i++) {
+      weights[i + 1] =
+        cell.inverse[i][0] * d[0] + cell.inverse[i][1] * d[1] + cell.inverse[i][2] * d[2];
+      weights[0] -= weights[i + 1];
+    }
+    for (int i = 0; i < 4; i++) {
+      if (weights[i] < -tol) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  double
+  interpolate(const Cell & cell, const std::array<double, 4> & weights) const
+  {
+    double size = 0.0;
+    for (int i = 0; i < 4; i++) {
+      size += weights[i] * sizes_[cell.vertices[i]];
+    }
+    return size;
+  }
+
+  // Degenerate cells are left out; the points in them are covered by their neighbors.
+  static
+  std::vector<Cell>
+  to_cells(
+      const std::vector<std::array<double, 3>> & points,
+      const std::vector<std::array<int, 4>> & cells
+      )
+  {
+    std::vector<Cell> out;
+    out.reserve(cells.size());
+    for (const auto & vertices: cells) {
+      for (const int v: vertices) {
+        if (v < 0 || std::size_t(v) >= points.size()) {
+          throw std::invalid_argument("Cell vertex index out of range.");
+        }
+      }
+      const auto & o = points[vertices[0]];
+      // columns: the edges from the first vertex
+      double e[3][3];
+      double scale = 0.0;
+      for (int j = 0; j < 3; j++) {
+        for (int i = 0; i < 3; i++) {
+          e[i][j] = points[vertices[j + 1]][i] - o[i];
+          scale = std::max(scale, std::abs(e[i][j]));
+        }
+      }
+      const double det =
+        e[0][0] * (e[1][1] * e[2][2] - e[1][2] * e[2][1]) -
+        e[0][1] * (e[1][0] * e[2][2] - e[1][2] * e[2][0]) +
+        e[0][2] * (e[1][0] * e[2][1] - e[1][1] * e[2][0]);
+      if (!(std::abs(det) > 1.0e-14 * scale * scale * scale)) {
+        continue;
+      }
+      Cell cell;
+      cell.vertices = vertices;
+      cell.origin = o;
+      for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+          // adjugate, transposed
+          const int i1 = (j + 1) % 3;
+          const int i2 = (j + 2) % 3;
+          const int j1 = (i + 1) % 3;
+          const int j2 = (i + 2) % 3;
+          cell.inverse[i][j] = (e[i1][j1] * e[i2][j2] - e[i1][j2] * e[i2][j1]) / det;
+        }
+      }
+      out.push_back(cell);
+    }
+    return out;
+  }
+
+  static
+  std::vector<BoundingBox>
+  cell_boxes(
+      const std::vector<std::array<double, 3>> & points,
+      const std::vector<Cell> & cells
+      )
+  {
+    std::vector<BoundingBox> boxes;
+    boxes.reserve(cells.size());
+    for (const auto & cell: cells) {
+      BoundingBox box = {{points[cell.vertices[0]], points[cell.vertices[0]]}};
+      for (int k = 1; k < 4; k++) {
+        box = merge(box, {{points[cell.vertices[k]], points[cell.vertices[k]]}});
+      }
+      boxes.push_back(box);
+    }
+    return boxes;
+  }
+
+  static
+  std::vector<BoundingBox>
+  point_boxes(const std::vector<std::array<double, 3>> & points)
+  {
+    std::vector<BoundingBox> boxes;
+    boxes.reserve(points.size());
+    for (const auto & p: points) {
+      boxes.push_back({{p, p}});
+    }
+    return boxes;
+  }
+
+  private:
+    const std::vector<std::array<double, 3>> points_;
+    const std::vector<double> sizes_;
+    const std::vector<Cell> cells_;
+    const BoundingVolumeHierarchy cell_tree_;
+    const BoundingVolumeHierarchy point_tree_;
+};
+
+} // namespace pygalmesh
+
+#endif // MESH_SIZING_FIELD_HPP
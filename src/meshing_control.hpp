@@ -0,0 +1,225 @@
+#ifndef MESHING_CONTROL_HPP
+#define MESHING_CONTROL_HPP
+
+// Budgets, cancellation and progress reports of a mesher run.
+//
+// The thread that meshes reports the phase it enters; another thread watches the run
+// and calls poll() now and then, which stops the run once the time limit has passed
+// or the cancel token was triggered and hands out the phases entered since. Mesh_3
+// checks the stop flag between two refinement steps and stops refining once the
+// triangulation has max_vertices vertices. The optimization steps don't check it;
+// they get the remaining time as their time limit instead.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace pygalmesh {
+
+// Lets any thread ask a run to stop.
+class CancelToken
+{
+  public:
+  void
+  cancel()
+  {
+    cancelled_ = true;
+  }
+
+  bool
+  cancelled() const
+  {
+    return cancelled_;
+  }
+
+  private:
+    std::atomic<bool> cancelled_{false};
+};
+
+class MeshingControl
+{
+  public:
+  struct Progress {
+    std::string phase;
+    std::size_t num_vertices;
+    std::size_t num_cells;
+  };
+
+  // time_limit in seconds from construction, 0 for none; max_vertices 0 for none
+  MeshingControl(
+      const double time_limit,
+      const std::size_t max_vertices,
+      const std::shared_ptr<CancelToken> & cancel_token
+      ):
+    start_(std::chrono::steady_clock::now()),
+    time_limit_(time_limit),
+    max_vertices_(max_vertices),
+    cancel_token_(cancel_token)
+  {
+  }
+
+  MeshingControl(const MeshingControl &) = delete;
+  MeshingControl & operator=(const MeshingControl &) = delete;
+
+  // for Mesh_3, which takes a non-const pointer
+  std::atomic<bool> *
+  stop_flag()
+  {
+    return &stop_;
+  }
+
+  std::size_t
+  max_vertices() const
+  {
+    return max_vertices_;
+  }
+
+  // Stops the run if the time limit has passed or the cancel token was triggered.
+  // Returns whether the run was stopped, not just capped in vertices; it shouldn't do
+  // anything more then.
+  bool
+  should_stop()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    enforce_limits();
+    return stop_;
+  }
+
+  // The time limit for a step that has its own limit, both in seconds and 0 for none.
+  double
+  time_limit_for(const double own) const
+  {
+    if (time_limit_ <= 0.0) {
+      return own;
+    }
+    const double remaining = std::max(time_limit_ - elapsed(), 1.0e-3);
+    return own > 0.0 ? std::min(own, remaining) : remaining;
+  }
+
+  double
+  elapsed() const
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+  }
+
+  // Stops the run. The first reason sticks.
+  void
+  stop(const std::string & reason)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_locked(reason);
+  }
+
+  // Records why the mesh is incomplete without stopping the run.
+  void
+  note(const std::string & reason)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_reason_.empty()) {
+      stop_reason_ = reason;
+    }
+  }
+
+  // "time_limit", "max_vertices", "cancelled" or "interrupted"; empty if the run
+  // completed.
+  std::string
+  stop_reason() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stop_reason_;
+  }
+
+  // Called by the meshing thread.
+  void
+  enter_phase(const std::string & phase, const std::size_t num_vertices, const std::size_t num_cells)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_ = {phase, num_vertices, num_cells};
+    entered_.push_back(current_);
+  }
+
+  // Called by the watching thread: enforces the time limit and the cancel token and
+  // returns the phases entered since the last call.
+  std::vector<Progress>
+  poll()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!finished_) {
+      enforce_limits();
+    }
+    std::vector<Progress> entered;
+    entered.swap(entered_);
+    return entered;
+  }
+
+  Progress
+  current() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return current_;
+  }
+
+  // Called by the meshing thread when it is done, successful or not.
+  void
+  finish()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      finished_ = true;
+    }
+    finished_changed_.notify_all();
+  }
+
+  // Waits for finish() at most the given time; returns whether it was called.
+  template <typename Duration>
+  bool
+  wait_finished(const Duration & timeout)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return finished_changed_.wait_for(lock, timeout, [&]() { return finished_; });
+  }
+
+  private:
+  void
+  stop_locked(const std::string & reason)
+  {
+    if (stop_reason_.empty()) {
+      stop_reason_ = reason;
+    }
+    stop_ = true;
+  }
+
+  void
+  enforce_limits()
+  {
+    if (time_limit_ > 0.0 && elapsed() >= time_limit_) {
+      stop_locked("time_limit");
+    }
+    if (cancel_token_ && cancel_token_->cancelled()) {
+      stop_locked("cancelled");
+    }
+  }
+
+  private:
+    const std::chrono::steady_clock::time_point start_;
+    const double time_limit_;
+    const std::size_t max_vertices_;
+    const std::shared_ptr<CancelToken> cancel_token_;
+    std::atomic<bool> stop_{false};
+    mutable std::mutex mutex_;
+    std::condition_variable finished_changed_;
+    bool finished_ = false;
+    std::string stop_reason_;
+    Progress current_ = {"", 0, 0};
+    std::vector<Progress> entered_;
+};
+
+} // namespace pygalmesh
+
+#endif // MESHING_CONTROL_HPP
@@ -0,0 +1,60 @@
+#ifndef MESHING_OPTIONS_HPP
+#define MESHING_OPTIONS_HPP
+
+// Criteria and optimization steps of one run of the Mesh_3 mesher, for refining an
+// existing mesh with CGAL::refine_mesh_3. The criteria are the ones of
+// generate_mesh(); a sizing field, if set, takes precedence over the value.
+
+#include "sizing_field.hpp"
+
+#include <limits>
+#include <memory>
+
+namespace pygalmesh {
+
+struct MeshingOptions {
+  bool lloyd = false;
+  bool odt = false;
+  bool perturb = true;
+  bool exude = true;
+  //
+  double min_edge_size_at_feature_edges = 0.0;
+  //
+  double max_edge_size_at_feature_edges_value = std::numeric_limits<double>::max();
+  std::shared_ptr<SizingFieldBase> max_edge_size_at_feature_edges_field = nullptr;
+  //
+  double min_facet_angle = 0.0;
+  //
+  double max_radius_surface_delaunay_ball_value = 0.0;
+  std::shared_ptr<SizingFieldBase> max_radius_surface_delaunay_ball_field = nullptr;
+  //
+  double max_facet_distance_value = 0.0;
+  std::shared_ptr<SizingFieldBase> max_facet_distance_field = nullptr;
+  //
+  double max_circumradius_edge_ratio = 0.0;
+  //
+  double max_cell_circumradius_value = 0.0;
+  std::shared_ptr<SizingFieldBase> max_cell_circumradius_field = nullptr;
+  //
+  double exude_time_limit = 0.0;
+  double exude_sliver_bound = 0.0;
+  //
+  bool verbose = true;
+  int seed = 0;
+  // only used for meshes that were generated in parallel, 0 for all cores
+  int num_threads = 0;
+
+  bool
+  has_sizing_fields() const
+  {
+    return
+      max_edge_size_at_feature_edges_field ||
+      max_radius_surface_delaunay_ball_field ||
+      max_facet_distance_field ||
+      max_cell_circumradius_field;
+  }
+};
+
+} // namespace pygalmesh
+
+#endif // MESHING_OPTIONS_HPP
@@ -0,0 +1,129 @@
+#ifndef NATIVE_FUNCTION_HPP
+#define NATIVE_FUNCTION_HPP
+
+// Domains and sizing fields given by the address of a native function, e.g., a numba
+// cfunc, a cffi function or a ctypes callback. The mesher calls it directly, without
+// any Python in between; it must be thread-safe if the mesher runs in parallel, and
+// it must outlive the domain or field.
+//
+// The function has the signature double(const double * x) with x pointing to the
+// three coordinates. A batched variant void(const double * x, double * out, size_t n)
+// may be given in addition; x then holds n points, one after the other.
+
+#include "domain.hpp"
+#include "sizing_field.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace pygalmesh {
+
+typedef double (*NativeEval)(const double *);
+typedef void (*NativeEvalBatch)(const double *, double *, std::size_t);
+
+class NativeDomain: public pygalmesh::DomainBase
+{
+  public:
+  NativeDomain(
+      const std::uintptr_t eval_address,
+      const double bounding_sphere_radius,
+      const std::uintptr_t eval_batch_address = 0,
+      const Features & features = {}
+      ):
+    eval_(reinterpret_cast<NativeEval>(eval_address)),
+    eval_batch_(reinterpret_cast<NativeEvalBatch>(eval_batch_address)),
+    bounding_sphere_squared_radius_(bounding_sphere_radius * bounding_sphere_radius),
+    features_(features)
+  {
+    if (eval_address == 0) {
+      throw std::invalid_argument("Need the address of the function.");
+    }
+  }
+
+  virtual ~NativeDomain() = default;
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    return eval_(x.data());
+  }
+
+  // Interleaves the coordinates into chunks for the batched function, if there is one.
+  virtual
+  void
+  eval_batch(
+      const double * x, const double * y, const double * z,
+      double * out,
+      const size_t n
+      ) const
+  {
+    if (!eval_batch_) {
+      DomainBase::eval_batch(x, y, z, out, n);
+      return;
+    }
+    constexpr size_t chunk_size = 1024;
+    std::vector<double> buffer(3 * std::min(n, chunk_size));
+    for (size_t k = 0; k < n; k += chunk_size) {
+      const size_t m = std::min(chunk_size, n - k);
+      for (size_t i = 0; i < m; i++) {
+        buffer[3 * i] = x[k + i];
+        buffer[3 * i + 1] = y[k + i];
+        buffer[3 * i + 2] = z[k + i];
+      }
+      eval_batch_(buffer.data(), out + k, m);
+    }
+  }
+
+  virtual
+  double
+  get_bounding_sphere_squared_radius() const
+  {
+    return bounding_sphere_squared_radius_;
+  }
+
+  virtual
+  Features
+  get_features() const
+  {
+    return features_;
+  };
+
+  private:
+    const NativeEval eval_;
+    const NativeEvalBatch eval_batch_;
+    const double bounding_sphere_squared_radius_;
+    const Features features_;
+};
+
+class NativeSizingField: public SizingFieldBase
+{
+  public:
+  explicit NativeSizingField(const std::uintptr_t eval_address):
+    eval_(reinterpret_cast<NativeEval>(eval_address))
+  {
+    if (eval_address == 0) {
+      throw std::invalid_argument("Need the address of the function.");
+    }
+  }
+
+  virtual ~NativeSizingField() = default;
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    return eval_(x.data());
+  }
+
+  private:
+    const NativeEval eval_;
+};
+
+} // namespace pygalmesh
+
+#endif // NATIVE_FUNCTION_HPP
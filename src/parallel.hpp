@@ -0,0 +1,124 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+// Selection of the Mesh_3 concurrency mode.
+//
+// Parallel meshing instantiates the triangulation with CGAL::Parallel_tag and needs
+// CGAL to be linked with TBB (CGAL_LINKED_WITH_TBB). The mesher sizes its grid of
+// locks from the bounding box of the mesh domain. All built-in domains are safe to
+// evaluate concurrently; domains and sizing fields implemented in Python take the GIL
+// for every call and thus serialize.
+
+#include "call_state.hpp"
+
+#include <CGAL/tags.h>
+
+#include <stdexcept>
+
+#ifdef CGAL_LINKED_WITH_TBB
+#include <tbb/task_arena.h>
+#include <tbb/task_scheduler_observer.h>
+#endif
+
+namespace pygalmesh {
+
+inline
+bool
+has_parallel_support()
+{
+#ifdef CGAL_LINKED_WITH_TBB
+  return true;
+#else
+  return false;
+#endif
+}
+
+#ifdef CGAL_LINKED_WITH_TBB
+// Makes the worker threads of an arena inherit the quiet state of the thread that
+// created it.
+class QuietArenaObserver: public tbb::task_scheduler_observer
+{
+  public:
+  QuietArenaObserver(tbb::task_arena & arena, const bool quiet):
+    tbb::task_scheduler_observer(arena),
+    quiet_(quiet)
+  {
+    observe(true);
+  }
+
+  ~QuietArenaObserver()
+  {
+    observe(false);
+  }
+
+  // The thread that executes the arena keeps its own state.
+  virtual
+  void
+  on_scheduler_entry(bool is_worker)
+  {
+    if (is_worker) {
+      is_quiet_thread() = quiet_;
+    }
+  }
+
+  virtual
+  void
+  on_scheduler_exit(bool is_worker)
+  {
+    if (is_worker) {
+      is_quiet_thread() = false;
+    }
+  }
+
+  private:
+    const bool quiet_;
+};
+#endif
+
+// Calls f(tag) for a fixed tag. With CGAL::Parallel_tag, f runs in a TBB arena with
+// num_threads threads, or as many as there are cores if num_threads is not positive.
+template <typename F>
+void
+with_concurrency(const CGAL::Sequential_tag tag, const int, const bool, const F & f)
+{
+  f(tag);
+}
+
+template <typename F>
+void
+with_concurrency(const CGAL::Parallel_tag, const int num_threads, const bool verbose, const F & f)
+{
+#ifdef CGAL_LINKED_WITH_TBB
+  tbb::task_arena arena(num_threads > 0 ? num_threads : tbb::task_arena::automatic);
+  arena.initialize();
+  const QuietArenaObserver observer(arena, !verbose);
+  arena.execute([&]() {
+    f(CGAL::Parallel_tag());
+  });
+#else
+  (void) num_threads;
+  (void) verbose;
+  (void) f;
+  throw std::runtime_error(
+      "Parallel meshing is not available, pygalmesh was built without TBB."
+      );
+#endif
+}
+
+// Calls f(CGAL::Sequential_tag()) if num_threads is 0. Otherwise, calls
+// f(CGAL::Parallel_tag()) in a TBB arena with num_threads threads, or as many as there
+// are cores if num_threads is negative.
+template <typename F>
+void
+with_concurrency(const int num_threads, const bool verbose, const F & f)
+{
+  if (num_threads == 0) {
+    with_concurrency(CGAL::Sequential_tag(), num_threads, verbose, f);
+  } else {
+    with_concurrency(CGAL::Parallel_tag(), num_threads, verbose, f);
+  }
+}
+
+} // namespace pygalmesh
+
+#endif // PARALLEL_HPP
@@ -0,0 +1,631 @@
+#ifndef PARTITION_HPP
+#define PARTITION_HPP
+
+// Domain decomposition for meshing a domain block by block.
+//
+// The bounding cuboid is split into a grid of blocks, and each block is meshed on its
+// own as the domain restricted to the block. The block faces cut the domain boundary
+// along curves, and the block edges run through the domain; both are handed to the
+// mesher as features so it protects them. They are computed from the block grid only,
+// with the same samples for a face or edge no matter which block asks, so neighboring
+// blocks get identical curves and the mesher puts the same vertices on them.
+//
+// On the faces between two blocks, a grid of lines through the domain is protected as
+// well, split at the points where the lines cross each other and the curves. Both
+// neighbors protect the same lines and give the mesher the same points on the face, so
+// they triangulate it alike. The block meshes are then concatenated, the points on the
+// faces welded, and the facets on the faces, one from either side, dropped.
+
+#include "domain.hpp"
+#include "mesh_data.hpp"
+#include "sampling.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace pygalmesh {
+
+struct Block {
+  std::array<double, 3> lo;
+  std::array<double, 3> hi;
+};
+
+// The coordinates of the block grid along each axis, n + 1 per axis.
+inline
+std::array<std::vector<double>, 3>
+block_grid(const std::array<double, 6> & bounding_cuboid, const std::array<int, 3> & counts)
+{
+  std::array<std::vector<double>, 3> grid;
+  for (int a = 0; a < 3; a++) {
+    if (counts[a] < 1) {
+      throw std::invalid_argument("The number of blocks must be positive along all axes.");
+    }
+    const double x0 = bounding_cuboid[a];
+    const double x1 = bounding_cuboid[a + 3];
+    if (!(x0 < x1)) {
+      throw std::invalid_argument("The bounding cuboid must have positive extent.");
+    }
+    grid[a].resize(counts[a] + 1);
+    for (int i = 0; i <= counts[a]; i++) {
+      grid[a][i] = i == counts[a] ? x1 : x0 + (x1 - x0) * i / counts[a];
+    }
+  }
+  return grid;
+}
+
+inline
+std::vector<Block>
+split_cuboid(const std::array<std::vector<double>, 3> & grid)
+{
+  std::vector<Block> blocks;
+  for (size_t k = 0; k + 1 < grid[2].size(); k++) {
+    for (size_t j = 0; j + 1 < grid[1].size(); j++) {
+      for (size_t i = 0; i + 1 < grid[0].size(); i++) {
+        blocks.push_back({
+            {grid[0][i], grid[1][j], grid[2][k]},
+            {grid[0][i + 1], grid[1][j + 1], grid[2][k + 1]}
+            });
+      }
+    }
+  }
+  return blocks;
+}
+
+// A domain restricted to a block. It has no features of its own; they are clipped and
+// passed to the mesher separately.
+class BlockDomain: public pygalmesh::DomainBase
+{
+  public:
+  BlockDomain(
+      const std::shared_ptr<const pygalmesh::DomainBase> & domain,
+      const Block & block
+      ):
+    domain_(domain),
+    block_(block)
+  {
+  }
+
+  virtual ~BlockDomain() = default;
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    double box = std::numeric_limits<double>::lowest();
+    for (int a = 0; a < 3; a++) {
+      box = std::max(box, (x[a] - block_.lo[a]) * (x[a] - block_.hi[a]));
+    }
+    return std::max(box, domain_->eval(x));
+  }
+
+  virtual
+  int
+  classify(const std::array<double, 3> & x) const
+  {
+    for (int a = 0; a < 3; a++) {
+      if (x[a] <= block_.lo[a] || x[a] >= block_.hi[a]) {
+        return 1;
+      }
+    }
+    return domain_->classify(x);
+  }
+
+  virtual
+  double
+  get_bounding_sphere_squared_radius() const
+  {
+    double r2 = 0.0;
+    for (int a = 0; a < 3; a++) {
+      r2 += std::max(block_.lo[a] * block_.lo[a], block_.hi[a] * block_.hi[a]);
+    }
+    return r2;
+  }
+
+  virtual
+  BoundingBox
+  get_bounding_box() const
+  {
+    return {{block_.lo, block_.hi}};
+  }
+
+  private:
+    const std::shared_ptr<const pygalmesh::DomainBase> domain_;
+    const Block block_;
+};
+
+// The parts of the edge from p along axis u to q that lie inside the domain, with n
+// samples. The ends of the parts are corners of the block or crossings.
+inline
+std::vector<Polyline>
+edge_features(
+    const pygalmesh::DomainBase & domain,
+    const std::array<double, 3> & p,
+    const int u,
+    const double end,
+    const int n
+    )
+{
+  std::vector<Polyline> polylines;
+  Polyline current;
+  std::array<double, 3> prev = p;
+  bool prev_inside = false;
+  for (int i = 0; i <= n; i++) {
+    std::array<double, 3> x = p;
+    x[u] = sample(p[u], end, i, n);
+    const bool inside = domain.classify(x) < 0;
+    if (i > 0 && inside != prev_inside) {
+      current.push_back(find_crossing(domain, prev, x));
+      if (prev_inside) {
+        polylines.push_back(current);
+        current.clear();
+      }
+    }
+    if (inside) {
+      current.push_back(x);
+    }
+    prev = x;
+    prev_inside = inside;
+  }
+  if (current.size() > 1) {
+    polylines.push_back(current);
+  }
+  return polylines;
+}
+
+// The curves along which the face of the block normal to axis a at x[a] = c cuts the
+// domain boundary, by marching squares on an n x n grid. The curves end on the face
+// boundary at the crossings edge_features() finds.
+inline
+std::vector<Polyline>
+face_features(
+    const pygalmesh::DomainBase & domain,
+    const Block & block,
+    const int a,
+    const double c,
+    const int n
+    )
+{
+  const int u = a == 0 ? 1 : 0;
+  const int v = a == 2 ? 1 : 2;
+
+  const auto node = [&](const int i, const int j) {
+    std::array<double, 3> x;
+    x[a] = c;
+    x[u] = sample(block.lo[u], block.hi[u], i, n);
+    x[v] = sample(block.lo[v], block.hi[v], j, n);
+    return x;
+  };
+
+  std::vector<char> inside((n + 1) * (n + 1));
+  for (int j = 0; j <= n; j++) {
+    for (int i = 0; i <= n; i++) {
+      inside[j * (n + 1) + i] = domain.classify(node(i, j)) < 0;
+    }
+  }
+  const auto in = [&](const int i, const int j) -> bool {
+    return inside[j * (n + 1) + i];
+  };
+
+  // Grid edges are numbered 2 (j (n + 1) + i) for the one from node (i, j) along u
+  // and 2 (j (n + 1) + i) + 1 for the one along v.
+  const auto u_edge = [&](const int i, const int j) { return 2 * (j * (n + 1) + i); };
+  const auto v_edge = [&](const int i, const int j) { return 2 * (j * (n + 1) + i) + 1; };
+
+  std::vector<std::array<int, 2>> segments;
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < n; i++) {
+      const bool s00 = in(i, j);
+      const bool s10 = in(i + 1, j);
+      const bool s01 = in(i, j + 1);
+      const bool s11 = in(i + 1, j + 1);
+      std::vector<int> crossed;
+      if (s00 != s10) crossed.push_back(u_edge(i, j));  // bottom
+      if (s10 != s11) crossed.push_back(v_edge(i + 1, j));  // right
+      if (s01 != s11) crossed.push_back(u_edge(i, j + 1));  // top
+      if (s00 != s01) crossed.push_back(v_edge(i, j));  // left
+      if (crossed.size() == 2) {
+        segments.push_back({crossed[0], crossed[1]});
+      } else if (crossed.size() == 4) {
+        // saddle; decide by the center of the cell
+        std::array<double, 3> center;
+        center[a] = c;
+        center[u] = 0.5 * (node(i, j)[u] + node(i + 1, j)[u]);
+        center[v] = 0.5 * (node(i, j)[v] + node(i, j + 1)[v]);
+        const bool center_inside = domain.classify(center) < 0;
+        if (center_inside == s00) {
+          // s00 and s11 are connected, cut off s10 and s01
+          segments.push_back({crossed[0], crossed[1]});
+          segments.push_back({crossed[2], crossed[3]});
+        } else {
+          segments.push_back({crossed[3], crossed[0]});
+          segments.push_back({crossed[1], crossed[2]});
+        }
+      }
+    }
+  }
+
+  // The crossing on a grid edge, from the node with the lower index on.
+  std::map<int, std::array<double, 3>> crossings;
+  const auto crossing = [&](const int edge) {
+    const auto it = crossings.find(edge);
+    if (it != crossings.end()) {
+      return it->second;
+    }
+    const int k = edge / 2;
+    const int i = k % (n + 1);
+    const int j = k / (n + 1);
+    const auto x = edge % 2 == 0 ?
+      find_crossing(domain, node(i, j), node(i + 1, j)) :
+      find_crossing(domain, node(i, j), node(i, j + 1));
+    crossings.emplace(edge, x);
+    return x;
+  };
+
+  // Chain the segments; every grid edge is shared by at most two of them.
+  std::map<int, std::vector<size_t>> incident;
+  for (size_t k = 0; k < segments.size(); k++) {
+    incident[segments[k][0]].push_back(k);
+    incident[segments[k][1]].push_back(k);
+  }
+  std::vector<bool> used(segments.size(), false);
+  std::vector<Polyline> polylines;
+  const auto walk = [&](const size_t first, int edge) {
+    Polyline polyline = {crossing(edge)};
+    size_t k = first;
+    while (true) {
+      used[k] = true;
+      edge = segments[k][0] == edge ? segments[k][1] : segments[k][0];
+      polyline.push_back(crossing(edge));
+      const auto & next = incident[edge];
+      const auto it = std::find_if(next.begin(), next.end(), [&](const size_t l) {
+        return !used[l];
+      });
+      if (it == next.end()) {
+        break;
+      }
+      k = *it;
+    }
+    polylines.push_back(polyline);
+  };
+  // open curves start on the face boundary, the rest are loops
+  for (const auto & entry: incident) {
+    if (entry.second.size() == 1 && !used[entry.second[0]]) {
+      walk(entry.second[0], entry.first);
+    }
+  }
+  for (size_t k = 0; k < segments.size(); k++) {
+    if (!used[k]) {
+      walk(k, segments[k][0]);
+    }
+  }
+  return polylines;
+}
+
+// The number of grid intervals along each axis for the lines protected on the faces
+// between blocks: the smallest power of two for intervals no longer than h, at most n,
+// which must be a power of two itself. The grid nodes are then samples of the block
+// edges and the marching squares of face_features().
+inline
+std::array<int, 3>
+face_grid_counts(const Block & block, const double h, const int n)
+{
+  std::array<int, 3> counts;
+  for (int a = 0; a < 3; a++) {
+    counts[a] = 1;
+    while (counts[a] < n && block.hi[a] - block.lo[a] > h * counts[a]) {
+      counts[a] *= 2;
+    }
+  }
+  return counts;
+}
+
+// The parts inside the domain of the grid lines on the face of the block normal to
+// axis a at x[a] = c, counts[u] intervals along each axis u of the face, sampled like
+// the block edges. Only interior lines; the face boundary is made of block edges.
+inline
+std::vector<Polyline>
+face_grid_lines(
+    const pygalmesh::DomainBase & domain,
+    const Block & block,
+    const int a,
+    const double c,
+    const int n,
+    const std::array<int, 3> & counts
+    )
+{
+  std::vector<Polyline> polylines;
+  for (int u = 0; u < 3; u++) {
+    if (u == a) {
+      continue;
+    }
+    const int v = 3 - a - u;
+    for (int j = 1; j < counts[v]; j++) {
+      std::array<double, 3> p;
+      p[a] = c;
+      p[u] = block.lo[u];
+      p[v] = sample(block.lo[v], block.hi[v], j * (n / counts[v]), n);
+      const auto parts = edge_features(domain, p, u, block.hi[u], n);
+      polylines.insert(polylines.end(), parts.begin(), parts.end());
+    }
+  }
+  return polylines;
+}
+
+// Splits polylines at the inner points they share with others, so that features only
+// meet at their ends.
+inline
+std::vector<Polyline>
+split_at_junctions(const std::vector<Polyline> & polylines)
+{
+  std::map<std::array<double, 3>, int> count;
+  for (const auto & polyline: polylines) {
+    std::vector<std::array<double, 3>> points(polyline.begin(), polyline.end());
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+    for (const auto & x: points) {
+      count[x]++;
+    }
+  }
+
+  std::vector<Polyline> parts;
+  for (const auto & polyline: polylines) {
+    Polyline current;
+    for (size_t i = 0; i < polyline.size(); i++) {
+      current.push_back(polyline[i]);
+      if (i > 0 && i + 1 < polyline.size() && count[polyline[i]] > 1) {
+        parts.push_back(current);
+        current = {polyline[i]};
+      }
+    }
+    parts.push_back(current);
+  }
+  return parts;
+}
+
+// All features of a block: the parts of its edges inside the domain, the curves along
+// which its faces cut the domain boundary, and the grid lines of face_grid_lines() on
+// the faces that are not on the cuboid, i.e., shared with a neighbor.
+inline
+std::vector<Polyline>
+block_features(
+    const pygalmesh::DomainBase & domain,
+    const Block & block,
+    const Block & cuboid,
+    const int n,
+    const std::array<int, 3> & counts
+    )
+{
+  std::vector<Polyline> features;
+  const auto append = [&](const std::vector<Polyline> & polylines) {
+    features.insert(features.end(), polylines.begin(), polylines.end());
+  };
+  for (int u = 0; u < 3; u++) {
+    const int v = u == 0 ? 1 : 0;
+    const int w = u == 2 ? 1 : 2;
+    for (const double cv: {block.lo[v], block.hi[v]}) {
+      for (const double cw: {block.lo[w], block.hi[w]}) {
+        std::array<double, 3> p;
+        p[u] = block.lo[u];
+        p[v] = cv;
+        p[w] = cw;
+        append(edge_features(domain, p, u, block.hi[u], n));
+      }
+    }
+  }
+  for (int a = 0; a < 3; a++) {
+    append(face_features(domain, block, a, block.lo[a], n));
+    append(face_features(domain, block, a, block.hi[a], n));
+    if (block.lo[a] != cuboid.lo[a]) {
+      append(face_grid_lines(domain, block, a, block.lo[a], n, counts));
+    }
+    if (block.hi[a] != cuboid.hi[a]) {
+      append(face_grid_lines(domain, block, a, block.hi[a], n, counts));
+    }
+  }
+  return split_at_junctions(features);
+}
+
+// Cuts polylines to the parts inside a block. origin gets the index of the polyline
+// each part comes from.
+inline
+std::vector<Polyline>
+clip_polylines(
+    const std::vector<Polyline> & polylines,
+    const Block & block,
+    std::vector<int> & origin
+    )
+{
+  std::vector<Polyline> parts;
+  origin.clear();
+  for (size_t k = 0; k < polylines.size(); k++) {
+    Polyline current;
+    const auto finish = [&]() {
+      if (current.size() > 1) {
+        parts.push_back(current);
+        origin.push_back(int(k));
+      }
+      current.clear();
+    };
+    const auto & polyline = polylines[k];
+    for (size_t i = 0; i + 1 < polyline.size(); i++) {
+      // Liang-Barsky
+      const auto & p = polyline[i];
+      const auto & q = polyline[i + 1];
+      double t0 = 0.0;
+      double t1 = 1.0;
+      bool empty = false;
+      for (int a = 0; a < 3 && !empty; a++) {
+        const double d = q[a] - p[a];
+        if (d == 0.0) {
+          empty = p[a] < block.lo[a] || p[a] > block.hi[a];
+          continue;
+        }
+        double ta = (block.lo[a] - p[a]) / d;
+        double tb = (block.hi[a] - p[a]) / d;
+        if (ta > tb) {
+          std::swap(ta, tb);
+        }
+        t0 = std::max(t0, ta);
+        t1 = std::min(t1, tb);
+        empty = t0 >= t1;
+      }
+      if (empty) {
+        finish();
+        continue;
+      }
+      const auto at = [&](const double t) {
+        if (t == 0.0) return p;
+        if (t == 1.0) return q;
+        return std::array<double, 3>{
+          p[0] + t * (q[0] - p[0]), p[1] + t * (q[1] - p[1]), p[2] + t * (q[2] - p[2])
+        };
+      };
+      if (current.empty() || t0 > 0.0) {
+        finish();
+        current.push_back(at(t0));
+      }
+      current.push_back(at(t1));
+      if (t1 < 1.0) {
+        finish();
+      }
+    }
+    finish();
+  }
+  return parts;
+}
+
+// For welding points that are at most tol apart in all coordinates and that lie on one
+// of the given planes, normal to axis a at the coordinates planes[a]: the index of the
+// point each point is merged into, the lowest of its group, or its own.
+inline
+std::vector<int>
+weld_targets(
+    const std::vector<double> & points,
+    const std::array<std::vector<double>, 3> & planes,
+    const double tol
+    )
+{
+  const size_t n = points.size() / 3;
+  const auto on_plane = [&](const size_t k) {
+    for (int a = 0; a < 3; a++) {
+      const double x = points[3 * k + a];
+      const auto it = std::lower_bound(planes[a].begin(), planes[a].end(), x - tol);
+      if (it != planes[a].end() && *it <= x + tol) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  std::vector<int> candidates;
+  for (size_t k = 0; k < n; k++) {
+    if (on_plane(k)) {
+      candidates.push_back(int(k));
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(), [&](const int i, const int j) {
+    return points[3 * i] < points[3 * j] || (points[3 * i] == points[3 * j] && i < j);
+  });
+
+  std::vector<int> target(n);
+  std::iota(target.begin(), target.end(), 0);
+  for (size_t i = 0; i < candidates.size(); i++) {
+    const int ki = candidates[i];
+    if (target[ki] != ki) {
+      continue;
+    }
+    for (size_t j = i + 1; j < candidates.size(); j++) {
+      const int kj = candidates[j];
+      if (points[3 * kj] - points[3 * ki] > tol) {
+        break;
+      }
+      if (target[kj] == kj &&
+          std::abs(points[3 * kj + 1] - points[3 * ki + 1]) <= tol &&
+          std::abs(points[3 * kj + 2] - points[3 * ki + 2]) <= tol) {
+        target[kj] = ki;
+      }
+    }
+  }
+  return target;
+}
+
+// Merges the points that are at most tol apart in all coordinates and that lie on one
+// of the given planes, normal to axis a at the coordinates planes[a]. Cells and facets
+// are renumbered, unused points are dropped.
+inline
+void
+weld_points(
+    MeshData & data,
+    const std::array<std::vector<double>, 3> & planes,
+    const double tol
+    )
+{
+  const std::vector<int> target = weld_targets(data.points, planes, tol);
+  for (auto * cells: {&data.tetras, &data.triangles, &data.edges}) {
+    for (int & k: *cells) {
+      k = target[k];
+    }
+  }
+  remove_unused_points(data);
+}
+
+// Drops the facets that lie on one of the planes, normal to axis a at the coordinates
+// planes[a]. They separate two blocks and are not part of the domain boundary. Where
+// the blocks conform, every such facet comes once from either side; returns the number
+// of those that don't have a twin.
+inline
+size_t
+drop_facets_on_planes(
+    MeshData & data,
+    const std::array<std::vector<double>, 3> & planes,
+    const double tol
+    )
+{
+  const auto on_plane = [&](const int * triangle) {
+    for (int a = 0; a < 3; a++) {
+      for (const double c: planes[a]) {
+        if (std::all_of(triangle, triangle + 3, [&](const int k) {
+              return std::abs(data.points[3 * k + a] - c) <= tol;
+            })) {
+          return true;
+        }
+      }
+    }
+    return false;
+  };
+
+  std::map<std::array<int, 3>, int> count;
+  size_t m = 0;
+  for (size_t k = 0; k < data.triangle_patches.size(); k++) {
+    if (on_plane(&data.triangles[3 * k])) {
+      std::array<int, 3> t = {data.triangles[3 * k], data.triangles[3 * k + 1], data.triangles[3 * k + 2]};
+      std::sort(t.begin(), t.end());
+      count[t]++;
+    } else {
+      std::copy_n(&data.triangles[3 * k], 3, &data.triangles[3 * m]);
+      data.triangle_patches[m] = data.triangle_patches[k];
+      m++;
+    }
+  }
+  data.triangles.resize(3 * m);
+  data.triangle_patches.resize(m);
+
+  size_t unmatched = 0;
+  for (const auto & entry: count) {
+    if (entry.second != 2) {
+      unmatched++;
+    }
+  }
+  return unmatched;
+}
+
+} // namespace pygalmesh
+
+#endif // PARTITION_HPP
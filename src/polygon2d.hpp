@@ -5,7 +5,9 @@
 
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/Polygon_2_algorithms.h>
+#include <algorithm>
 #include <array>
+#include <limits>
 #include <memory>
 #include <vector>
 
@@ -13,11 +15,23 @@ typedef CGAL::Exact_predicates_inexact_constructions_kernel K;
 
 namespace pygalmesh {
 
+// A simple polygon with a point location index.
+//
+// The y-range of the polygon is cut into as many equal bands as there are edges. A
+// containment query counts the crossings of the ray in +x direction from the point
+// with exact predicates; points on the boundary are inside. Every band lists the
+// edges with an end point in it, which are checked one by one. Edges that pass
+// through a band from bottom to top are kept in a segment tree over the bands
+// instead: every node holds the edges that pass through all of its bands, sorted
+// from left to right, and the ray crosses the ones to the right of the point. A
+// query hence bisects the log(n) nodes above its band, and the index has
+// O(n log(n)) entries even if many long edges overlap, e.g., in a comb.
 class Polygon2D {
   public:
   explicit Polygon2D(const std::vector<std::array<double, 2>> & _points):
     points(vector_to_cgal_points(_points))
   {
+    build_index();
   }
 
   virtual ~Polygon2D() = default;
@@ -34,24 +48,209 @@ class Polygon2D {
   }
 
   bool
-  is_inside(const std::array<double, 2> & point)
+  is_inside(const std::array<double, 2> & point) const
   {
-    K::Point_2 pt(point[0], point[1]);
-    switch(CGAL::bounded_side_2(this->points.begin(), this->points.end(), pt, K())) {
-      case CGAL::ON_BOUNDED_SIDE:
+    const double x = point[0];
+    const double y = point[1];
+    if (points.empty() || x < xmin_ || x > xmax_ || y < ymin_ || y > ymax_) {
+      return false;
+    }
+    const K::Point_2 pt(x, y);
+    const size_t band = get_band(y);
+    bool inside = false;
+    for (size_t k = band_offsets_[band]; k < band_offsets_[band + 1]; k++) {
+      const size_t i = band_edges_[k];
+      const K::Point_2 & a = points[i];
+      const K::Point_2 & b = points[i + 1 < points.size() ? i + 1 : 0];
+      if ((a.y() > y) != (b.y() > y)) {
+        // The edge straddles the ray; orient it upwards.
+        const auto orientation =
+          a.y() < b.y() ? CGAL::orientation(a, b, pt) : CGAL::orientation(b, a, pt);
+        if (orientation == CGAL::COLLINEAR) {
+          return true;
+        }
+        if (orientation == CGAL::LEFT_TURN) {
+          inside = !inside;
+        }
+      } else if (is_on_edge(a, b, pt)) {
+        // horizontal edges and edges touching the ray at an end point
         return true;
-      case CGAL::ON_BOUNDARY:
+      }
+    }
+    for (size_t node = num_leaves_ + band; node > 0; node /= 2) {
+      // The edges of the node all straddle the ray. The ones left of the point come
+      // first.
+      const auto begin = node_edges_.begin() + node_offsets_[node];
+      const auto end = node_edges_.begin() + node_offsets_[node + 1];
+      const auto it = std::partition_point(begin, end, [&](const size_t i) {
+        return upward_orientation(i, pt) == CGAL::RIGHT_TURN;
+      });
+      if (it != end && upward_orientation(*it, pt) == CGAL::COLLINEAR) {
         return true;
-      case CGAL::ON_UNBOUNDED_SIDE:
-        return false;
-      default:
-        return false;
+      }
+      if ((end - it) % 2 == 1) {
+        inside = !inside;
+      }
     }
-    return false;
+    return inside;
+  }
+
+  private:
+  bool
+  is_on_edge(const K::Point_2 & a, const K::Point_2 & b, const K::Point_2 & pt) const
+  {
+    return std::min(a.x(), b.x()) <= pt.x() && pt.x() <= std::max(a.x(), b.x())
+      && std::min(a.y(), b.y()) <= pt.y() && pt.y() <= std::max(a.y(), b.y())
+      && CGAL::orientation(a, b, pt) == CGAL::COLLINEAR;
+  }
+
+  // orientation of pt with respect to edge i, which connects points i and i + 1,
+  // directed upwards
+  CGAL::Orientation
+  upward_orientation(const size_t i, const K::Point_2 & pt) const
+  {
+    const K::Point_2 & a = points[i];
+    const K::Point_2 & b = points[i + 1 < points.size() ? i + 1 : 0];
+    return a.y() < b.y() ? CGAL::orientation(a, b, pt) : CGAL::orientation(b, a, pt);
+  }
+
+  // Monotonic in y, so an edge with y-range [y0, y1] is in all bands between
+  // get_band(y0) and get_band(y1), and every y in a band strictly between those two
+  // lies strictly between y0 and y1.
+  size_t
+  get_band(const double y) const
+  {
+    const double t = (y - ymin_) * inv_band_height_;
+    return t <= 0.0 ? 0 : std::min(size_t(t), num_bands_ - 1);
+  }
+
+  void
+  build_index()
+  {
+    const size_t n = points.size();
+    xmin_ = ymin_ = std::numeric_limits<double>::infinity();
+    xmax_ = ymax_ = -std::numeric_limits<double>::infinity();
+    for (const auto & pt: points) {
+      xmin_ = std::min(xmin_, pt.x());
+      xmax_ = std::max(xmax_, pt.x());
+      ymin_ = std::min(ymin_, pt.y());
+      ymax_ = std::max(ymax_, pt.y());
+    }
+    num_bands_ = std::max(n, size_t(1));
+    inv_band_height_ = ymax_ > ymin_ ? num_bands_ / (ymax_ - ymin_) : 0.0;
+    num_leaves_ = 1;
+    while (num_leaves_ < num_bands_) {
+      num_leaves_ *= 2;
+    }
+
+    // compressed band -> edges and node -> edges lists, counted first and filled in
+    // the second pass
+    band_offsets_.assign(num_bands_ + 1, 0);
+    node_offsets_.assign(2 * num_leaves_ + 1, 0);
+    std::vector<size_t> band_fill;
+    std::vector<size_t> node_fill;
+    for (int pass = 0; pass < 2; pass++) {
+      for (size_t i = 0; i < n; i++) {
+        const auto add_to_band = [&](const size_t band) {
+          if (pass == 0) {
+            band_offsets_[band + 1]++;
+          } else {
+            band_edges_[band_fill[band]++] = i;
+          }
+        };
+        const auto add_to_node = [&](const size_t node) {
+          if (pass == 0) {
+            node_offsets_[node + 1]++;
+          } else {
+            node_edges_[node_fill[node]++] = i;
+          }
+        };
+        const auto range = get_band_range(i);
+        add_to_band(range[0]);
+        if (range[1] != range[0]) {
+          add_to_band(range[1]);
+        }
+        // canonical nodes of the bands the edge passes through
+        size_t l = num_leaves_ + range[0] + 1;
+        size_t r = num_leaves_ + range[1];
+        for (; l < r; l /= 2, r /= 2) {
+          if (l & 1) {
+            add_to_node(l++);
+          }
+          if (r & 1) {
+            add_to_node(--r);
+          }
+        }
+      }
+      if (pass == 0) {
+        for (size_t band = 0; band < num_bands_; band++) {
+          band_offsets_[band + 1] += band_offsets_[band];
+        }
+        for (size_t node = 0; node < 2 * num_leaves_; node++) {
+          node_offsets_[node + 1] += node_offsets_[node];
+        }
+        band_edges_.resize(band_offsets_[num_bands_]);
+        node_edges_.resize(node_offsets_[2 * num_leaves_]);
+        band_fill.assign(band_offsets_.begin(), band_offsets_.end() - 1);
+        node_fill.assign(node_offsets_.begin(), node_offsets_.end() - 1);
+      }
+    }
+
+    // The edges of a node don't cross in its bands, so their order along any
+    // horizontal line through the first band is the same as along the ray.
+    for (size_t node = 1; node < 2 * num_leaves_; node++) {
+      if (node_offsets_[node] == node_offsets_[node + 1]) {
+        continue;
+      }
+      size_t leaf = node;
+      while (leaf < num_leaves_) {
+        leaf *= 2;
+      }
+      const double y = ymin_ + (double(leaf - num_leaves_) + 0.5) / inv_band_height_;
+      const K::Point_2 pt(0.0, y);
+      std::sort(
+        node_edges_.begin() + node_offsets_[node],
+        node_edges_.begin() + node_offsets_[node + 1],
+        [&](const size_t i, const size_t j) {
+          return CGAL::compare_x_at_y(pt, get_line(i), get_line(j)) == CGAL::SMALLER;
+        }
+      );
+    }
+  }
+
+  // the bands overlapped by edge i, which connects points i and i + 1
+  std::array<size_t, 2>
+  get_band_range(const size_t i) const
+  {
+    const double y0 = points[i].y();
+    const double y1 = points[i + 1 < points.size() ? i + 1 : 0].y();
+    return {get_band(std::min(y0, y1)), get_band(std::max(y0, y1))};
+  }
+
+  K::Line_2
+  get_line(const size_t i) const
+  {
+    return K::Line_2(points[i], points[i + 1 < points.size() ? i + 1 : 0]);
   }
 
   public:
   const std::vector<K::Point_2> points;
+
+  private:
+  double xmin_;
+  double xmax_;
+  double ymin_;
+  double ymax_;
+  size_t num_bands_;
+  double inv_band_height_;
+  // edges with an end point in the band
+  std::vector<size_t> band_offsets_;
+  std::vector<size_t> band_edges_;
+  // segment tree over the bands, node k has the children 2k and 2k + 1 and leaf
+  // num_leaves_ + band
+  size_t num_leaves_;
+  std::vector<size_t> node_offsets_;
+  std::vector<size_t> node_edges_;
 };
 
 
@@ -66,12 +265,44 @@ class Extrude: public pygalmesh::DomainBase {
     poly_(poly),
     direction_(direction),
     alpha_(alpha),
-    max_edge_size_at_feature_edges_(max_edge_size_at_feature_edges)
+    max_edge_size_at_feature_edges_(max_edge_size_at_feature_edges),
+    rotations_(tabulate_rotations(alpha))
   {
   }
 
   virtual ~Extrude() = default;
 
+  // {sin, cos} of the twist angle at num_rotations + 1 equidistant heights
+  std::vector<std::array<double, 2>>
+  tabulate_rotations(const double alpha) const
+  {
+    std::vector<std::array<double, 2>> rotations;
+    if (alpha != 0.0) {
+      for (size_t k = 0; k <= num_rotations; k++) {
+        const double angle = alpha * double(k) / num_rotations;
+        rotations.push_back({sin(angle), cos(angle)});
+      }
+    }
+    return rotations;
+  }
+
+  // sin and cos of beta*alpha_ from the closest tabulated angle below by the angle
+  // addition theorem. The remainder is at most alpha_/num_rotations, so a few Taylor
+  // terms are exact to machine precision.
+  void
+  get_rotation(const double beta, double & sinAlpha, double & cosAlpha) const
+  {
+    const double t = beta * num_rotations;
+    const size_t k = std::min(size_t(t), size_t(num_rotations));
+    const double d = (t - double(k)) * alpha_ / num_rotations;
+    const double d2 = d*d;
+    const double sin_d = d * (1.0 - d2/6.0 * (1.0 - d2/20.0));
+    const double cos_d = 1.0 - d2/2.0 * (1.0 - d2/12.0 * (1.0 - d2/30.0));
+    const auto & r = rotations_[k];
+    sinAlpha = r[0] * cos_d + r[1] * sin_d;
+    cosAlpha = r[1] * cos_d - r[0] * sin_d;
+  }
+
   virtual
   double
   eval(const std::array<double, 3> & x) const
@@ -90,8 +321,9 @@ class Extrude: public pygalmesh::DomainBase {
     if (alpha_ != 0.0) {
       std::array<double, 2> x3;
       // turn by -beta*alpha
-      const double sinAlpha = sin(beta*alpha_);
-      const double cosAlpha = cos(beta*alpha_);
+      double sinAlpha;
+      double cosAlpha;
+      get_rotation(beta, sinAlpha, cosAlpha);
       x3[0] =  cosAlpha * x2[0] + sinAlpha * x2[1];
       x3[1] = -sinAlpha * x2[0] + cosAlpha * x2[1];
       x2 = x3;
@@ -126,6 +358,40 @@ class Extrude: public pygalmesh::DomainBase {
     return max;
   }
 
+  virtual
+  BoundingBox
+  get_bounding_box() const
+  {
+    const double inf = std::numeric_limits<double>::infinity();
+    std::array<double, 2> lower = {inf, inf};
+    std::array<double, 2> upper = {-inf, -inf};
+    double r2 = 0.0;
+    for (const auto & pt: poly_->points) {
+      lower = {std::min(lower[0], pt.x()), std::min(lower[1], pt.y())};
+      upper = {std::max(upper[0], pt.x()), std::max(upper[1], pt.y())};
+      r2 = std::max(r2, pt.x()*pt.x() + pt.y()*pt.y());
+    }
+    if (alpha_ != 0.0) {
+      // the twisted polygon stays in the disk around the origin
+      const double r = sqrt(r2);
+      lower = {-r, -r};
+      upper = {r, r};
+    }
+    // the sections move along the direction from the bottom to the top
+    return {{
+      {
+        lower[0] + std::min(0.0, direction_[0]),
+        lower[1] + std::min(0.0, direction_[1]),
+        0.0
+      },
+      {
+        upper[0] + std::max(0.0, direction_[0]),
+        upper[1] + std::max(0.0, direction_[1]),
+        direction_[2]
+      }
+    }};
+  }
+
   virtual
   DomainBase::Features
   get_features() const
@@ -232,6 +498,8 @@ class Extrude: public pygalmesh::DomainBase {
   const std::array<double, 3> direction_;
   const double alpha_;
   const double max_edge_size_at_feature_edges_;
+  static constexpr size_t num_rotations = 1024;
+  const std::vector<std::array<double, 2>> rotations_;
 };
 
 
@@ -273,6 +541,21 @@ class ring_extrude: public pygalmesh::DomainBase {
     return max;
   }
 
+  virtual
+  BoundingBox
+  get_bounding_box() const
+  {
+    double r = 0.0;
+    double zmin = std::numeric_limits<double>::infinity();
+    double zmax = -zmin;
+    for (const auto & pt: poly_->points) {
+      r = std::max(r, std::abs(pt.x()));
+      zmin = std::min(zmin, pt.y());
+      zmax = std::max(zmax, pt.y());
+    }
+    return {{{-r, -r, zmin}, {r, r, zmax}}};
+  }
+
   virtual
   DomainBase::Features
   get_features() const
@@ -0,0 +1,50 @@
+#ifndef POLYGON_SOUP_HPP
+#define POLYGON_SOUP_HPP
+
+// In-memory triangle surfaces as input of the generators. The bindings map NumPy
+// arrays onto these without copying.
+
+#include <Eigen/Dense>
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace pygalmesh {
+
+typedef Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor>> VertexArray;
+typedef Eigen::Ref<const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor>> FaceArray;
+
+// Converts vertex and triangle arrays into a CGAL polygon soup.
+template <typename Point>
+void
+to_polygon_soup(
+    const VertexArray & vertices,
+    const FaceArray & faces,
+    std::vector<Point> & points,
+    std::vector<std::vector<std::size_t>> & polygons
+    )
+{
+  if (faces.rows() == 0) {
+    throw std::invalid_argument("The surface mesh needs at least one face.");
+  }
+  if (faces.minCoeff() < 0 || faces.maxCoeff() >= vertices.rows()) {
+    throw std::invalid_argument("Face vertex index out of range.");
+  }
+  points.clear();
+  points.reserve(vertices.rows());
+  for (Eigen::Index k = 0; k < vertices.rows(); k++) {
+    points.emplace_back(vertices(k, 0), vertices(k, 1), vertices(k, 2));
+  }
+  polygons.clear();
+  polygons.reserve(faces.rows());
+  for (Eigen::Index k = 0; k < faces.rows(); k++) {
+    polygons.push_back({
+      std::size_t(faces(k, 0)), std::size_t(faces(k, 1)), std::size_t(faces(k, 2))
+    });
+  }
+}
+
+} // namespace pygalmesh
+
+#endif // POLYGON_SOUP_HPP
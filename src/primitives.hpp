@@ -14,7 +14,10 @@
 
 #include "domain.hpp"
 
+#include <algorithm>
+#include <limits>
 #include <memory>
+#include <stdexcept>
 #include <vector>
 
 namespace pygalmesh {
@@ -44,6 +47,26 @@ class Ball: public pygalmesh::DomainBase
       return xx0*xx0 + yy0*yy0 + zz0*zz0 - radius_*radius_;
     }
 
+    virtual
+    void
+    eval_batch(
+        const double * x, const double * y, const double * z,
+        double * out,
+        const size_t n
+        ) const
+    {
+      const double a = x0_[0];
+      const double b = x0_[1];
+      const double c = x0_[2];
+      const double r2 = radius_*radius_;
+      simd::map(x, y, z, out, n, [&](const auto & px, const auto & py, const auto & pz) {
+        const auto xx0 = px - a;
+        const auto yy0 = py - b;
+        const auto zz0 = pz - c;
+        return xx0*xx0 + yy0*yy0 + zz0*zz0 - r2;
+      });
+    }
+
     virtual
     double
     get_bounding_sphere_squared_radius() const
@@ -52,6 +75,18 @@ class Ball: public pygalmesh::DomainBase
       return (x0_nrm + radius_) * (x0_nrm + radius_);
     }
 
+    virtual
+    BoundingBox
+    get_bounding_box() const
+    {
+      return {{
+        {x0_[0] - radius_, x0_[1] - radius_, x0_[2] - radius_},
+        {x0_[0] + radius_, x0_[1] + radius_, x0_[2] + radius_}
+      }};
+    }
+
+  friend class CompiledDomain;
+
   private:
     const std::array<double, 3> x0_;
     const double radius_;
@@ -85,6 +120,26 @@ class Cuboid: public pygalmesh::DomainBase
           );
     }
 
+    virtual
+    void
+    eval_batch(
+        const double * x, const double * y, const double * z,
+        double * out,
+        const size_t n
+        ) const
+    {
+      const std::array<double, 3> a = x0_;
+      const std::array<double, 3> b = x1_;
+      simd::map(x, y, z, out, n, [&](const auto & px, const auto & py, const auto & pz) {
+        return simd::max(simd::max(
+            (px - a[0]) * (px - b[0]),
+            (py - a[1]) * (py - b[1])
+            ),
+            (pz - a[2]) * (pz - b[2])
+            );
+      });
+    }
+
     virtual
     double
     get_bounding_sphere_squared_radius() const
@@ -94,6 +149,16 @@ class Cuboid: public pygalmesh::DomainBase
       return std::max({x0_nrm2, x1_nrm2});
     }
 
+    virtual
+    BoundingBox
+    get_bounding_box() const
+    {
+      return {{
+        {std::min(x0_[0], x1_[0]), std::min(x0_[1], x1_[1]), std::min(x0_[2], x1_[2])},
+        {std::max(x0_[0], x1_[0]), std::max(x0_[1], x1_[1]), std::max(x0_[2], x1_[2])}
+      }};
+    }
+
     virtual
     Features
     get_features() const
@@ -124,6 +189,8 @@ class Cuboid: public pygalmesh::DomainBase
         };
     };
 
+  friend class CompiledDomain;
+
   private:
     const std::array<double, 3> x0_;
     const std::array<double, 3> x1_;
@@ -158,6 +225,26 @@ class Ellipsoid: public pygalmesh::DomainBase
       return xx0*xx0/a0_2_ + yy0*yy0/a1_2_ + zz0*zz0/a2_2_ - 1.0;
     }
 
+    virtual
+    void
+    eval_batch(
+        const double * x, const double * y, const double * z,
+        double * out,
+        const size_t n
+        ) const
+    {
+      const std::array<double, 3> c = x0_;
+      const double a0_2 = a0_2_;
+      const double a1_2 = a1_2_;
+      const double a2_2 = a2_2_;
+      simd::map(x, y, z, out, n, [&](const auto & px, const auto & py, const auto & pz) {
+        const auto xx0 = px - c[0];
+        const auto yy0 = py - c[1];
+        const auto zz0 = pz - c[2];
+        return xx0*xx0/a0_2 + yy0*yy0/a1_2 + zz0*zz0/a2_2 - 1.0;
+      });
+    }
+
     virtual
     double
     get_bounding_sphere_squared_radius() const
@@ -167,6 +254,21 @@ class Ellipsoid: public pygalmesh::DomainBase
       return (x0_nrm + radius) * (x0_nrm + radius);
     }
 
+    virtual
+    BoundingBox
+    get_bounding_box() const
+    {
+      const double a0 = sqrt(a0_2_);
+      const double a1 = sqrt(a1_2_);
+      const double a2 = sqrt(a2_2_);
+      return {{
+        {x0_[0] - a0, x0_[1] - a1, x0_[2] - a2},
+        {x0_[0] + a0, x0_[1] + a1, x0_[2] + a2}
+      }};
+    }
+
+  friend class CompiledDomain;
+
   private:
     const std::array<double, 3> x0_;
     const double a0_2_;
@@ -204,6 +306,22 @@ class Cylinder: public pygalmesh::DomainBase
       return std::max({rdist, z0dist, z1dist});
     }
 
+    virtual
+    void
+    eval_batch(
+        const double * x, const double * y, const double * z,
+        double * out,
+        const size_t n
+        ) const
+    {
+      const double z0 = z0_;
+      const double z1 = z1_;
+      const double r2 = radius_*radius_;
+      simd::map(x, y, z, out, n, [&](const auto & px, const auto & py, const auto & pz) {
+        return simd::max(simd::max(px*px + py*py - r2, z0 - pz), pz - z1);
+      });
+    }
+
     virtual
     double
     get_bounding_sphere_squared_radius() const
@@ -212,6 +330,13 @@ class Cylinder: public pygalmesh::DomainBase
       return zmax*zmax + radius_*radius_;
     }
 
+    virtual
+    BoundingBox
+    get_bounding_box() const
+    {
+      return {{{-radius_, -radius_, z0_}, {radius_, radius_, z1_}}};
+    }
+
     virtual
     Features
     get_features() const
@@ -232,6 +357,8 @@ class Cylinder: public pygalmesh::DomainBase
       return {circ0, circ1};
     };
 
+  friend class CompiledDomain;
+
   private:
     const double z0_;
     const double z1_;
@@ -269,6 +396,26 @@ class Cone: public pygalmesh::DomainBase
         1.0;
     }
 
+    virtual
+    void
+    eval_batch(
+        const double * x, const double * y, const double * z,
+        double * out,
+        const size_t n
+        ) const
+    {
+      const double radius = radius_;
+      const double height = height_;
+      simd::map(x, y, z, out, n, [&](const auto & px, const auto & py, const auto & pz) {
+        const auto rad = radius * (1.0 - pz / height);
+        return simd::select(
+            simd::logical_and(simd::lt(0.0, pz), simd::lt(pz, height)),
+            px*px + py*py - rad*rad,
+            1.0
+            );
+      });
+    }
+
     virtual
     double
     get_bounding_sphere_squared_radius() const
@@ -277,6 +424,13 @@ class Cone: public pygalmesh::DomainBase
       return max*max;
     }
 
+    virtual
+    BoundingBox
+    get_bounding_box() const
+    {
+      return {{{-radius_, -radius_, 0.0}, {radius_, radius_, height_}}};
+    }
+
     virtual
     Features
     get_features() const
@@ -293,6 +447,8 @@ class Cone: public pygalmesh::DomainBase
       return {circ0};
     };
 
+  friend class CompiledDomain;
+
   private:
     const double radius_;
     const double height_;
@@ -313,11 +469,14 @@ class Tetrahedron: public pygalmesh::DomainBase
       x1_(Eigen::Vector3d(x1.data())),
       x2_(Eigen::Vector3d(x2.data())),
       x3_(Eigen::Vector3d(x3.data())),
-      A_(constructA(x0, x1, x2, x3))
+      Ainv_(constructAinv(x0, x1, x2, x3))
     {
     }
 
-    Eigen::Matrix4d constructA(
+    // The barycentric coordinates of x are Ainv * [x, 1], where the columns of A are
+    // the vertices [xi, 1]. Invert once here rather than factorizing A for every eval.
+    std::array<std::array<double, 4>, 4>
+    constructAinv(
         const std::array<double, 3> & x0,
         const std::array<double, 3> & x1,
         const std::array<double, 3> & x2,
@@ -328,7 +487,14 @@ class Tetrahedron: public pygalmesh::DomainBase
            x0[1], x1[1], x2[1], x3[1],
            x0[2], x1[2], x2[2], x3[2],
            1.0,   1.0,   1.0,   1.0;
-      return A;
+      const Eigen::Matrix4d Ainv = A.inverse();
+      std::array<std::array<double, 4>, 4> out;
+      for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+          out[i][j] = Ainv(i, j);
+        }
+      }
+      return out;
     }
 
     virtual ~Tetrahedron() = default;
@@ -353,10 +519,11 @@ class Tetrahedron: public pygalmesh::DomainBase
     double
     eval(const std::array<double, 3> & x) const
     {
-      Eigen::Vector4d b;
-      b << x[0], x[1], x[2], 1.0;
-      Eigen::Vector4d bary = A_.partialPivLu().solve(b);
-      return -bary.minCoeff();
+      double min = std::numeric_limits<double>::max();
+      for (const auto & row: Ainv_) {
+        min = std::min(min, row[0]*x[0] + row[1]*x[1] + row[2]*x[2] + row[3]);
+      }
+      return -min;
 
       // Eigen::Vector3d pvec(x.data());
       // const bool a =
@@ -367,6 +534,24 @@ class Tetrahedron: public pygalmesh::DomainBase
       // return a ? -1.0 : 1.0;
     }
 
+    virtual
+    void
+    eval_batch(
+        const double * x, const double * y, const double * z,
+        double * out,
+        const size_t n
+        ) const
+    {
+      const std::array<std::array<double, 4>, 4> B = Ainv_;
+      simd::map(x, y, z, out, n, [&](const auto & px, const auto & py, const auto & pz) {
+        const auto b0 = B[0][0]*px + B[0][1]*py + B[0][2]*pz + B[0][3];
+        const auto b1 = B[1][0]*px + B[1][1]*py + B[1][2]*pz + B[1][3];
+        const auto b2 = B[2][0]*px + B[2][1]*py + B[2][2]*pz + B[2][3];
+        const auto b3 = B[3][0]*px + B[3][1]*py + B[3][2]*pz + B[3][3];
+        return -simd::min(simd::min(b0, b1), simd::min(b2, b3));
+      });
+    }
+
     virtual
     double
     get_bounding_sphere_squared_radius() const
@@ -379,6 +564,15 @@ class Tetrahedron: public pygalmesh::DomainBase
           });
     }
 
+    virtual
+    BoundingBox
+    get_bounding_box() const
+    {
+      const Eigen::Vector3d lower = x0_.cwiseMin(x1_).cwiseMin(x2_).cwiseMin(x3_);
+      const Eigen::Vector3d upper = x0_.cwiseMax(x1_).cwiseMax(x2_).cwiseMax(x3_);
+      return {{{lower[0], lower[1], lower[2]}, {upper[0], upper[1], upper[2]}}};
+    }
+
     virtual
     Features
     get_features() const
@@ -399,12 +593,285 @@ class Tetrahedron: public pygalmesh::DomainBase
         };
     };
 
+  friend class CompiledDomain;
+
   private:
     const Eigen::Vector3d x0_;
     const Eigen::Vector3d x1_;
     const Eigen::Vector3d x2_;
     const Eigen::Vector3d x3_;
-    const Eigen::Matrix4d A_;
+    const std::array<std::array<double, 4>, 4> Ainv_;
+};
+
+
+// The convex polyhedron {x: n_i.x < d_i for all i}, given by outward normals n_i and
+// offsets d_i. The planes must bound it. Its vertices and edges are computed once from
+// the plane triples and pairs, which is cubic in the number of planes.
+class ConvexPolyhedron: public pygalmesh::DomainBase
+{
+  public:
+    ConvexPolyhedron(
+        const std::vector<std::array<double, 3>> & normals,
+        const std::vector<double> & offsets
+        ):
+      planes_(construct_planes(normals, offsets)),
+      vertices_(compute_vertices(planes_)),
+      edges_(compute_edges(planes_, vertices_))
+    {
+      // Without vertices, the half-spaces don't intersect or contain a line.
+      if (vertices_.empty() || has_unbounded_direction(planes_)) {
+        throw std::invalid_argument("The half-spaces don't bound a finite region.");
+      }
+      if (!spans_volume(vertices_)) {
+        throw std::invalid_argument("The half-spaces bound a region without volume.");
+      }
+    }
+
+    virtual ~ConvexPolyhedron() = default;
+
+    std::vector<std::array<double, 4>>
+    construct_planes(
+        const std::vector<std::array<double, 3>> & normals,
+        const std::vector<double> & offsets
+    ) const {
+      if (normals.size() != offsets.size()) {
+        throw std::invalid_argument("Need as many normals as offsets.");
+      }
+      if (normals.empty()) {
+        throw std::invalid_argument("Need at least one plane.");
+      }
+      std::vector<std::array<double, 4>> planes;
+      for (size_t k = 0; k < normals.size(); k++) {
+        planes.push_back({normals[k][0], normals[k][1], normals[k][2], offsets[k]});
+      }
+      return planes;
+    }
+
+    // The points where three planes meet and that don't violate any other plane.
+    std::vector<Eigen::Vector3d>
+    compute_vertices(const std::vector<std::array<double, 4>> & planes) const
+    {
+      std::vector<Eigen::Vector3d> vertices;
+      const size_t n = planes.size();
+      for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+          for (size_t k = j + 1; k < n; k++) {
+            Eigen::Matrix3d M;
+            M << planes[i][0], planes[i][1], planes[i][2],
+                 planes[j][0], planes[j][1], planes[j][2],
+                 planes[k][0], planes[k][1], planes[k][2];
+            const double scale = M.row(0).norm() * M.row(1).norm() * M.row(2).norm();
+            if (std::abs(M.determinant()) <= 1.0e-12 * scale) {
+              continue;
+            }
+            const Eigen::Vector3d v = M.partialPivLu().solve(
+                Eigen::Vector3d(planes[i][3], planes[j][3], planes[k][3])
+                );
+            if (!is_on_boundary(planes, v)) {
+              continue;
+            }
+            bool is_new = true;
+            for (const auto & w: vertices) {
+              if ((v - w).norm() <= tolerance(v)) {
+                is_new = false;
+                break;
+              }
+            }
+            if (is_new) {
+              vertices.push_back(v);
+            }
+          }
+        }
+      }
+      return vertices;
+    }
+
+    // Two faces are adjacent if they share two vertices; the edge connects the
+    // outermost ones along the intersection line.
+    Features
+    compute_edges(
+        const std::vector<std::array<double, 4>> & planes,
+        const std::vector<Eigen::Vector3d> & vertices
+    ) const {
+      Features edges;
+      for (size_t i = 0; i < planes.size(); i++) {
+        for (size_t j = i + 1; j < planes.size(); j++) {
+          const Eigen::Vector3d ni(planes[i][0], planes[i][1], planes[i][2]);
+          const Eigen::Vector3d nj(planes[j][0], planes[j][1], planes[j][2]);
+          const Eigen::Vector3d t = ni.cross(nj);
+          if (t.norm() <= 1.0e-12 * ni.norm() * nj.norm()) {
+            continue;
+          }
+          double tmin = std::numeric_limits<double>::max();
+          double tmax = std::numeric_limits<double>::lowest();
+          Eigen::Vector3d vmin = Eigen::Vector3d::Zero();
+          Eigen::Vector3d vmax = Eigen::Vector3d::Zero();
+          for (const auto & v: vertices) {
+            if (!is_on_plane(planes[i], v) || !is_on_plane(planes[j], v)) {
+              continue;
+            }
+            const double tv = t.dot(v);
+            if (tv < tmin) {
+              tmin = tv;
+              vmin = v;
+            }
+            if (tv > tmax) {
+              tmax = tv;
+              vmax = v;
+            }
+          }
+          if (tmin < tmax && (vmax - vmin).norm() > tolerance(vmin)) {
+            edges.push_back({
+                {vmin[0], vmin[1], vmin[2]},
+                {vmax[0], vmax[1], vmax[2]}
+                });
+          }
+        }
+      }
+      return edges;
+    }
+
+    // Whether a direction d points into all half-spaces, n.d <= 0 for all normals n.
+    // The region has vertices, so the cone of these directions has no lines, and if it
+    // has rays, its edges are among the intersection lines of two of the planes.
+    bool
+    has_unbounded_direction(const std::vector<std::array<double, 4>> & planes) const
+    {
+      for (size_t i = 0; i < planes.size(); i++) {
+        for (size_t j = i + 1; j < planes.size(); j++) {
+          const Eigen::Vector3d ni(planes[i][0], planes[i][1], planes[i][2]);
+          const Eigen::Vector3d nj(planes[j][0], planes[j][1], planes[j][2]);
+          const Eigen::Vector3d t = ni.cross(nj);
+          if (t.norm() <= 1.0e-12 * ni.norm() * nj.norm()) {
+            continue;
+          }
+          for (const double sign: {1.0, -1.0}) {
+            const Eigen::Vector3d d = sign * t;
+            const bool unbounded = std::all_of(planes.begin(), planes.end(), [&](const auto & p) {
+              const Eigen::Vector3d n(p[0], p[1], p[2]);
+              return n.dot(d) <= 1.0e-12 * n.norm() * d.norm();
+            });
+            if (unbounded) {
+              return true;
+            }
+          }
+        }
+      }
+      return false;
+    }
+
+    bool
+    spans_volume(const std::vector<Eigen::Vector3d> & vertices) const
+    {
+      if (vertices.size() < 4) {
+        return false;
+      }
+      Eigen::MatrixXd D(3, vertices.size() - 1);
+      for (size_t k = 1; k < vertices.size(); k++) {
+        D.col(k - 1) = vertices[k] - vertices[0];
+      }
+      Eigen::FullPivLU<Eigen::MatrixXd> lu(D);
+      lu.setThreshold(1.0e-10);
+      return lu.rank() == 3;
+    }
+
+    double
+    tolerance(const Eigen::Vector3d & v) const
+    {
+      return 1.0e-10 * (1.0 + v.norm());
+    }
+
+    bool
+    is_on_plane(const std::array<double, 4> & plane, const Eigen::Vector3d & v) const
+    {
+      const Eigen::Vector3d nrm(plane[0], plane[1], plane[2]);
+      return std::abs(nrm.dot(v) - plane[3]) <= tolerance(v) * nrm.norm();
+    }
+
+    bool
+    is_on_boundary(
+        const std::vector<std::array<double, 4>> & planes,
+        const Eigen::Vector3d & v
+    ) const {
+      for (const auto & plane: planes) {
+        const Eigen::Vector3d nrm(plane[0], plane[1], plane[2]);
+        if (nrm.dot(v) - plane[3] > tolerance(v) * nrm.norm()) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    virtual
+    double
+    eval(const std::array<double, 3> & x) const
+    {
+      double max = std::numeric_limits<double>::lowest();
+      for (const auto & p: planes_) {
+        max = std::max(max, p[0]*x[0] + p[1]*x[1] + p[2]*x[2] - p[3]);
+      }
+      return max;
+    }
+
+    virtual
+    void
+    eval_batch(
+        const double * x, const double * y, const double * z,
+        double * out,
+        const size_t n
+        ) const
+    {
+      const std::vector<std::array<double, 4>> & planes = planes_;
+      simd::map(x, y, z, out, n, [&](const auto & px, const auto & py, const auto & pz) {
+        // planes_ is never empty
+        auto max = planes[0][0]*px + planes[0][1]*py + planes[0][2]*pz - planes[0][3];
+        for (size_t k = 1; k < planes.size(); k++) {
+          const auto & p = planes[k];
+          max = simd::max(max, p[0]*px + p[1]*py + p[2]*pz - p[3]);
+        }
+        return max;
+      });
+    }
+
+    virtual
+    double
+    get_bounding_sphere_squared_radius() const
+    {
+      double max = 0.0;
+      for (const auto & v: vertices_) {
+        max = std::max(max, v.squaredNorm());
+      }
+      return max;
+    }
+
+    virtual
+    BoundingBox
+    get_bounding_box() const
+    {
+      const double inf = std::numeric_limits<double>::infinity();
+      BoundingBox box = {{{inf, inf, inf}, {-inf, -inf, -inf}}};
+      for (const auto & v: vertices_) {
+        for (int i = 0; i < 3; i++) {
+          box[0][i] = std::min(box[0][i], v[i]);
+          box[1][i] = std::max(box[1][i], v[i]);
+        }
+      }
+      return box;
+    }
+
+    virtual
+    Features
+    get_features() const
+    {
+      return edges_;
+    };
+
+  friend class CompiledDomain;
+
+  private:
+    const std::vector<std::array<double, 4>> planes_;
+    const std::vector<Eigen::Vector3d> vertices_;
+    const Features edges_;
 };
 
 
@@ -433,6 +900,22 @@ class Torus: public pygalmesh::DomainBase
         );
     }
 
+    virtual
+    void
+    eval_batch(
+        const double * x, const double * y, const double * z,
+        double * out,
+        const size_t n
+        ) const
+    {
+      const double major_radius = major_radius_;
+      const double minor_radius2 = minor_radius_*minor_radius_;
+      simd::map(x, y, z, out, n, [&](const auto & px, const auto & py, const auto & pz) {
+        const auto r = simd::sqrt(px*px + py*py) - major_radius;
+        return r*r + pz*pz - minor_radius2;
+      });
+    }
+
     virtual
     double
     get_bounding_sphere_squared_radius() const
@@ -440,6 +923,16 @@ class Torus: public pygalmesh::DomainBase
       return (major_radius_ + minor_radius_)*(major_radius_ + minor_radius_);
     }
 
+    virtual
+    BoundingBox
+    get_bounding_box() const
+    {
+      const double r = major_radius_ + minor_radius_;
+      return {{{-r, -r, -minor_radius_}, {r, r, minor_radius_}}};
+    }
+
+  friend class CompiledDomain;
+
   private:
     const double major_radius_;
     const double minor_radius_;
@@ -469,6 +962,21 @@ class HalfSpace: public pygalmesh::DomainBase
       return n_[0]*x[0] + n_[1]*x[1] + n_[2]*x[2] - alpha_;
     }
 
+    virtual
+    void
+    eval_batch(
+        const double * x, const double * y, const double * z,
+        double * out,
+        const size_t n
+        ) const
+    {
+      const std::array<double, 3> nrm = n_;
+      const double alpha = alpha_;
+      simd::map(x, y, z, out, n, [&](const auto & px, const auto & py, const auto & pz) {
+        return nrm[0]*px + nrm[1]*py + nrm[2]*pz - alpha;
+      });
+    }
+
     virtual
     double
     get_bounding_sphere_squared_radius() const
@@ -476,6 +984,8 @@ class HalfSpace: public pygalmesh::DomainBase
       return bounding_sphere_squared_radius_;
     }
 
+  friend class CompiledDomain;
+
   private:
     const std::array<double, 3> n_;
     const double alpha_;
@@ -1,3 +1,4 @@
+#include "compiled_domain.hpp"
 #include "domain.hpp"
 #include "generate.hpp"
 #include "generate_2d.hpp"
@@ -6,12 +7,24 @@
 #include "remesh_surface.hpp"
 #include "generate_periodic.hpp"
 #include "generate_surface_mesh.hpp"
+#include "grid_sizing_field.hpp"
+#include "job_pool.hpp"
+#include "mesh_data.hpp"
+#include "mesh_io.hpp"
+#include "mesh_result.hpp"
+#include "mesh_sizing_field.hpp"
+#include "meshing_control.hpp"
+#include "native_function.hpp"
+#include "parallel.hpp"
 #include "polygon2d.hpp"
 #include "primitives.hpp"
 #include "sizing_field.hpp"
+#include "surface_mesh_domain.hpp"
 
 #include <CGAL/version.h>
 
+#include <pybind11/eigen.h>
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
@@ -19,7 +32,71 @@ namespace py = pybind11;
 using namespace pygalmesh;
 
 
+// Hands the buffer of a vector to NumPy without copying; the capsule owns it.
+template <typename T>
+py::array_t<T>
+to_numpy(std::vector<T> && values, const std::vector<py::ssize_t> & shape)
+{
+  auto * owned = new std::vector<T>(std::move(values));
+  py::capsule owner(owned, [](void * p) {
+    delete static_cast<std::vector<T> *>(p);
+  });
+  return py::array_t<T>(shape, owned->data(), owner);
+}
+
+// Same as above, as an array of rows of the given width, or a flat one for width 1.
+template <typename T>
+py::array_t<T>
+to_numpy(std::vector<T> && values, const py::ssize_t width)
+{
+  const py::ssize_t rows = values.size() / width;
+  return to_numpy(
+      std::move(values),
+      width == 1 ? std::vector<py::ssize_t>{rows} : std::vector<py::ssize_t>{rows, width}
+      );
+}
+
+
+namespace pybind11 { namespace detail {
+// Meshes are returned as a dict of NumPy arrays, see to_numpy().
+template <> struct type_caster<MeshData> {
+  PYBIND11_TYPE_CASTER(MeshData, const_name("dict[str, numpy.ndarray]"));
+
+  public:
+  bool
+  load(handle, bool)
+  {
+    return false;
+  }
+
+  static
+  handle
+  cast(MeshData && data, return_value_policy, handle)
+  {
+    py::dict out;
+    out["points"] = to_numpy(std::move(data.points), 3);
+    out["tetra"] = to_numpy(std::move(data.tetras), 4);
+    out["tetra_subdomain"] = to_numpy(std::move(data.tetra_subdomains), 1);
+    out["triangle"] = to_numpy(std::move(data.triangles), 3);
+    out["triangle_patch"] = to_numpy(std::move(data.triangle_patches), 1);
+    out["line"] = to_numpy(std::move(data.edges), 2);
+    out["line_curve"] = to_numpy(std::move(data.edge_curves), 1);
+    return out.release();
+  }
+
+  static
+  handle
+  cast(const MeshData & data, return_value_policy policy, handle parent)
+  {
+    return cast(MeshData(data), policy, parent);
+  }
+};
+}} // namespace pybind11::detail
+
+
 // https://pybind11.readthedocs.io/en/stable/advanced/classes.html#overriding-virtual-functions-in-python
+// The generators run without the GIL; the override macros acquire it for the duration
+// of each call into Python, so only domains implemented in Python serialize.
 class PyDomainBase: public DomainBase {
 public:
     using DomainBase::DomainBase;
@@ -29,11 +106,21 @@ public:
       PYBIND11_OVERRIDE_PURE(double, DomainBase, eval, x);
     }
 
+    int
+    classify(const std::array<double, 3> & x) const override {
+      PYBIND11_OVERRIDE(int, DomainBase, classify, x);
+    }
+
     double
     get_bounding_sphere_squared_radius() const override {
       PYBIND11_OVERRIDE_PURE(double, DomainBase, get_bounding_sphere_squared_radius);
     }
 
+    BoundingBox
+    get_bounding_box() const override {
+      PYBIND11_OVERRIDE(BoundingBox, DomainBase, get_bounding_box);
+    }
+
     Features
     get_features() const override {
       PYBIND11_OVERRIDE(Features, DomainBase, get_features);
@@ -53,6 +140,332 @@ public:
 };
 
 
+// A Python subclass of a C++ base lives in its Python object; a shared_ptr to the C++
+// part alone doesn't keep that alive
+// (<https://github.com/pybind/pybind11/issues/1333>). The pointer returned here does,
+// for domains and sizing fields stored from Python and used after the call that set
+// them. The Python object is released with the GIL held, whichever thread drops the
+// last reference. If that happens after the interpreter has been finalized, e.g., in
+// a static or a detached thread at exit, there is no GIL to take and the object is
+// leaked.
+template <typename T>
+std::shared_ptr<T>
+with_python_object(const std::shared_ptr<T> & ptr)
+{
+  if (!ptr) {
+    return ptr;
+  }
+  auto * object = new py::object(py::cast(ptr));
+  return std::shared_ptr<T>(ptr.get(), [ptr, object](T *) mutable {
+    if (Py_IsInitialized()) {
+      py::gil_scoped_acquire acquire;
+      delete object;
+    }
+    ptr.reset();
+  });
+}
+
+// def_readwrite() for a shared_ptr member, storing with_python_object() of the value
+template <typename Class, typename T>
+void
+def_python_object(
+    py::class_<Class> & cls,
+    const char * name,
+    std::shared_ptr<T> Class::* member
+    )
+{
+  cls.def_property(
+      name,
+      [member](const Class & self) { return self.*member; },
+      [member](Class & self, const std::shared_ptr<T> & value) {
+        self.*member = with_python_object(value);
+      });
+}
+
+
+// Evaluates a domain at many points at once. The (n, 3) array is processed in chunks
+// which are transposed into the structure-of-arrays layout of eval_batch().
+py::array_t<double>
+eval_many(
+    const DomainBase & domain,
+    const py::array_t<double, py::array::c_style | py::array::forcecast> & x
+    )
+{
+  if (x.ndim() != 2 || x.shape(1) != 3) {
+    throw std::invalid_argument("Expected an array of shape (n, 3).");
+  }
+  const size_t n = x.shape(0);
+  py::array_t<double> out(n);
+  const double * in_ptr = x.data();
+  double * out_ptr = out.mutable_data();
+
+  constexpr size_t chunk_size = 4096;
+  std::vector<double> buffer(3 * chunk_size);
+  double * bx = buffer.data();
+  double * by = bx + chunk_size;
+  double * bz = by + chunk_size;
+  {
+    // The buffers and arrays are held by this call. Domains implemented in Python
+    // take the GIL back in their overrides for every point, see PyDomainBase.
+    py::gil_scoped_release release;
+    for (size_t k = 0; k < n; k += chunk_size) {
+      const size_t m = std::min(chunk_size, n - k);
+      for (size_t i = 0; i < m; i++) {
+        bx[i] = in_ptr[3*(k + i)];
+        by[i] = in_ptr[3*(k + i) + 1];
+        bz[i] = in_ptr[3*(k + i) + 2];
+      }
+      domain.eval_batch(bx, by, bz, out_ptr + k, m);
+    }
+  }
+  return out;
+}
+
+
+CellType
+to_cell_type(const std::string & name)
+{
+  if (name == "tetra") {
+    return CellType::tetra;
+  }
+  if (name == "triangle") {
+    return CellType::triangle;
+  }
+  if (name == "line") {
+    return CellType::line;
+  }
+  throw std::invalid_argument("Unknown cell type \"" + name + "\".");
+}
+
+
+// Python iterator over the cells of a mesh result, chunk_size cells at a time. Each
+// chunk is a pair of the corner coordinates of the cells, shape (m, nodes, 3), and
+// their point numbers, shape (m, nodes). Only one chunk is held at a time.
+class CellChunks
+{
+  public:
+  CellChunks(
+      const std::shared_ptr<const MeshResult> & result,
+      const CellType type,
+      const size_t chunk_size
+      ):
+    result_(result),
+    cursor_(result->cells(type)),
+    nodes_(nodes_per_cell(type)),
+    chunk_size_(std::min(chunk_size, result->num_cells(type)))
+  {
+    if (chunk_size == 0) {
+      throw std::invalid_argument("chunk_size must be positive.");
+    }
+  }
+
+  py::tuple
+  next()
+  {
+    std::vector<int> cells(nodes_ * chunk_size_);
+    std::vector<double> points;
+    size_t m;
+    {
+      py::gil_scoped_release release;
+      m = cursor_->next(chunk_size_, cells.data(), nullptr);
+      cells.resize(nodes_ * m);
+      points.resize(3 * cells.size());
+      result_->gather_points(cells.data(), cells.size(), points.data());
+    }
+    if (m == 0) {
+      throw py::stop_iteration();
+    }
+    const py::ssize_t rows = m;
+    return py::make_tuple(
+        to_numpy(std::move(points), {rows, nodes_, 3}),
+        to_numpy(std::move(cells), {rows, nodes_})
+        );
+  }
+
+  private:
+    const std::shared_ptr<const MeshResult> result_;
+    const std::unique_ptr<CellCursor> cursor_;
+    const py::ssize_t nodes_;
+    const size_t chunk_size_;
+};
+
+// Python iterator over the meshes of a batch of generate_mesh() jobs in the order they
+// finish, as pairs of the job number and the mesh. The jobs run on a pool of threads
+// as soon as the batch is created; the ones that haven't started when it is deleted
+// are dropped.
+class MeshBatch
+{
+  public:
+  MeshBatch(const std::vector<MeshJob> & jobs, const int num_workers):
+    jobs_(jobs),
+    pool_(std::make_unique<JobPool<std::shared_ptr<MeshResult>>>(
+          jobs_.size(), num_workers,
+          [this](const size_t k) { return generate_mesh(jobs_[k]); }
+          ))
+  {
+  }
+
+  ~MeshBatch()
+  {
+    // running jobs may need the GIL for domains and sizing fields written in Python
+    py::gil_scoped_release release;
+    pool_.reset();
+  }
+
+  py::tuple
+  next()
+  {
+    size_t job;
+    std::shared_ptr<MeshResult> result;
+    std::exception_ptr error;
+    bool has_next;
+    {
+      py::gil_scoped_release release;
+      has_next = pool_->next(job, result, error);
+    }
+    if (!has_next) {
+      throw py::stop_iteration();
+    }
+    if (error) {
+      try {
+        std::rethrow_exception(error);
+      } catch (const std::exception & e) {
+        throw std::runtime_error("Job " + std::to_string(job) + " failed: " + e.what());
+      }
+    }
+    return py::make_tuple(job, result);
+  }
+
+  private:
+    const std::vector<MeshJob> jobs_;
+    std::unique_ptr<JobPool<std::shared_ptr<MeshResult>>> pool_;
+};
+
+
+// Runs a mesher call on a thread of its own under a MeshingControl. This thread takes
+// the GIL every few milliseconds to enforce the time limit and the cancel token, to
+// check for Ctrl-C and to call progress(phase, num_vertices, num_cells): once for
+// every phase the run enters and every progress_interval seconds in between. On
+// Ctrl-C, or if progress raises, the run is stopped and the exception raised as soon
+// as the thread is done. Returns why the run is incomplete, empty if it isn't.
+std::string
+run_watched(
+    const std::function<void(MeshingControl &)> & run,
+    const double time_limit,
+    const size_t max_vertices,
+    const std::shared_ptr<CancelToken> & cancel_token,
+    const py::object & progress,
+    const double progress_interval
+    )
+{
+  MeshingControl control(time_limit, max_vertices, cancel_token);
+  std::exception_ptr error;
+  std::thread thread([&]() {
+    try {
+      run(control);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    control.finish();
+  });
+
+  try {
+    double last_report = 0.0;
+    bool finished = false;
+    while (!finished) {
+      {
+        py::gil_scoped_release release;
+        finished = control.wait_finished(std::chrono::milliseconds(20));
+      }
+      if (PyErr_CheckSignals() != 0) {
+        throw py::error_already_set();
+      }
+      const auto entered = control.poll();
+      if (progress.is_none()) {
+        continue;
+      }
+      for (const auto & p: entered) {
+        progress(p.phase, p.num_vertices, p.num_cells);
+      }
+      const double now = control.elapsed();
+      if (!entered.empty()) {
+        last_report = now;
+      } else if (!finished && now - last_report >= progress_interval) {
+        const auto p = control.current();
+        progress(p.phase, p.num_vertices, p.num_cells);
+        last_report = now;
+      }
+    }
+  } catch (...) {
+    control.stop("interrupted");
+    {
+      py::gil_scoped_release release;
+      thread.join();
+    }
+    throw;
+  }
+
+  thread.join();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return control.stop_reason();
+}
+
+typedef py::array_t<double, py::array::c_style | py::array::forcecast> PointArray;
+typedef py::array_t<int, py::array::c_style | py::array::forcecast> IndexArray;
+
+// Writes mesh arrays with one of the binary writers of mesh_io.hpp. Empty label
+// arrays are omitted.
+template <void (*write)(const std::string &, const MeshResult &)>
+void
+write_mesh_arrays(
+    const std::string & filename,
+    const PointArray & points,
+    const IndexArray & tetra,
+    const IndexArray & tetra_subdomain,
+    const IndexArray & triangle,
+    const IndexArray & triangle_patch,
+    const IndexArray & line,
+    const IndexArray & line_curve
+    )
+{
+  if (points.ndim() != 2 || points.shape(1) != 3) {
+    throw std::invalid_argument("Expected points of shape (n, 3).");
+  }
+  // number of cells in the array, and the labels if there are any
+  const auto cells = [](const IndexArray & c, const IndexArray & labels, const int nodes, const int * & label_ptr) {
+    if (c.size() == 0) {
+      label_ptr = nullptr;
+      return size_t(0);
+    }
+    if (c.ndim() != 2 || c.shape(1) != nodes) {
+      throw std::invalid_argument("Cell array of unexpected shape.");
+    }
+    const size_t n = c.shape(0);
+    if (labels.size() != 0 && size_t(labels.size()) != n) {
+      throw std::invalid_argument("Need as many labels as cells.");
+    }
+    label_ptr = labels.size() == 0 ? nullptr : labels.data();
+    return n;
+  };
+
+  MeshArrays mesh;
+  mesh.points = points.data();
+  mesh.num_points = points.shape(0);
+  mesh.tetras = tetra.data();
+  mesh.num_tetras = cells(tetra, tetra_subdomain, 4, mesh.tetra_subdomains);
+  mesh.triangles = triangle.data();
+  mesh.num_triangles = cells(triangle, triangle_patch, 3, mesh.triangle_patches);
+  mesh.edges = line.data();
+  mesh.num_edges = cells(line, line_curve, 2, mesh.edge_curves);
+
+  // only the array buffers are accessed below
+  py::gil_scoped_release release;
+  write(filename, ArrayMeshResult(mesh));
+}
+
+
 PYBIND11_MODULE(_pygalmesh, m) {
     // m.doc() = "documentation string";
 
@@ -62,7 +475,10 @@ PYBIND11_MODULE(_pygalmesh, m) {
     py::class_<DomainBase, PyDomainBase, std::shared_ptr<DomainBase>>(m, "DomainBase")
       .def(py::init<>())
       .def("eval", &DomainBase::eval)
+      .def("eval_many", &eval_many, py::arg("x"))
+      .def("classify", &DomainBase::classify)
       .def("get_bounding_sphere_squared_radius", &DomainBase::get_bounding_sphere_squared_radius)
+      .def("get_bounding_box", &DomainBase::get_bounding_box)
       .def("get_features", &DomainBase::get_features);
 
     // Sizing field base.
@@ -72,6 +488,99 @@ PYBIND11_MODULE(_pygalmesh, m) {
       .def(py::init<>())
       .def("eval", &SizingFieldBase::eval);
 
+    // Sizing fields evaluated in C++, without calls into Python
+    py::class_<GridSizingField, SizingFieldBase, std::shared_ptr<GridSizingField>>(m, "GridSizingField")
+      .def(
+          py::init([](
+              const py::array_t<double, py::array::c_style | py::array::forcecast> & values,
+              const std::array<double, 3> & origin,
+              const std::array<double, 3> & spacing,
+              const std::string & interpolation
+              ) {
+            if (values.ndim() != 3) {
+              throw std::invalid_argument("Expected a 3D array.");
+            }
+            return std::make_shared<GridSizingField>(
+                values.data(),
+                std::array<size_t, 3>{size_t(values.shape(0)), size_t(values.shape(1)), size_t(values.shape(2))},
+                origin,
+                spacing,
+                GridSizingField::to_interpolation(interpolation)
+                );
+          }),
+          py::arg("values"),
+          py::arg("origin"),
+          py::arg("spacing"),
+          py::arg("interpolation") = "linear");
+    py::class_<GradedSizingField, SizingFieldBase, std::shared_ptr<GradedSizingField>>(m, "GradedSizingField")
+      .def(
+          py::init<
+              const std::shared_ptr<const SizingFieldBase> &,
+              const double,
+              const std::array<double, 6> &,
+              const int
+              >(),
+          py::arg("field"),
+          py::arg("rate"),
+          py::arg("bounding_cuboid"),
+          py::arg("resolution") = 64);
+    py::class_<ConstantSizingField, SizingFieldBase, std::shared_ptr<ConstantSizingField>>(m, "ConstantSizingField")
+      .def(py::init<const double>(), py::arg("value"));
+    py::class_<DistanceToPointsField, SizingFieldBase, std::shared_ptr<DistanceToPointsField>>(m, "DistanceToPointsField")
+      .def(py::init<const std::vector<std::array<double, 3>> &>(), py::arg("points"));
+    py::class_<DistanceToPolylinesField, SizingFieldBase, std::shared_ptr<DistanceToPolylinesField>>(m, "DistanceToPolylinesField")
+      .def(py::init<const std::vector<Polyline> &>(), py::arg("polylines"));
+    py::class_<DistanceToSurfaceField, SizingFieldBase, std::shared_ptr<DistanceToSurfaceField>>(m, "DistanceToSurfaceField")
+      .def(
+          py::init<const DomainBase &, const std::array<double, 6> &, const int>(),
+          py::arg("domain"),
+          py::arg("bounding_cuboid"),
+          py::arg("resolution") = 64);
+    py::class_<MinSizingField, SizingFieldBase, std::shared_ptr<MinSizingField>>(m, "MinSizingField")
+      .def(py::init<const std::vector<std::shared_ptr<const SizingFieldBase>> &>(), py::arg("fields"));
+    py::class_<MaxSizingField, SizingFieldBase, std::shared_ptr<MaxSizingField>>(m, "MaxSizingField")
+      .def(py::init<const std::vector<std::shared_ptr<const SizingFieldBase>> &>(), py::arg("fields"));
+    py::class_<ScaledSizingField, SizingFieldBase, std::shared_ptr<ScaledSizingField>>(m, "ScaledSizingField")
+      .def(
+          py::init<const std::shared_ptr<const SizingFieldBase> &, const double, const double>(),
+          py::arg("field"),
+          py::arg("factor"),
+          py::arg("offset") = 0.0);
+    py::class_<MeshSizingField, SizingFieldBase, std::shared_ptr<MeshSizingField>>(m, "MeshSizingField")
+      .def(
+          py::init([](
+              const py::array_t<double, py::array::c_style | py::array::forcecast> & points,
+              const py::array_t<int, py::array::c_style | py::array::forcecast> & cells,
+              const py::array_t<double, py::array::c_style | py::array::forcecast> & sizes
+              ) {
+            if (points.ndim() != 2 || points.shape(1) != 3) {
+              throw std::invalid_argument("Expected points of shape (n, 3).");
+            }
+            if (cells.ndim() != 2 || cells.shape(1) != 4) {
+              throw std::invalid_argument("Expected tetrahedra of shape (m, 4).");
+            }
+            if (sizes.ndim() != 1) {
+              throw std::invalid_argument("Expected one size per point.");
+            }
+            const auto pts = points.unchecked<2>();
+            std::vector<std::array<double, 3>> p(pts.shape(0));
+            for (py::ssize_t k = 0; k < pts.shape(0); k++) {
+              p[k] = {pts(k, 0), pts(k, 1), pts(k, 2)};
+            }
+            const auto tets = cells.unchecked<2>();
+            std::vector<std::array<int, 4>> c(tets.shape(0));
+            for (py::ssize_t k = 0; k < tets.shape(0); k++) {
+              c[k] = {tets(k, 0), tets(k, 1), tets(k, 2), tets(k, 3)};
+            }
+            const std::vector<double> h(sizes.data(), sizes.data() + sizes.shape(0));
+            return std::make_shared<MeshSizingField>(p, c, h);
+          }),
+          py::arg("points"),
+          py::arg("cells"),
+          py::arg("sizes"));
+    py::class_<NativeSizingField, SizingFieldBase, std::shared_ptr<NativeSizingField>>(m, "NativeSizingField")
+      .def(py::init<const std::uintptr_t>(), py::arg("eval"));
+
     // Domain transformations
     py::class_<Translate, DomainBase, std::shared_ptr<Translate>>(m, "Translate")
           .def(py::init<
@@ -115,19 +624,38 @@ PYBIND11_MODULE(_pygalmesh, m) {
           .def("get_bounding_sphere_squared_radius", &Stretch::get_bounding_sphere_squared_radius)
           .def("get_features", &Stretch::get_features);
 
-    py::class_<Intersection, DomainBase, std::shared_ptr<Intersection>>(m, "Intersection")
+    py::class_<Affine, DomainBase, std::shared_ptr<Affine>>(m, "Affine")
           .def(py::init<
-              std::vector<std::shared_ptr<const pygalmesh::DomainBase>> &
+              const std::shared_ptr<const pygalmesh::DomainBase> &,
+              const std::array<std::array<double, 4>, 3> &
               >())
+          .def("eval", &Affine::eval)
+          .def("get_bounding_sphere_squared_radius", &Affine::get_bounding_sphere_squared_radius)
+          .def("get_features", &Affine::get_features);
+
+    py::class_<Intersection, DomainBase, std::shared_ptr<Intersection>>(m, "Intersection")
+          .def(py::init<
+              std::vector<std::shared_ptr<const pygalmesh::DomainBase>> &,
+              const std::vector<std::array<double, 3>> &
+              >(),
+              py::arg("domains"),
+              py::arg("samples") = std::vector<std::array<double, 3>>()
+              )
           .def("eval", &Intersection::eval)
+          .def("classify", &Intersection::classify)
           .def("get_bounding_sphere_squared_radius", &Intersection::get_bounding_sphere_squared_radius)
           .def("get_features", &Intersection::get_features);
 
     py::class_<Union, DomainBase, std::shared_ptr<Union>>(m, "Union")
           .def(py::init<
-              std::vector<std::shared_ptr<const pygalmesh::DomainBase>> &
-              >())
+              std::vector<std::shared_ptr<const pygalmesh::DomainBase>> &,
+              const std::vector<std::array<double, 3>> &
+              >(),
+              py::arg("domains"),
+              py::arg("samples") = std::vector<std::array<double, 3>>()
+              )
           .def("eval", &Union::eval)
+          .def("classify", &Union::classify)
           .def("get_bounding_sphere_squared_radius", &Union::get_bounding_sphere_squared_radius)
           .def("get_features", &Union::get_features);
 
@@ -140,6 +668,34 @@ PYBIND11_MODULE(_pygalmesh, m) {
           .def("get_bounding_sphere_squared_radius", &Difference::get_bounding_sphere_squared_radius)
           .def("get_features", &Difference::get_features);
 
+    py::class_<CompiledDomain, DomainBase, std::shared_ptr<CompiledDomain>>(m, "CompiledDomain")
+          .def(py::init<
+              const std::shared_ptr<const pygalmesh::DomainBase> &
+              >())
+          .def("eval", &CompiledDomain::eval)
+          .def("classify", &CompiledDomain::classify)
+          .def("get_bounding_sphere_squared_radius", &CompiledDomain::get_bounding_sphere_squared_radius)
+          .def("get_features", &CompiledDomain::get_features)
+          .def("num_instructions", &CompiledDomain::num_instructions)
+          .def("num_callouts", &CompiledDomain::num_callouts);
+
+    // Domains and sizing fields of native functions, given by their addresses, e.g.,
+    // the address of a numba cfunc or ctypes.cast(f, ctypes.c_void_p).value
+    py::class_<NativeDomain, DomainBase, std::shared_ptr<NativeDomain>>(m, "NativeDomain")
+          .def(py::init<
+              const std::uintptr_t,
+              const double,
+              const std::uintptr_t,
+              const DomainBase::Features &
+              >(),
+              py::arg("eval"),
+              py::arg("bounding_sphere_radius"),
+              py::arg("eval_batch") = 0,
+              py::arg("features") = DomainBase::Features())
+          .def("eval", &NativeDomain::eval)
+          .def("get_bounding_sphere_squared_radius", &NativeDomain::get_bounding_sphere_squared_radius)
+          .def("get_features", &NativeDomain::get_features);
+
     // Primitives
     py::class_<Ball, DomainBase, std::shared_ptr<Ball>>(m, "Ball")
           .def(py::init<
@@ -201,6 +757,15 @@ PYBIND11_MODULE(_pygalmesh, m) {
           .def("get_bounding_sphere_squared_radius", &Tetrahedron::get_bounding_sphere_squared_radius)
           .def("get_features", &Tetrahedron::get_features);
 
+    py::class_<ConvexPolyhedron, DomainBase, std::shared_ptr<ConvexPolyhedron>>(m, "ConvexPolyhedron")
+          .def(py::init<
+              const std::vector<std::array<double, 3>> &,
+              const std::vector<double> &
+              >())
+          .def("eval", &ConvexPolyhedron::eval)
+          .def("get_bounding_sphere_squared_radius", &ConvexPolyhedron::get_bounding_sphere_squared_radius)
+          .def("get_features", &ConvexPolyhedron::get_features);
+
     py::class_<Torus, DomainBase, std::shared_ptr<Torus>>(m, "Torus")
           .def(py::init<
               const double,
@@ -252,9 +817,175 @@ PYBIND11_MODULE(_pygalmesh, m) {
           .def("get_bounding_sphere_squared_radius", &ring_extrude::get_bounding_sphere_squared_radius)
           .def("get_features", &ring_extrude::get_features);
 
+    // triangle meshes
+    py::class_<SurfaceMeshDomain, DomainBase, std::shared_ptr<SurfaceMeshDomain>>(m, "SurfaceMeshDomain")
+          .def(py::init<
+              const std::vector<std::array<double, 3>> &,
+              const std::vector<std::array<int, 3>> &,
+              const double
+              >(),
+              py::arg("vertices"),
+              py::arg("faces"),
+              py::arg("feature_angle") = 60.0
+              )
+          .def("eval", &SurfaceMeshDomain::eval)
+          .def("classify", &SurfaceMeshDomain::classify)
+          .def(
+              "winding_number",
+              [](const SurfaceMeshDomain & domain, const std::array<double, 3> & x) {
+                return domain.winding_number(Eigen::Vector3d(x.data()));
+              })
+          .def("get_bounding_sphere_squared_radius", &SurfaceMeshDomain::get_bounding_sphere_squared_radius)
+          .def("get_features", &SurfaceMeshDomain::get_features);
+
+    py::class_<MeshingOptions> meshing_options(m, "_MeshingOptions");
+    meshing_options
+      .def(py::init<>())
+      .def_readwrite("lloyd", &MeshingOptions::lloyd)
+      .def_readwrite("odt", &MeshingOptions::odt)
+      .def_readwrite("perturb", &MeshingOptions::perturb)
+      .def_readwrite("exude", &MeshingOptions::exude)
+      .def_readwrite("min_edge_size_at_feature_edges", &MeshingOptions::min_edge_size_at_feature_edges)
+      .def_readwrite("max_edge_size_at_feature_edges_value", &MeshingOptions::max_edge_size_at_feature_edges_value)
+      .def_readwrite("min_facet_angle", &MeshingOptions::min_facet_angle)
+      .def_readwrite("max_radius_surface_delaunay_ball_value", &MeshingOptions::max_radius_surface_delaunay_ball_value)
+      .def_readwrite("max_facet_distance_value", &MeshingOptions::max_facet_distance_value)
+      .def_readwrite("max_circumradius_edge_ratio", &MeshingOptions::max_circumradius_edge_ratio)
+      .def_readwrite("max_cell_circumradius_value", &MeshingOptions::max_cell_circumradius_value)
+      .def_readwrite("exude_time_limit", &MeshingOptions::exude_time_limit)
+      .def_readwrite("exude_sliver_bound", &MeshingOptions::exude_sliver_bound)
+      .def_readwrite("verbose", &MeshingOptions::verbose)
+      .def_readwrite("seed", &MeshingOptions::seed)
+      .def_readwrite("num_threads", &MeshingOptions::num_threads);
+    // The sizing fields may be Python callables in Wrapper objects, see main.py, that
+    // nothing else references.
+    def_python_object(meshing_options, "max_edge_size_at_feature_edges_field", &MeshingOptions::max_edge_size_at_feature_edges_field);
+    def_python_object(meshing_options, "max_radius_surface_delaunay_ball_field", &MeshingOptions::max_radius_surface_delaunay_ball_field);
+    def_python_object(meshing_options, "max_facet_distance_field", &MeshingOptions::max_facet_distance_field);
+    def_python_object(meshing_options, "max_cell_circumradius_field", &MeshingOptions::max_cell_circumradius_field);
+
+    py::class_<MeshJob> mesh_job(m, "_MeshJob");
+    mesh_job
+      .def(py::init<>())
+      .def_readwrite("extra_feature_edges", &MeshJob::extra_feature_edges)
+      .def_readwrite("bounding_sphere_radius", &MeshJob::bounding_sphere_radius)
+      .def_readwrite("has_bounding_cuboid", &MeshJob::has_bounding_cuboid)
+      .def_readwrite("bounding_cuboid", &MeshJob::bounding_cuboid)
+      .def_readwrite("options", &MeshJob::options);
+    def_python_object(mesh_job, "domain", &MeshJob::domain);
+
+    py::class_<CancelToken, std::shared_ptr<CancelToken>>(m, "CancelToken")
+      .def(py::init<>())
+      .def("cancel", &CancelToken::cancel)
+      .def_property_readonly("cancelled", &CancelToken::cancelled);
+
+    py::class_<MeshBatch>(m, "_MeshBatch")
+      .def(py::init<const std::vector<MeshJob> &, const int>(), py::arg("jobs"), py::arg("num_workers"))
+      .def(
+          "__iter__",
+          [](MeshBatch & batch) -> MeshBatch & { return batch; },
+          py::return_value_policy::reference_internal)
+      .def("__next__", &MeshBatch::next);
+
+    // Meshes of the Mesh_3 generators, read off the complex on demand
+    py::class_<MeshResult, std::shared_ptr<MeshResult>>(m, "MeshResult")
+      .def_property_readonly("num_points", &MeshResult::num_points)
+      .def(
+          "num_cells",
+          [](const MeshResult & result, const std::string & cell_type) {
+            return result.num_cells(to_cell_type(cell_type));
+          },
+          py::arg("cell_type"))
+      .def(
+          "points",
+          [](const MeshResult & result) {
+            std::vector<double> points(3 * result.num_points());
+            {
+              py::gil_scoped_release release;
+              result.copy_points(0, result.num_points(), points.data());
+            }
+            return to_numpy(std::move(points), 3);
+          })
+      .def(
+          "arrays", &collect_mesh_data,
+          py::call_guard<py::gil_scoped_release>())
+      .def(
+          "iter_chunks",
+          [](const std::shared_ptr<MeshResult> & result, const size_t chunk_size, const std::string & cell_type) {
+            return CellChunks(result, to_cell_type(cell_type), chunk_size);
+          },
+          py::arg("chunk_size"),
+          py::arg("cell_type") = "tetra")
+      .def(
+          "write_meshb",
+          [](const MeshResult & result, const std::string & filename) {
+            write_meshb(filename, result);
+          },
+          py::call_guard<py::gil_scoped_release>(),
+          py::arg("filename"))
+      .def(
+          "write_vtu",
+          [](const MeshResult & result, const std::string & filename) {
+            write_vtu(filename, result);
+          },
+          py::call_guard<py::gil_scoped_release>(),
+          py::arg("filename"))
+      .def(
+          "save", &MeshResult::save,
+          py::call_guard<py::gil_scoped_release>(),
+          py::arg("filename"))
+      .def(
+          "_refine",
+          [](MeshResult & result, const MeshingOptions & options) {
+            result.refine(options, nullptr);
+          },
+          py::call_guard<py::gil_scoped_release>(),
+          py::arg("options"))
+      // returns why the refinement is incomplete, empty if it isn't
+      .def(
+          "_refine_watched",
+          [](
+            MeshResult & result,
+            const MeshingOptions & options,
+            const double time_limit,
+            const size_t max_vertices,
+            const std::shared_ptr<CancelToken> & cancel_token,
+            const py::object & progress,
+            const double progress_interval
+          ) {
+            return run_watched(
+                [&](MeshingControl & control) { result.refine(options, &control); },
+                time_limit, max_vertices, cancel_token, progress, progress_interval
+                );
+          },
+          py::arg("options"),
+          py::arg("time_limit") = 0.0,
+          py::arg("max_vertices") = 0,
+          py::arg("cancel_token") = nullptr,
+          py::arg("progress") = py::none(),
+          py::arg("progress_interval") = 1.0);
+
+    py::class_<CellChunks>(m, "_CellChunks")
+      .def(
+          "__iter__",
+          [](CellChunks & chunks) -> CellChunks & { return chunks; },
+          py::return_value_policy::reference_internal)
+      .def("__next__", &CellChunks::next);
+
     // functions
+    m.def(
+        "fuse_transforms",
+        [](const std::shared_ptr<const pygalmesh::DomainBase> & domain) {
+          // pybind11 can't return pointers to const
+          return std::const_pointer_cast<pygalmesh::DomainBase>(Affine::fuse(domain));
+        },
+        py::arg("domain")
+        );
+    // The generators release the GIL such that several meshes can be created in
+    // parallel from Python threads.
     m.def(
         "_generate_2d", &generate_2d,
+        py::call_guard<py::gil_scoped_release>(),
         py::arg("points"),
         py::arg("constraints"),
         py::arg("max_circumradius_shortest_edge_ratio") = 1.41421356237,
@@ -263,36 +994,70 @@ PYBIND11_MODULE(_pygalmesh, m) {
         );
     m.def(
         "_generate_mesh",
-        py::overload_cast<
-            const std::shared_ptr<pygalmesh::DomainBase>&,
-            const std::string&,
-            const DomainBase::Features&,
-            const double,
-            const bool,
-            const bool,
-            const bool,
-            const bool,
-            const double,
-            const double,
-            const std::shared_ptr<pygalmesh::SizingFieldBase> &,
-            const double,
-            const double,
-            const std::shared_ptr<pygalmesh::SizingFieldBase> &,
-            const double,
-            const std::shared_ptr<pygalmesh::SizingFieldBase> &,
-            const double,
-            const double,
-            const std::shared_ptr<pygalmesh::SizingFieldBase> &,
-            const double,
-            const double,
-            const bool,
-            const int>(
-            &generate_mesh
-        ),
+        [](const MeshJob & job) { return generate_mesh(job); },
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("job")
+        );
+    // returns the mesh and why it is incomplete, empty if it isn't
+    m.def(
+        "_generate_mesh_watched",
+        [](
+          const MeshJob & job,
+          const double time_limit,
+          const size_t max_vertices,
+          const std::shared_ptr<CancelToken> & cancel_token,
+          const py::object & progress,
+          const double progress_interval
+        ) {
+          std::shared_ptr<MeshResult> result;
+          const std::string stop_reason = run_watched(
+              [&](MeshingControl & control) { result = generate_mesh(job, &control); },
+              time_limit, max_vertices, cancel_token, progress, progress_interval
+              );
+          return py::make_tuple(result, stop_reason);
+        },
+        py::arg("job"),
+        py::arg("time_limit") = 0.0,
+        py::arg("max_vertices") = 0,
+        py::arg("cancel_token") = nullptr,
+        py::arg("progress") = py::none(),
+        py::arg("progress_interval") = 1.0
+        );
+    m.def(
+        "_generate_periodic_mesh_with_sizing_fields", &generate_periodic_mesh_with_sizing_fields,
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("domain"),
+        py::arg("bounding_cuboid"),
+        py::arg("options"),
+        py::arg("manifold") = false,
+        py::arg("number_of_copies_in_output") = 1
+        );
+    m.def(
+        "_generate_surface_mesh", &generate_surface_mesh,
+        py::call_guard<py::gil_scoped_release>(),
         py::arg("domain"),
-        py::arg("outfile"),
-        py::arg("extra_feature_edges") = DomainBase::Features(),
         py::arg("bounding_sphere_radius") = 0.0,
+        py::arg("min_facet_angle") = 0.0,
+        py::arg("max_radius_surface_delaunay_ball") = 0.0,
+        py::arg("max_facet_distance") = 0.0,
+        py::arg("verbose") = true,
+        py::arg("seed") = 0
+        );
+    m.def(
+        "_generate_from_off_with_sizing_fields", &generate_from_off_with_sizing_fields,
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("vertices"),
+        py::arg("faces"),
+        py::arg("options"),
+        py::arg("reorient") = false
+        );
+    m.def(
+        "_generate_mesh_partitioned", &generate_mesh_partitioned,
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("domain"),
+        py::arg("bounding_cuboid"),
+        py::arg("num_blocks"),
+        py::arg("extra_feature_edges") = DomainBase::Features(),
         py::arg("lloyd") = false,
         py::arg("odt") = false,
         py::arg("perturb") = true,
@@ -311,115 +1076,124 @@ PYBIND11_MODULE(_pygalmesh, m) {
         py::arg("exude_time_limit") = 0.0,
         py::arg("exude_sliver_bound") = 0.0,
         py::arg("verbose") = true,
-        py::arg("seed") = 0
+        py::arg("seed") = 0,
+        py::arg("num_workers") = 0
         );
     m.def(
-        "_generate_mesh",
+        "_load_mesh",
         py::overload_cast<
+            const std::string &,
             const std::shared_ptr<pygalmesh::DomainBase>&,
-            const std::string&,
-            const std::array<double, 6>,
             const DomainBase::Features&,
-            const bool,
-            const bool,
-            const bool,
-            const bool,
-            const double,
             const double,
-            const std::shared_ptr<pygalmesh::SizingFieldBase> &,
-            const double,
-            const double,
-            const std::shared_ptr<pygalmesh::SizingFieldBase> &,
-            const double,
-            const std::shared_ptr<pygalmesh::SizingFieldBase> &,
-            const double,
-            const double,
-            const std::shared_ptr<pygalmesh::SizingFieldBase> &,
-            const double,
-            const double,
-            const bool,
             const int>(
-            &generate_mesh
+            &load_mesh
         ),
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("filename"),
         py::arg("domain"),
-        py::arg("outfile"),
-        py::arg("bounding_cuboid"),
         py::arg("extra_feature_edges") = DomainBase::Features(),
-        py::arg("lloyd") = false,
-        py::arg("odt") = false,
-        py::arg("perturb") = true,
-        py::arg("exude") = true,
-        py::arg("min_edge_size_at_feature_edges") = 0.0,
-        py::arg("max_edge_size_at_feature_edges_value") = std::numeric_limits<double>::max(),
-        py::arg("max_edge_size_at_feature_edges_field") = nullptr,
-        py::arg("min_facet_angle") = 0.0,
-        py::arg("max_radius_surface_delaunay_ball_value") = 0.0,
-        py::arg("max_radius_surface_delaunay_ball_field") = nullptr,
-        py::arg("max_facet_distance_value") = 0.0,
-        py::arg("max_facet_distance_field") = nullptr,
-        py::arg("max_circumradius_edge_ratio") = 0.0,
-        py::arg("max_cell_circumradius_value") = 0.0,
-        py::arg("max_cell_circumradius_field") = nullptr,
-        py::arg("exude_time_limit") = 0.0,
-        py::arg("exude_sliver_bound") = 0.0,
-        py::arg("verbose") = true,
-        py::arg("seed") = 0
+        py::arg("bounding_sphere_radius") = 0.0,
+        py::arg("num_threads") = 0
         );
     m.def(
-        "_generate_periodic_mesh", &generate_periodic_mesh,
+        "_load_mesh",
+        py::overload_cast<
+            const std::string &,
+            const std::shared_ptr<pygalmesh::DomainBase>&,
+            const std::array<double, 6>,
+            const DomainBase::Features&,
+            const int>(
+            &load_mesh
+        ),
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("filename"),
         py::arg("domain"),
-        py::arg("outfile"),
         py::arg("bounding_cuboid"),
-        py::arg("lloyd") = false,
-        py::arg("odt") = false,
-        py::arg("perturb") = true,
-        py::arg("exude") = true,
-        py::arg("manifold") = false,
-        py::arg("max_edge_size_at_feature_edges") = 0.0,
-        py::arg("min_facet_angle") = 0.0,
-        py::arg("max_radius_surface_delaunay_ball") = 0.0,
-        py::arg("max_facet_distance") = 0.0,
-        py::arg("max_circumradius_edge_ratio") = 0.0,
-        py::arg("max_cell_circumradius") = 0.0,
-        py::arg("number_of_copies_in_output") = 1,
-        py::arg("verbose") = true,
-        py::arg("seed") = 0
+        py::arg("extra_feature_edges") = DomainBase::Features(),
+        py::arg("num_threads") = 0
         );
     m.def(
-        "_generate_surface_mesh", &generate_surface_mesh,
-        py::arg("domain"),
-        py::arg("outfile"),
-        py::arg("bounding_sphere_radius") = 0.0,
-        py::arg("min_facet_angle") = 0.0,
-        py::arg("max_radius_surface_delaunay_ball") = 0.0,
-        py::arg("max_facet_distance") = 0.0,
-        py::arg("verbose") = true,
-        py::arg("seed") = 0
+        "_load_mesh_from_inr", &load_mesh_from_inr,
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("filename"),
+        py::arg("inr_filename"),
+        py::arg("num_threads") = 0
         );
     m.def(
-        "_generate_from_off", &generate_from_off,
-        py::arg("infile"),
-        py::arg("outfile"),
+        "_generate_from_inr_with_sizing_fields", &generate_from_inr_with_sizing_fields,
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("inr_filename"),
+        py::arg("options")
+        );
+    m.def(
+        "_generate_from_inr_with_subdomain_sizing", &generate_from_inr_with_subdomain_sizing,
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("inr_filename"),
+        py::arg("default_max_cell_circumradius"),
+        py::arg("max_cell_circumradiuss"),
+        py::arg("cell_labels"),
         py::arg("lloyd") = false,
         py::arg("odt") = false,
         py::arg("perturb") = true,
         py::arg("exude") = true,
-        py::arg("max_edge_size_at_feature_edges") = 0.0,  // std::numeric_limits<double>::max(),
+        py::arg("max_edge_size_at_feature_edges") = 0.0,
         py::arg("min_facet_angle") = 0.0,
         py::arg("max_radius_surface_delaunay_ball") = 0.0,
         py::arg("max_facet_distance") = 0.0,
         py::arg("max_circumradius_edge_ratio") = 0.0,
-        py::arg("max_cell_circumradius") = 0.0,
         py::arg("exude_time_limit") = 0.0,
         py::arg("exude_sliver_bound") = 0.0,
         py::arg("verbose") = true,
-        py::arg("reorient") = false,
-        py::arg("seed") = 0
+        py::arg("seed") = 0,
+        py::arg("num_threads") = 0
         );
+    // A view of a label volume for the image mesher. It keeps the array alive, the
+    // generators read its memory directly.
+    py::class_<ImageArray>(m, "_ImageArray")
+      .def(
+          py::init([](
+              const py::array & vol,
+              const std::array<double, 3> & voxel_size,
+              const std::array<double, 3> & origin
+              ) {
+            if (vol.ndim() != 3) {
+              throw std::invalid_argument("Expected a 3D array.");
+            }
+            // uint8, uint16, float32 or float64, which is what the image reader knows
+            const char kind = vol.dtype().kind();
+            const auto itemsize = vol.itemsize();
+            const bool supported =
+              (kind == 'u' && (itemsize == 1 || itemsize == 2)) ||
+              (kind == 'f' && (itemsize == 4 || itemsize == 8));
+            if (!supported || !vol.dtype().attr("isnative").cast<bool>()) {
+              throw std::invalid_argument(
+                  "Expected uint8, uint16, float32 or float64 data in native byte order."
+                  );
+            }
+            const bool fortran_order = vol.flags() & py::array::f_style;
+            if (!fortran_order && !(vol.flags() & py::array::c_style)) {
+              throw std::invalid_argument("Expected a contiguous array.");
+            }
+            return ImageArray{
+              vol.data(),
+              {size_t(vol.shape(0)), size_t(vol.shape(1)), size_t(vol.shape(2))},
+              fortran_order,
+              kind == 'f',
+              (unsigned int) vol.itemsize(),
+              voxel_size,
+              origin
+            };
+          }),
+          py::keep_alive<1, 2>(),
+          py::arg("vol"),
+          py::arg("voxel_size"),
+          py::arg("origin") = std::array<double, 3>{0.0, 0.0, 0.0}
+          );
     m.def(
-        "_generate_from_inr", &generate_from_inr,
-        py::arg("inr_filename"),
-        py::arg("outfile"),
+        "_generate_from_array", &generate_from_array,
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("image"),
         py::arg("lloyd") = false,
         py::arg("odt") = false,
         py::arg("perturb") = true,
@@ -433,12 +1207,13 @@ PYBIND11_MODULE(_pygalmesh, m) {
         py::arg("exude_time_limit") = 0.0,
         py::arg("exude_sliver_bound") = 0.0,
         py::arg("verbose") = true,
-        py::arg("seed") = 0
+        py::arg("seed") = 0,
+        py::arg("num_threads") = 0
         );
     m.def(
-        "_generate_from_inr_with_subdomain_sizing", &generate_from_inr_with_subdomain_sizing,
-        py::arg("inr_filename"),
-        py::arg("outfile"),
+        "_generate_from_array_with_subdomain_sizing", &generate_from_array_with_subdomain_sizing,
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("image"),
         py::arg("default_max_cell_circumradius"),
         py::arg("max_cell_circumradiuss"),
         py::arg("cell_labels"),
@@ -454,18 +1229,39 @@ PYBIND11_MODULE(_pygalmesh, m) {
         py::arg("exude_time_limit") = 0.0,
         py::arg("exude_sliver_bound") = 0.0,
         py::arg("verbose") = true,
-        py::arg("seed") = 0
+        py::arg("seed") = 0,
+        py::arg("num_threads") = 0
         );
     m.def(
-        "_remesh_surface", &remesh_surface,
-        py::arg("infile"),
-        py::arg("outfile"),
-        py::arg("max_edge_size_at_feature_edges") = 0.0,
-        py::arg("min_facet_angle") = 0.0,
-        py::arg("max_radius_surface_delaunay_ball") = 0.0,
-        py::arg("max_facet_distance") = 0.0,
-        py::arg("verbose") = true,
-        py::arg("seed") = 0
+        "_remesh_surface_with_sizing_fields", &remesh_surface_with_sizing_fields,
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("vertices"),
+        py::arg("faces"),
+        py::arg("options")
+        );
+    // binary writers
+    m.def(
+        "_write_meshb", &write_mesh_arrays<&write_meshb>,
+        py::arg("filename"),
+        py::arg("points"),
+        py::arg("tetra"),
+        py::arg("tetra_subdomain"),
+        py::arg("triangle"),
+        py::arg("triangle_patch"),
+        py::arg("line"),
+        py::arg("line_curve")
+        );
+    m.def(
+        "_write_vtu", &write_mesh_arrays<&write_vtu>,
+        py::arg("filename"),
+        py::arg("points"),
+        py::arg("tetra"),
+        py::arg("tetra_subdomain"),
+        py::arg("triangle"),
+        py::arg("triangle_patch"),
+        py::arg("line"),
+        py::arg("line_curve")
         );
     m.attr("_CGAL_VERSION_STR") = CGAL_VERSION_STR;
+    m.attr("_HAS_PARALLEL") = has_parallel_support();
 }
@@ -1,6 +1,10 @@
 #define CGAL_MESH_3_VERBOSE 1
 
 #include "remesh_surface.hpp"
+#include "c3t3_result.hpp"
+#include "call_state.hpp"
+#include "mesh_criteria.hpp"
+#include "polygon_soup.hpp"
 
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/Mesh_triangulation_3.h>
@@ -9,6 +13,9 @@
 #include <CGAL/Polyhedral_mesh_domain_with_features_3.h>
 #include <CGAL/make_mesh_3.h>
 
+#include <CGAL/Polygon_mesh_processing/orient_polygon_soup.h>
+#include <CGAL/Polygon_mesh_processing/polygon_soup_to_polygon_mesh.h>
+
 namespace pygalmesh {
 // Domain
 typedef CGAL::Exact_predicates_inexact_constructions_kernel K;
@@ -22,28 +29,15 @@ typedef CGAL::Mesh_complex_3_in_triangulation_3<
 // Criteria
 typedef CGAL::Mesh_criteria_3<Tr> Mesh_criteria;
 
+namespace {
+
 // <https://doc.cgal.org/latest/Mesh_3/#title24>
-void
-remesh_surface(
-    const std::string & infile,
-    const std::string & outfile,
-    const double max_edge_size_at_feature_edges,
-    const double min_facet_angle,
-    const double max_radius_surface_delaunay_ball,
-    const double max_facet_distance,
-    const bool verbose,
-    const int seed
+std::shared_ptr<MeshResult>
+remesh_polyhedron(
+    Polyhedron & poly,
+    const MeshingOptions & options
     )
 {
-  CGAL::get_default_random() = CGAL::Random(seed);
-
-  // Load a polyhedron
-  Polyhedron poly;
-  std::ifstream input(infile.c_str());
-  input >> poly;
-  if (!CGAL::is_triangle_mesh(poly)){
-    throw "Input geometry is not triangulated.";
-  }
   // Create a vector with only one element: the pointer to the polyhedron.
   std::vector<Polyhedron*> poly_ptrs_vector(1, &poly);
   // Create a polyhedral domain with only one polyhedron and no "bounding polyhedron"
@@ -52,36 +46,45 @@ remesh_surface(
 
   // Get sharp features
   domain.detect_features(); //includes detection of borders
-  // Mesh criteria
-  Mesh_criteria criteria(
-      CGAL::parameters::edge_size=max_edge_size_at_feature_edges,
-      CGAL::parameters::facet_angle=min_facet_angle,
-      CGAL::parameters::facet_size=max_radius_surface_delaunay_ball,
-      CGAL::parameters::facet_distance=max_facet_distance
-  );
 
-  // Mesh generation
-  if (!verbose) {
-    // suppress output
-    std::cerr.setstate(std::ios_base::failbit);
-  }
+  const QuietOutput quiet_output(!options.verbose);
   C3t3 c3t3 = CGAL::make_mesh_3<C3t3>(
       domain,
-      criteria,
+      make_mesh_criteria<Mesh_criteria, Mesh_domain>(options),
       CGAL::parameters::no_perturb(),
       CGAL::parameters::no_exude()
   );
-  if (!verbose) {
-    std::cerr.clear();
-  }
-  // Output the facets of the c3t3 to an OFF file. The facets will not be
-  // oriented.
-  std::ofstream off_file(outfile.c_str());
-  c3t3.output_boundary_to_off(off_file);
-  if (off_file.fail()) {
-    throw "Failed to write OFF.";
+  // Output the facets of the c3t3. The facets will not be oriented.
+  return std::make_shared<C3t3Result<C3t3>>(c3t3, true);
+}
+
+Polyhedron
+polyhedron_from_arrays(const VertexArray & vertices, const FaceArray & faces)
+{
+  std::vector<K::Point_3> points;
+  std::vector<std::vector<std::size_t>> polygons;
+  to_polygon_soup(vertices, faces, points, polygons);
+  // The output is not oriented anyway, so fix up whatever the polyhedron can't hold.
+  if (!CGAL::Polygon_mesh_processing::is_polygon_soup_a_polygon_mesh(polygons)) {
+    CGAL::Polygon_mesh_processing::orient_polygon_soup(points, polygons);
   }
-  return;
+  Polyhedron poly;
+  CGAL::Polygon_mesh_processing::polygon_soup_to_polygon_mesh(points, polygons, poly);
+  return poly;
+}
+
+}
+
+std::shared_ptr<MeshResult>
+remesh_surface_with_sizing_fields(
+    const VertexArray & vertices,
+    const FaceArray & faces,
+    const MeshingOptions & options
+    )
+{
+  const ScopedSeed scoped_seed(options.seed);
+  Polyhedron poly = polyhedron_from_arrays(vertices, faces);
+  return remesh_polyhedron(poly, options);
 }
 
 } // namespace pygalmesh
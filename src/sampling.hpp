@@ -0,0 +1,56 @@
+#ifndef SAMPLING_HPP
+#define SAMPLING_HPP
+
+// Sampling a domain along a grid, shared by the block partition and the sizing fields
+// that look for the domain boundary, and the polylines they produce.
+
+#include "domain.hpp"
+
+#include <array>
+#include <vector>
+
+namespace pygalmesh {
+
+typedef std::vector<std::array<double, 3>> Polyline;
+
+// The point on the segment a, b where the domain switches between inside and outside.
+// a and b must be on different sides. The result only depends on a and b, so the same
+// segment gives the same point bit for bit.
+inline
+std::array<double, 3>
+find_crossing(
+    const pygalmesh::DomainBase & domain,
+    std::array<double, 3> a,
+    std::array<double, 3> b
+    )
+{
+  const bool a_inside = domain.classify(a) < 0;
+  for (int k = 0; k < 48; k++) {
+    std::array<double, 3> m;
+    for (int i = 0; i < 3; i++) {
+      m[i] = 0.5 * (a[i] + b[i]);
+    }
+    if ((domain.classify(m) < 0) == a_inside) {
+      a = m;
+    } else {
+      b = m;
+    }
+  }
+  std::array<double, 3> m;
+  for (int i = 0; i < 3; i++) {
+    m[i] = 0.5 * (a[i] + b[i]);
+  }
+  return m;
+}
+
+// The sample coordinates of [lo, hi] with n intervals.
+inline
+double
+sample(const double lo, const double hi, const int i, const int n)
+{
+  return i == n ? hi : lo + (hi - lo) * i / n;
+}
+
+} // namespace pygalmesh
+
+#endif // SAMPLING_HPP
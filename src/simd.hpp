@@ -0,0 +1,372 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+// A minimal packed-double abstraction for the batched domain kernels.
+//
+// Kernels are written once as generic lambdas and instantiated both for `Pack` (the
+// vector loop) and for `double` (the remainder loop). AVX is used when the compiler
+// targets it (e.g., with -march=native), SSE2 otherwise, and a plain scalar fallback on
+// other architectures.
+//
+// Builds with GCC or Clang for x86 that don't target AVX2 anyway also instantiate the
+// kernels for `WidePack`, four doubles, in loops compiled for AVX2 and FMA. map(),
+// transform() and combine() run those if the CPU supports them.
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if !defined(__AVX2__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define PYGALMESH_SIMD_DISPATCH
+#endif
+
+namespace pygalmesh {
+namespace simd {
+
+#if defined(__AVX__)
+
+struct Pack {
+  static constexpr size_t width = 4;
+  Pack() = default;
+  Pack(const __m256d v): v(v) {}
+  Pack(const double a): v(_mm256_set1_pd(a)) {}
+  __m256d v;
+};
+
+inline Pack load(const double * p) { return _mm256_loadu_pd(p); }
+inline void store(double * p, const Pack & a) { _mm256_storeu_pd(p, a.v); }
+
+inline Pack operator+(const Pack & a, const Pack & b) { return _mm256_add_pd(a.v, b.v); }
+inline Pack operator-(const Pack & a, const Pack & b) { return _mm256_sub_pd(a.v, b.v); }
+inline Pack operator*(const Pack & a, const Pack & b) { return _mm256_mul_pd(a.v, b.v); }
+inline Pack operator/(const Pack & a, const Pack & b) { return _mm256_div_pd(a.v, b.v); }
+inline Pack operator-(const Pack & a) { return _mm256_xor_pd(a.v, _mm256_set1_pd(-0.0)); }
+
+inline Pack min(const Pack & a, const Pack & b) { return _mm256_min_pd(b.v, a.v); }
+inline Pack max(const Pack & a, const Pack & b) { return _mm256_max_pd(b.v, a.v); }
+inline Pack sqrt(const Pack & a) { return _mm256_sqrt_pd(a.v); }
+
+// masks are packs with all bits of the true lanes set
+inline Pack lt(const Pack & a, const Pack & b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ); }
+inline Pack ge(const Pack & a, const Pack & b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ); }
+inline Pack logical_and(const Pack & a, const Pack & b) { return _mm256_and_pd(a.v, b.v); }
+inline Pack select(const Pack & mask, const Pack & a, const Pack & b) {
+  return _mm256_blendv_pd(b.v, a.v, mask.v);
+}
+
+#elif defined(__SSE2__)
+
+struct Pack {
+  static constexpr size_t width = 2;
+  Pack() = default;
+  Pack(const __m128d v): v(v) {}
+  Pack(const double a): v(_mm_set1_pd(a)) {}
+  __m128d v;
+};
+
+inline Pack load(const double * p) { return _mm_loadu_pd(p); }
+inline void store(double * p, const Pack & a) { _mm_storeu_pd(p, a.v); }
+
+inline Pack operator+(const Pack & a, const Pack & b) { return _mm_add_pd(a.v, b.v); }
+inline Pack operator-(const Pack & a, const Pack & b) { return _mm_sub_pd(a.v, b.v); }
+inline Pack operator*(const Pack & a, const Pack & b) { return _mm_mul_pd(a.v, b.v); }
+inline Pack operator/(const Pack & a, const Pack & b) { return _mm_div_pd(a.v, b.v); }
+inline Pack operator-(const Pack & a) { return _mm_xor_pd(a.v, _mm_set1_pd(-0.0)); }
+
+inline Pack min(const Pack & a, const Pack & b) { return _mm_min_pd(b.v, a.v); }
+inline Pack max(const Pack & a, const Pack & b) { return _mm_max_pd(b.v, a.v); }
+inline Pack sqrt(const Pack & a) { return _mm_sqrt_pd(a.v); }
+
+inline Pack lt(const Pack & a, const Pack & b) { return _mm_cmplt_pd(a.v, b.v); }
+inline Pack ge(const Pack & a, const Pack & b) { return _mm_cmpge_pd(a.v, b.v); }
+inline Pack logical_and(const Pack & a, const Pack & b) { return _mm_and_pd(a.v, b.v); }
+inline Pack select(const Pack & mask, const Pack & a, const Pack & b) {
+  return _mm_or_pd(_mm_and_pd(mask.v, a.v), _mm_andnot_pd(mask.v, b.v));
+}
+
+#else
+
+struct Pack {
+  static constexpr size_t width = 1;
+  Pack() = default;
+  Pack(const double a): v(a) {}
+  double v;
+};
+
+inline Pack load(const double * p) { return *p; }
+inline void store(double * p, const Pack & a) { *p = a.v; }
+
+inline Pack operator+(const Pack & a, const Pack & b) { return a.v + b.v; }
+inline Pack operator-(const Pack & a, const Pack & b) { return a.v - b.v; }
+inline Pack operator*(const Pack & a, const Pack & b) { return a.v * b.v; }
+inline Pack operator/(const Pack & a, const Pack & b) { return a.v / b.v; }
+inline Pack operator-(const Pack & a) { return -a.v; }
+
+inline Pack min(const Pack & a, const Pack & b) { return std::min(a.v, b.v); }
+inline Pack max(const Pack & a, const Pack & b) { return std::max(a.v, b.v); }
+inline Pack sqrt(const Pack & a) { return std::sqrt(a.v); }
+
+inline Pack lt(const Pack & a, const Pack & b) { return a.v < b.v ? 1.0 : 0.0; }
+inline Pack ge(const Pack & a, const Pack & b) { return a.v >= b.v ? 1.0 : 0.0; }
+inline Pack logical_and(const Pack & a, const Pack & b) { return a.v * b.v; }
+inline Pack select(const Pack & mask, const Pack & a, const Pack & b) {
+  return mask.v != 0.0 ? a.v : b.v;
+}
+
+#endif
+
+// scalar versions for the remainder loops
+inline double min(const double a, const double b) { return std::min(a, b); }
+inline double max(const double a, const double b) { return std::max(a, b); }
+inline double sqrt(const double a) { return std::sqrt(a); }
+inline bool lt(const double a, const double b) { return a < b; }
+inline bool ge(const double a, const double b) { return a >= b; }
+inline bool logical_and(const bool a, const bool b) { return a && b; }
+inline double select(const bool mask, const double a, const double b) { return mask ? a : b; }
+
+#if defined(PYGALMESH_SIMD_DISPATCH)
+
+// The lanes are kept in an array rather than a vector register type, so passing a
+// WidePack doesn't depend on the target of the function. All operations are inlined;
+// within the AVX2 loops below, they compile to AVX2 instructions, elsewhere to SSE2.
+#define PYGALMESH_SIMD_INLINE inline __attribute__((always_inline))
+
+// The vector types below never cross a function boundary, so the ABI warning about
+// returning them without AVX doesn't apply.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+typedef double WideDouble __attribute__((vector_size(32)));
+typedef long long WideMask __attribute__((vector_size(32)));
+
+struct alignas(32) WidePack {
+  static constexpr size_t width = 4;
+  WidePack() = default;
+  PYGALMESH_SIMD_INLINE WidePack(const double a): v{a, a, a, a} {}
+  double v[4];
+};
+
+template <typename T>
+PYGALMESH_SIMD_INLINE T lanes(const WidePack & a)
+{
+  T t;
+  std::memcpy(&t, a.v, sizeof(t));
+  return t;
+}
+
+template <typename T>
+PYGALMESH_SIMD_INLINE WidePack from_lanes(const T & t)
+{
+  WidePack a;
+  std::memcpy(a.v, &t, sizeof(a.v));
+  return a;
+}
+
+PYGALMESH_SIMD_INLINE WidePack load_wide(const double * p) {
+  WidePack a;
+  std::memcpy(a.v, p, sizeof(a.v));
+  return a;
+}
+PYGALMESH_SIMD_INLINE void store(double * p, const WidePack & a) {
+  std::memcpy(p, a.v, sizeof(a.v));
+}
+
+PYGALMESH_SIMD_INLINE WidePack operator+(const WidePack & a, const WidePack & b) {
+  return from_lanes(lanes<WideDouble>(a) + lanes<WideDouble>(b));
+}
+PYGALMESH_SIMD_INLINE WidePack operator-(const WidePack & a, const WidePack & b) {
+  return from_lanes(lanes<WideDouble>(a) - lanes<WideDouble>(b));
+}
+PYGALMESH_SIMD_INLINE WidePack operator*(const WidePack & a, const WidePack & b) {
+  return from_lanes(lanes<WideDouble>(a) * lanes<WideDouble>(b));
+}
+PYGALMESH_SIMD_INLINE WidePack operator/(const WidePack & a, const WidePack & b) {
+  return from_lanes(lanes<WideDouble>(a) / lanes<WideDouble>(b));
+}
+PYGALMESH_SIMD_INLINE WidePack operator-(const WidePack & a) {
+  return from_lanes(-lanes<WideDouble>(a));
+}
+
+// masks are packs with all bits of the true lanes set
+PYGALMESH_SIMD_INLINE WidePack lt(const WidePack & a, const WidePack & b) {
+  return from_lanes(WideMask(lanes<WideDouble>(a) < lanes<WideDouble>(b)));
+}
+PYGALMESH_SIMD_INLINE WidePack ge(const WidePack & a, const WidePack & b) {
+  return from_lanes(WideMask(lanes<WideDouble>(a) >= lanes<WideDouble>(b)));
+}
+PYGALMESH_SIMD_INLINE WidePack logical_and(const WidePack & a, const WidePack & b) {
+  return from_lanes(lanes<WideMask>(a) & lanes<WideMask>(b));
+}
+PYGALMESH_SIMD_INLINE WidePack select(const WidePack & mask, const WidePack & a, const WidePack & b) {
+  const WideMask m = lanes<WideMask>(mask);
+  return from_lanes((m & lanes<WideMask>(a)) | (~m & lanes<WideMask>(b)));
+}
+
+// like the SSE2 and AVX instructions, a if either is NaN
+PYGALMESH_SIMD_INLINE WidePack min(const WidePack & a, const WidePack & b) {
+  return select(lt(b, a), b, a);
+}
+PYGALMESH_SIMD_INLINE WidePack max(const WidePack & a, const WidePack & b) {
+  return select(lt(a, b), b, a);
+}
+PYGALMESH_SIMD_INLINE WidePack sqrt(const WidePack & a) {
+  WidePack r;
+  for (int k = 0; k < 4; k++) {
+    r.v[k] = std::sqrt(a.v[k]);
+  }
+  return r;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+inline
+bool
+has_avx2()
+{
+  static const bool has = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return has;
+}
+
+// The vector loops of map(), transform() and combine() for WidePack. They return the
+// number of values done; the kernel is inlined into them to get the AVX2 code.
+#define PYGALMESH_SIMD_AVX2 __attribute__((target("avx2,fma"), flatten))
+
+template <typename F>
+PYGALMESH_SIMD_AVX2
+size_t
+map_wide(
+    const double * x, const double * y, const double * z,
+    double * out,
+    const size_t n,
+    const F & f
+    )
+{
+  size_t i = 0;
+  for (; i + WidePack::width <= n; i += WidePack::width) {
+    store(out + i, f(load_wide(x + i), load_wide(y + i), load_wide(z + i)));
+  }
+  return i;
+}
+
+template <typename F>
+PYGALMESH_SIMD_AVX2
+size_t
+transform_wide(
+    const double * x, const double * y, const double * z,
+    double * qx, double * qy, double * qz,
+    const size_t n,
+    const F & f
+    )
+{
+  size_t i = 0;
+  for (; i + WidePack::width <= n; i += WidePack::width) {
+    WidePack a, b, c;
+    f(load_wide(x + i), load_wide(y + i), load_wide(z + i), a, b, c);
+    store(qx + i, a);
+    store(qy + i, b);
+    store(qz + i, c);
+  }
+  return i;
+}
+
+template <typename F>
+PYGALMESH_SIMD_AVX2
+size_t
+combine_wide(double * out, const double * b, const size_t n, const F & f)
+{
+  size_t i = 0;
+  for (; i + WidePack::width <= n; i += WidePack::width) {
+    store(out + i, f(load_wide(out + i), load_wide(b + i)));
+  }
+  return i;
+}
+
+#endif
+
+// out[i] = f(x[i], y[i], z[i])
+template <typename F>
+void
+map(
+    const double * x, const double * y, const double * z,
+    double * out,
+    const size_t n,
+    const F & f
+    )
+{
+  size_t i = 0;
+#if defined(PYGALMESH_SIMD_DISPATCH)
+  if (has_avx2()) {
+    i = map_wide(x, y, z, out, n, f);
+  }
+#endif
+  for (; i + Pack::width <= n; i += Pack::width) {
+    store(out + i, f(load(x + i), load(y + i), load(z + i)));
+  }
+  for (; i < n; i++) {
+    out[i] = f(x[i], y[i], z[i]);
+  }
+}
+
+// f(x[i], y[i], z[i], qx[i], qy[i], qz[i]), with the q's being written
+template <typename F>
+void
+transform(
+    const double * x, const double * y, const double * z,
+    double * qx, double * qy, double * qz,
+    const size_t n,
+    const F & f
+    )
+{
+  size_t i = 0;
+#if defined(PYGALMESH_SIMD_DISPATCH)
+  if (has_avx2()) {
+    i = transform_wide(x, y, z, qx, qy, qz, n, f);
+  }
+#endif
+  for (; i + Pack::width <= n; i += Pack::width) {
+    Pack a, b, c;
+    f(load(x + i), load(y + i), load(z + i), a, b, c);
+    store(qx + i, a);
+    store(qy + i, b);
+    store(qz + i, c);
+  }
+  for (; i < n; i++) {
+    f(x[i], y[i], z[i], qx[i], qy[i], qz[i]);
+  }
+}
+
+// out[i] = f(out[i], b[i])
+template <typename F>
+void
+combine(double * out, const double * b, const size_t n, const F & f)
+{
+  size_t i = 0;
+#if defined(PYGALMESH_SIMD_DISPATCH)
+  if (has_avx2()) {
+    i = combine_wide(out, b, n, f);
+  }
+#endif
+  for (; i + Pack::width <= n; i += Pack::width) {
+    store(out + i, f(load(out + i), load(b + i)));
+  }
+  for (; i < n; i++) {
+    out[i] = f(out[i], b[i]);
+  }
+}
+
+} // namespace simd
+} // namespace pygalmesh
+
+#endif // SIMD_HPP
@@ -1,8 +1,17 @@
 #ifndef SIZING_FIELD_HPP
 #define SIZING_FIELD_HPP
 
+#include "bvh.hpp"
+#include "domain.hpp"
+#include "sampling.hpp"
+
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <limits>
 #include <memory>
+#include <stdexcept>
+#include <vector>
 
 namespace pygalmesh {
 
@@ -19,5 +28,338 @@ class SizingFieldBase
   double val = -1.0;
 };
 
+// Sizing fields evaluated in C++. The distance fields give the distance to a set of
+// points, polylines or the domain boundary; the combinators turn distances into sizes,
+// e.g., min(h_max, h_min + rate * distance) for refining toward a feature.
+
+class ConstantSizingField: public SizingFieldBase
+{
+  public:
+  explicit ConstantSizingField(const double value):
+    value_(value)
+  {
+  }
+
+  virtual ~ConstantSizingField() = default;
+
+  virtual
+  double
+  eval(const std::array<double, 3> &) const
+  {
+    return value_;
+  }
+
+  private:
+    const double value_;
+};
+
+// The distance to the nearest of the points, looked up in a bounding volume hierarchy
+// of the points.
+class DistanceToPointsField: public SizingFieldBase
+{
+  public:
+  explicit DistanceToPointsField(const std::vector<std::array<double, 3>> & points):
+    points_(points),
+    bvh_(point_boxes(points))
+  {
+    if (points.empty()) {
+      throw std::invalid_argument("Need at least one point.");
+    }
+  }
+
+  virtual ~DistanceToPointsField() = default;
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    return bvh_.min_distance(x, [&](const size_t k) {
+      const auto & p = points_[k];
+      return std::sqrt(
+          (x[0] - p[0]) * (x[0] - p[0]) +
+          (x[1] - p[1]) * (x[1] - p[1]) +
+          (x[2] - p[2]) * (x[2] - p[2])
+          );
+    });
+  }
+
+  private:
+  static
+  std::vector<BoundingBox>
+  point_boxes(const std::vector<std::array<double, 3>> & points)
+  {
+    std::vector<BoundingBox> boxes;
+    boxes.reserve(points.size());
+    for (const auto & p: points) {
+      boxes.push_back({{p, p}});
+    }
+    return boxes;
+  }
+
+  private:
+    const std::vector<std::array<double, 3>> points_;
+    const BoundingVolumeHierarchy bvh_;
+};
+
+// The distance to the nearest of the polylines, looked up in a bounding volume
+// hierarchy of their segments.
+class DistanceToPolylinesField: public SizingFieldBase
+{
+  public:
+  explicit DistanceToPolylinesField(const std::vector<Polyline> & polylines):
+    segments_(to_segments(polylines)),
+    bvh_(segment_boxes(segments_))
+  {
+    if (segments_.empty()) {
+      throw std::invalid_argument("Need at least one polyline with two points or more.");
+    }
+  }
+
+  virtual ~DistanceToPolylinesField() = default;
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    return bvh_.min_distance(x, [&](const size_t k) {
+      const auto & a = segments_[k][0];
+      const auto & b = segments_[k][1];
+      double ab2 = 0.0;
+      double t = 0.0;
+      for (int i = 0; i < 3; i++) {
+        ab2 += (b[i] - a[i]) * (b[i] - a[i]);
+        t += (x[i] - a[i]) * (b[i] - a[i]);
+      }
+      t = ab2 > 0.0 ? std::min(std::max(t / ab2, 0.0), 1.0) : 0.0;
+      double d2 = 0.0;
+      for (int i = 0; i < 3; i++) {
+        const double d = x[i] - (a[i] + t * (b[i] - a[i]));
+        d2 += d * d;
+      }
+      return std::sqrt(d2);
+    });
+  }
+
+  private:
+  typedef std::array<std::array<double, 3>, 2> Segment;
+
+  static
+  std::vector<Segment>
+  to_segments(const std::vector<Polyline> & polylines)
+  {
+    std::vector<Segment> segments;
+    for (const auto & polyline: polylines) {
+      for (size_t k = 0; k + 1 < polyline.size(); k++) {
+        segments.push_back({{polyline[k], polyline[k + 1]}});
+      }
+    }
+    return segments;
+  }
+
+  static
+  std::vector<BoundingBox>
+  segment_boxes(const std::vector<Segment> & segments)
+  {
+    std::vector<BoundingBox> boxes;
+    boxes.reserve(segments.size());
+    for (const auto & s: segments) {
+      BoundingBox box;
+      for (int i = 0; i < 3; i++) {
+        box[0][i] = std::min(s[0][i], s[1][i]);
+        box[1][i] = std::max(s[0][i], s[1][i]);
+      }
+      boxes.push_back(box);
+    }
+    return boxes;
+  }
+
+  private:
+    const std::vector<Segment> segments_;
+    const BoundingVolumeHierarchy bvh_;
+};
+
+// The distance to the domain boundary, approximated by the distance to the points
+// where the boundary crosses the edges of a grid over the bounding cuboid with n
+// intervals along its longest side. It is accurate up to about the grid spacing;
+// boundary parts that pass between grid points are missed.
+class DistanceToSurfaceField: public SizingFieldBase
+{
+  public:
+  DistanceToSurfaceField(
+      const pygalmesh::DomainBase & domain,
+      const std::array<double, 6> & bounding_cuboid,
+      const int n
+      ):
+    points_(surface_points(domain, bounding_cuboid, n))
+  {
+  }
+
+  virtual ~DistanceToSurfaceField() = default;
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    return points_.eval(x);
+  }
+
+  private:
+  static
+  std::vector<std::array<double, 3>>
+  surface_points(
+      const pygalmesh::DomainBase & domain,
+      const std::array<double, 6> & bounding_cuboid,
+      const int n
+      )
+  {
+    if (n < 1) {
+      throw std::invalid_argument("Need at least one grid interval.");
+    }
+    double extent = 0.0;
+    for (int a = 0; a < 3; a++) {
+      if (!(bounding_cuboid[a] < bounding_cuboid[a + 3])) {
+        throw std::invalid_argument("The bounding cuboid must have positive extent.");
+      }
+      extent = std::max(extent, bounding_cuboid[a + 3] - bounding_cuboid[a]);
+    }
+    std::array<int, 3> counts;
+    for (int a = 0; a < 3; a++) {
+      counts[a] = std::max(1, int(std::ceil(n * (bounding_cuboid[a + 3] - bounding_cuboid[a]) / extent)));
+    }
+    const auto point = [&](const std::array<int, 3> & i) {
+      std::array<double, 3> x;
+      for (int a = 0; a < 3; a++) {
+        x[a] = sample(bounding_cuboid[a], bounding_cuboid[a + 3], i[a], counts[a]);
+      }
+      return x;
+    };
+
+    const size_t nx = counts[0] + 1;
+    const size_t ny = counts[1] + 1;
+    const size_t nz = counts[2] + 1;
+    std::vector<char> inside(nx * ny * nz);
+    for (int i = 0; i <= counts[0]; i++) {
+      for (int j = 0; j <= counts[1]; j++) {
+        for (int k = 0; k <= counts[2]; k++) {
+          inside[(i * ny + j) * nz + k] = domain.classify(point({i, j, k})) < 0;
+        }
+      }
+    }
+
+    std::vector<std::array<double, 3>> points;
+    for (int i = 0; i <= counts[0]; i++) {
+      for (int j = 0; j <= counts[1]; j++) {
+        for (int k = 0; k <= counts[2]; k++) {
+          const std::array<int, 3> p = {i, j, k};
+          for (int a = 0; a < 3; a++) {
+            std::array<int, 3> q = p;
+            q[a]++;
+            if (q[a] > counts[a]) {
+              continue;
+            }
+            if (inside[(p[0] * ny + p[1]) * nz + p[2]] != inside[(q[0] * ny + q[1]) * nz + q[2]]) {
+              points.push_back(find_crossing(domain, point(p), point(q)));
+            }
+          }
+        }
+      }
+    }
+    if (points.empty()) {
+      throw std::invalid_argument("The domain boundary doesn't cross the grid.");
+    }
+    return points;
+  }
+
+  private:
+    const DistanceToPointsField points_;
+};
+
+// The smallest or largest value of the fields
+class MinSizingField: public SizingFieldBase
+{
+  public:
+  explicit MinSizingField(const std::vector<std::shared_ptr<const SizingFieldBase>> & fields):
+    fields_(fields)
+  {
+    if (fields.empty()) {
+      throw std::invalid_argument("Need at least one field.");
+    }
+  }
+
+  virtual ~MinSizingField() = default;
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    double value = std::numeric_limits<double>::infinity();
+    for (const auto & field: fields_) {
+      value = std::min(value, field->eval(x));
+    }
+    return value;
+  }
+
+  private:
+    const std::vector<std::shared_ptr<const SizingFieldBase>> fields_;
+};
+
+class MaxSizingField: public SizingFieldBase
+{
+  public:
+  explicit MaxSizingField(const std::vector<std::shared_ptr<const SizingFieldBase>> & fields):
+    fields_(fields)
+  {
+    if (fields.empty()) {
+      throw std::invalid_argument("Need at least one field.");
+    }
+  }
+
+  virtual ~MaxSizingField() = default;
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    double value = -std::numeric_limits<double>::infinity();
+    for (const auto & field: fields_) {
+      value = std::max(value, field->eval(x));
+    }
+    return value;
+  }
+
+  private:
+    const std::vector<std::shared_ptr<const SizingFieldBase>> fields_;
+};
+
+// factor * field + offset
+class ScaledSizingField: public SizingFieldBase
+{
+  public:
+  ScaledSizingField(
+      const std::shared_ptr<const SizingFieldBase> & field,
+      const double factor,
+      const double offset
+      ):
+    field_(field),
+    factor_(factor),
+    offset_(offset)
+  {
+  }
+
+  virtual ~ScaledSizingField() = default;
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    return factor_ * field_->eval(x) + offset_;
+  }
+
+  private:
+    const std::shared_ptr<const SizingFieldBase> field_;
+    const double factor_;
+    const double offset_;
+};
+
 } // namespace pygalmesh
 #endif // SIZING_FIELD_HPP
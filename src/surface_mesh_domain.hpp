@@ -0,0 +1,418 @@
+#ifndef SURFACE_MESH_DOMAIN_HPP
+#define SURFACE_MESH_DOMAIN_HPP
+
+#include "domain.hpp"
+
+#include <CGAL/version.h>
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/AABB_tree.h>
+#if CGAL_VERSION_MAJOR >= 6
+#include <CGAL/AABB_traits_3.h>
+#include <CGAL/AABB_triangle_primitive_3.h>
+#else
+#include <CGAL/AABB_traits.h>
+#include <CGAL/AABB_triangle_primitive.h>
+#endif
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+namespace pygalmesh {
+
+// A closed triangle mesh as a domain primitive.
+//
+// The function value is the distance to the surface, negative inside. The distance
+// comes from a CGAL AABB tree, the sign from the generalized winding number, which is
+// robust to small holes and self-intersections. The winding number is computed with
+// the hierarchical approximation of Barill et al. (2018): every node of a tree over the
+// triangles is replaced by a dipole if the query point is far from it, and only the
+// triangles close to the point are summed exactly. classify() needs the sign only and
+// skips the distance query altogether.
+//
+// The sharp edges of the mesh, i.e., those at which the normals of the adjacent faces
+// enclose an angle larger than feature_angle (in degrees), and all boundary and
+// non-manifold edges are reported as features.
+class SurfaceMeshDomain: public pygalmesh::DomainBase
+{
+  public:
+  using Kernel = CGAL::Exact_predicates_inexact_constructions_kernel;
+  using Triangles = std::vector<Kernel::Triangle_3>;
+#if CGAL_VERSION_MAJOR >= 6
+  using Primitive = CGAL::AABB_triangle_primitive_3<Kernel, Triangles::const_iterator>;
+  using Tree = CGAL::AABB_tree<CGAL::AABB_traits_3<Kernel, Primitive>>;
+#else
+  using Primitive = CGAL::AABB_triangle_primitive<Kernel, Triangles::const_iterator>;
+  using Tree = CGAL::AABB_tree<CGAL::AABB_traits<Kernel, Primitive>>;
+#endif
+
+  SurfaceMeshDomain(
+      const std::vector<std::array<double, 3>> & vertices,
+      const std::vector<std::array<int, 3>> & faces,
+      const double feature_angle = 60.0
+      ):
+    vertices_(to_eigen(vertices)),
+    faces_(check_faces(faces, vertices.size())),
+    triangles_(to_cgal(vertices_, faces_)),
+    tree_(triangles_.begin(), triangles_.end()),
+    features_(compute_features(vertices_, faces_, feature_angle))
+  {
+    // Build the trees up front; the meshers query from several threads.
+    tree_.build();
+    tree_.accelerate_distance_queries();
+    tree_.squared_distance(triangles_[0][0]);
+
+    build_winding_tree();
+  }
+
+  virtual ~SurfaceMeshDomain() = default;
+
+  virtual
+  double
+  eval(const std::array<double, 3> & x) const
+  {
+    const double d = std::sqrt(
+        CGAL::to_double(tree_.squared_distance(Kernel::Point_3(x[0], x[1], x[2])))
+        );
+    return classify(x) < 0 ? -d : d;
+  }
+
+  virtual
+  int
+  classify(const std::array<double, 3> & x) const
+  {
+    if (!contains(box_, x)) {
+      return 1;
+    }
+    return winding_number(Eigen::Vector3d(x.data())) > 0.5 ? -1 : 1;
+  }
+
+  // The generalized winding number of the surface at x; 1 inside and 0 outside of a
+  // closed, outward-oriented mesh.
+  double
+  winding_number(const Eigen::Vector3d & x) const
+  {
+    double w = 0.0;
+    size_t stack[64];
+    size_t top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+      const Node & node = nodes_[stack[--top]];
+      const Eigen::Vector3d d = node.center - x;
+      const double dist2 = d.squaredNorm();
+      if (dist2 > beta * beta * node.radius2) {
+        // far field: dipole approximation
+        w += d.dot(node.normal) / (dist2 * std::sqrt(dist2));
+      } else if (node.count > 0) {
+        for (size_t j = node.first; j < node.first + node.count; j++) {
+          w += solid_angle(faces_[order_[j]], x);
+        }
+      } else {
+        stack[top++] = node.first + 1;
+        stack[top++] = node.first;
+      }
+    }
+    const double pi = 3.1415926535897932384;
+    return w / (4 * pi);
+  }
+
+  virtual
+  double
+  get_bounding_sphere_squared_radius() const
+  {
+    double max = 0.0;
+    for (const auto & v: vertices_) {
+      max = std::max(max, v.squaredNorm());
+    }
+    return max;
+  }
+
+  virtual
+  BoundingBox
+  get_bounding_box() const
+  {
+    return box_;
+  }
+
+  virtual
+  Features
+  get_features() const
+  {
+    return features_;
+  };
+
+  private:
+  // A node of the winding number tree. The dipole sits at the area-weighted centroid
+  // of the triangles; normal is the sum of the area-weighted normals and radius2 the
+  // squared distance of the farthest vertex from the centroid.
+  struct Node {
+    Eigen::Vector3d center;
+    Eigen::Vector3d normal;
+    double radius2;
+    // leaves: the range [first, first + count) of order_; inner nodes (count == 0):
+    // the children are nodes first and first + 1
+    size_t first;
+    size_t count;
+  };
+
+  static
+  std::vector<Eigen::Vector3d>
+  to_eigen(const std::vector<std::array<double, 3>> & vertices)
+  {
+    std::vector<Eigen::Vector3d> out;
+    out.reserve(vertices.size());
+    for (const auto & v: vertices) {
+      out.emplace_back(v[0], v[1], v[2]);
+    }
+    return out;
+  }
+
+  static
+  std::vector<std::array<int, 3>>
+  check_faces(const std::vector<std::array<int, 3>> & faces, const size_t num_vertices)
+  {
+    if (faces.empty()) {
+      throw std::invalid_argument("SurfaceMeshDomain needs at least one face");
+    }
+    for (const auto & f: faces) {
+      for (const int k: f) {
+        if (k < 0 || size_t(k) >= num_vertices) {
+          throw std::invalid_argument("SurfaceMeshDomain: face index out of range");
+        }
+      }
+    }
+    return faces;
+  }
+
+  static
+  Triangles
+  to_cgal(
+      const std::vector<Eigen::Vector3d> & vertices,
+      const std::vector<std::array<int, 3>> & faces
+      )
+  {
+    Triangles triangles;
+    triangles.reserve(faces.size());
+    for (const auto & f: faces) {
+      const auto & a = vertices[f[0]];
+      const auto & b = vertices[f[1]];
+      const auto & c = vertices[f[2]];
+      triangles.emplace_back(
+          Kernel::Point_3(a[0], a[1], a[2]),
+          Kernel::Point_3(b[0], b[1], b[2]),
+          Kernel::Point_3(c[0], c[1], c[2])
+          );
+    }
+    return triangles;
+  }
+
+  // The signed solid angle of face f seen from x (Van Oosterom and Strackee).
+  double
+  solid_angle(const std::array<int, 3> & f, const Eigen::Vector3d & x) const
+  {
+    const Eigen::Vector3d a = vertices_[f[0]] - x;
+    const Eigen::Vector3d b = vertices_[f[1]] - x;
+    const Eigen::Vector3d c = vertices_[f[2]] - x;
+    const double la = a.norm();
+    const double lb = b.norm();
+    const double lc = c.norm();
+    const double numerator = a.dot(b.cross(c));
+    const double denominator =
+      la * lb * lc + a.dot(b) * lc + a.dot(c) * lb + b.dot(c) * la;
+    return 2 * std::atan2(numerator, denominator);
+  }
+
+  void
+  build_winding_tree()
+  {
+    const double inf = std::numeric_limits<double>::infinity();
+    box_ = {{{inf, inf, inf}, {-inf, -inf, -inf}}};
+    for (const auto & v: vertices_) {
+      for (int i = 0; i < 3; i++) {
+        box_[0][i] = std::min(box_[0][i], v[i]);
+        box_[1][i] = std::max(box_[1][i], v[i]);
+      }
+    }
+
+    const size_t n = faces_.size();
+    centroids_.resize(n);
+    area_normals_.resize(n);
+    order_.resize(n);
+    for (size_t k = 0; k < n; k++) {
+      const auto & a = vertices_[faces_[k][0]];
+      const auto & b = vertices_[faces_[k][1]];
+      const auto & c = vertices_[faces_[k][2]];
+      centroids_[k] = (a + b + c) / 3;
+      area_normals_[k] = 0.5 * (b - a).cross(c - a);
+      order_[k] = k;
+    }
+    nodes_.resize(1);
+    build(0, 0, n);
+  }
+
+  void
+  build(const size_t index, const size_t begin, const size_t end)
+  {
+    // dipole of the node
+    Eigen::Vector3d normal = Eigen::Vector3d::Zero();
+    Eigen::Vector3d weighted = Eigen::Vector3d::Zero();
+    double area = 0.0;
+    Eigen::Vector3d lo = Eigen::Vector3d::Constant(std::numeric_limits<double>::infinity());
+    Eigen::Vector3d hi = -lo;
+    for (size_t j = begin; j < end; j++) {
+      const size_t k = order_[j];
+      const double a = area_normals_[k].norm();
+      normal += area_normals_[k];
+      weighted += a * centroids_[k];
+      area += a;
+      lo = lo.cwiseMin(centroids_[k]);
+      hi = hi.cwiseMax(centroids_[k]);
+    }
+    const Eigen::Vector3d center = area > 0.0 ? Eigen::Vector3d(weighted / area) : (lo + hi) / 2;
+    double radius2 = 0.0;
+    for (size_t j = begin; j < end; j++) {
+      for (const int v: faces_[order_[j]]) {
+        radius2 = std::max(radius2, (vertices_[v] - center).squaredNorm());
+      }
+    }
+
+    if (end - begin <= leaf_size) {
+      nodes_[index] = {center, normal, radius2, begin, end - begin};
+      return;
+    }
+
+    // median split along the longest axis of the centroids
+    int axis;
+    (hi - lo).maxCoeff(&axis);
+    const size_t mid = begin + (end - begin) / 2;
+    std::nth_element(
+        order_.begin() + begin, order_.begin() + mid, order_.begin() + end,
+        [&](const size_t a, const size_t b) {
+          return centroids_[a][axis] < centroids_[b][axis];
+        });
+
+    const size_t first = nodes_.size();
+    nodes_.resize(first + 2);
+    nodes_[index] = {center, normal, radius2, first, 0};
+    build(first, begin, mid);
+    build(first + 1, mid, end);
+  }
+
+  // The sharp edges, joined into maximal polylines.
+  static
+  Features
+  compute_features(
+      const std::vector<Eigen::Vector3d> & vertices,
+      const std::vector<std::array<int, 3>> & faces,
+      const double feature_angle
+      )
+  {
+    // all (lower vertex, upper vertex, face) triples, grouped by edge
+    std::vector<std::tuple<int, int, size_t>> half_edges;
+    half_edges.reserve(3 * faces.size());
+    for (size_t k = 0; k < faces.size(); k++) {
+      for (int i = 0; i < 3; i++) {
+        const int a = faces[k][i];
+        const int b = faces[k][(i + 1) % 3];
+        half_edges.emplace_back(std::min(a, b), std::max(a, b), k);
+      }
+    }
+    std::sort(half_edges.begin(), half_edges.end());
+
+    const auto normal = [&](const size_t k) {
+      const auto & a = vertices[faces[k][0]];
+      return Eigen::Vector3d((vertices[faces[k][1]] - a).cross(vertices[faces[k][2]] - a));
+    };
+    const double pi = 3.1415926535897932384;
+    const double cos_max = std::cos(feature_angle * pi / 180.0);
+
+    std::vector<std::array<int, 2>> edges;
+    for (size_t j = 0; j < half_edges.size(); ) {
+      size_t e = j + 1;
+      while (
+          e < half_edges.size() &&
+          std::get<0>(half_edges[e]) == std::get<0>(half_edges[j]) &&
+          std::get<1>(half_edges[e]) == std::get<1>(half_edges[j])
+          ) {
+        e++;
+      }
+      bool sharp = e - j != 2;
+      if (!sharp) {
+        const Eigen::Vector3d n0 = normal(std::get<2>(half_edges[j]));
+        const Eigen::Vector3d n1 = normal(std::get<2>(half_edges[j + 1]));
+        sharp = n0.dot(n1) < cos_max * n0.norm() * n1.norm();
+      }
+      if (sharp) {
+        edges.push_back({std::get<0>(half_edges[j]), std::get<1>(half_edges[j])});
+      }
+      j = e;
+    }
+
+    // Walk the edge graph from the vertices that aren't interior to a polyline, then
+    // pick up the remaining closed loops.
+    std::vector<std::vector<size_t>> incident(vertices.size());
+    for (size_t k = 0; k < edges.size(); k++) {
+      incident[edges[k][0]].push_back(k);
+      incident[edges[k][1]].push_back(k);
+    }
+    std::vector<bool> visited(edges.size(), false);
+    Features features;
+    const auto walk = [&](int v, size_t k) {
+      std::vector<std::array<double, 3>> polyline = {{
+        vertices[v][0], vertices[v][1], vertices[v][2]
+      }};
+      while (true) {
+        visited[k] = true;
+        v = edges[k][0] == v ? edges[k][1] : edges[k][0];
+        polyline.push_back({vertices[v][0], vertices[v][1], vertices[v][2]});
+        if (incident[v].size() != 2) {
+          break;
+        }
+        k = incident[v][0] == k ? incident[v][1] : incident[v][0];
+        if (visited[k]) {
+          break;
+        }
+      }
+      features.push_back(polyline);
+    };
+    for (size_t v = 0; v < vertices.size(); v++) {
+      if (incident[v].size() != 2) {
+        for (const auto k: incident[v]) {
+          if (!visited[k]) {
+            walk(int(v), k);
+          }
+        }
+      }
+    }
+    for (size_t k = 0; k < edges.size(); k++) {
+      if (!visited[k]) {
+        walk(edges[k][0], k);
+      }
+    }
+    return features;
+  }
+
+  private:
+    static constexpr size_t leaf_size = 8;
+    // distance at which a node is replaced by its dipole, in units of its radius
+    static constexpr double beta = 2.0;
+    const std::vector<Eigen::Vector3d> vertices_;
+    const std::vector<std::array<int, 3>> faces_;
+    const Triangles triangles_;
+    Tree tree_;
+    const Features features_;
+    BoundingBox box_;
+    std::vector<Eigen::Vector3d> centroids_;
+    std::vector<Eigen::Vector3d> area_normals_;
+    std::vector<size_t> order_;
+    std::vector<Node> nodes_;
+};
+
+} // namespace pygalmesh
+
+#endif // SURFACE_MESH_DOMAIN_HPP
@@ -0,0 +1,96 @@
+import numpy as np
+
+import pygalmesh
+
+
+class Slab(pygalmesh.DomainBase):
+    def __init__(self):
+        super().__init__()
+
+    def eval(self, x):
+        return abs(x[2]) - 0.3
+
+    def get_bounding_sphere_squared_radius(self):
+        return 4.0
+
+
+def test_compiled_domain():
+    b = pygalmesh.Ball([0.1, 0.2, 0.3], 0.7)
+    c = pygalmesh.Cuboid([0.0, 0.0, 0.0], [1.0, 1.0, 1.0])
+    u = pygalmesh.Union(
+        [
+            pygalmesh.Rotate(pygalmesh.Translate(b, [0.3, 0.0, 0.0]), [1, 1, 0], 0.7),
+            pygalmesh.Stretch(c, [0.5, 1.0, 2.0]),
+            pygalmesh.Tetrahedron(
+                [0.0, 0.0, 0.0], [1.0, 0.0, 0.0], [0.0, 1.0, 0.0], [0.0, 0.0, 1.0]
+            ),
+            pygalmesh.Torus(1.0, 0.3),
+            pygalmesh.Cone(1.0, 0.3, 0.1),
+        ]
+    )
+    d = pygalmesh.Difference(pygalmesh.Scale(u, 1.3), Slab())
+    domain = pygalmesh.Intersection([d, pygalmesh.Ball([0.0, 0.0, 0.0], 1.5)])
+
+    compiled = pygalmesh.CompiledDomain(domain)
+    assert compiled.num_callouts() == 1
+
+    np.random.seed(0)
+    for x in np.random.uniform(-2.0, 2.0, size=(1000, 3)):
+        ref = domain.eval(x)
+        assert abs(compiled.eval(x) - ref) < 1.0e-13 * (1.0 + abs(ref))
+
+    assert (
+        compiled.get_bounding_sphere_squared_radius()
+        == domain.get_bounding_sphere_squared_radius()
+    )
+
+
+def test_classify():
+    balls = [
+        pygalmesh.Ball(list(x), 0.3)
+        for x in np.random.RandomState(1).uniform(-1.0, 1.0, size=(60, 3))
+    ]
+    np.random.seed(0)
+    samples = np.random.uniform(-1.0, 1.0, size=(200, 3))
+    union = pygalmesh.Union(balls)
+    sorted_union = pygalmesh.Union(balls, samples=samples)
+    domain = pygalmesh.Intersection(
+        [
+            pygalmesh.Difference(sorted_union, Slab()),
+            pygalmesh.Cuboid([-0.8, -0.8, -0.8], [0.8, 0.8, 0.8]),
+        ],
+        samples=samples,
+    )
+    compiled = pygalmesh.CompiledDomain(domain)
+
+    for x in np.random.uniform(-1.2, 1.2, size=(1000, 3)):
+        ref = -1 if domain.eval(x) < 0.0 else 1
+        assert domain.classify(x) == ref
+        assert compiled.classify(x) == ref
+        # sorting the children doesn't change the domain
+        assert sorted_union.eval(x) == union.eval(x)
+
+
+def test_fuse_transforms():
+    c = pygalmesh.Cuboid([0.0, 0.0, 0.0], [1.0, 0.5, 0.3])
+    d = pygalmesh.Rotate(pygalmesh.Translate(c, [0.1, -0.2, 0.3]), [1, 2, 3], 0.4)
+    d = pygalmesh.Stretch(pygalmesh.Scale(d, 1.3), [0.3, 0.1, 1.2])
+    d = pygalmesh.Affine(
+        d, [[1.0, 0.2, 0.0, 0.1], [0.0, 1.0, 0.3, 0.0], [0.1, 0.0, 1.0, -0.2]]
+    )
+    domain = pygalmesh.Union([d, pygalmesh.Ball([0.0, 0.0, 0.0], 0.5)])
+
+    fused = pygalmesh.fuse_transforms(domain)
+    assert isinstance(fused, pygalmesh.Union)
+    assert len(fused.get_features()) == len(domain.get_features())
+
+    np.random.seed(0)
+    for x in np.random.uniform(-2.0, 2.0, size=(1000, 3)):
+        ref = domain.eval(x)
+        assert abs(fused.eval(x) - ref) < 1.0e-13 * (1.0 + abs(ref))
+
+    # the fused bounding sphere still contains the cuboid
+    r2 = fused.get_bounding_sphere_squared_radius()
+    for x in d.get_features():
+        for pt in x:
+            assert np.dot(pt, pt) <= r2 * (1 + 1e-13)
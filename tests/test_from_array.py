@@ -1,5 +1,6 @@
 import helpers
 import numpy as np
+import pytest
 
 import pygalmesh
 
@@ -70,3 +71,66 @@ def test_from_array_with_subdomain_sizing():
     # Debian needs 2.0e-2 here.
     # <https://github.com/nschloe/pygalmesh/issues/60>
     assert abs(vol - ref) < ref * 2.0e-2
+
+
+def test_from_array_patch_numbers():
+    # labels 1 and 2 meet each other and the outside, giving three surface patches
+    vol = np.zeros((20, 20, 20), dtype=np.uint8)
+    vol[2:10, 2:18, 2:18] = 1
+    vol[10:18, 2:18, 2:18] = 2
+
+    mesh = pygalmesh.generate_from_array(
+        vol,
+        (0.1, 0.1, 0.1),
+        max_cell_circumradius=0.2,
+        max_facet_distance=0.05,
+        verbose=False,
+    )
+
+    refs = mesh.get_cell_data("medit:ref", "triangle")
+    assert refs[0] == 1
+    assert set(refs) == {1, 2, 3}
+    # numbered in the order of their first triangle
+    _, first = np.unique(refs, return_index=True)
+    assert np.all(np.diff(first) > 0)
+    assert set(mesh.get_cell_data("medit:ref", "tetra")) == {1, 2}
+
+
+def test_from_array_memory_order():
+    # an anisotropic box of label 1, meshed from C- and Fortran-ordered memory
+    vol = np.zeros((20, 30, 40), dtype=np.uint8)
+    vol[5:15, 5:25, 5:35] = 1
+    h = (0.1, 0.2, 0.3)
+    origin = (1.0, 2.0, 3.0)
+
+    for v in [np.ascontiguousarray(vol), np.asfortranarray(vol)]:
+        mesh = pygalmesh.generate_from_array(
+            v,
+            h,
+            origin=origin,
+            max_cell_circumradius=0.5,
+            max_facet_distance=0.1,
+            verbose=False,
+        )
+        for i in range(3):
+            lo = origin[i] + 5 * h[i]
+            hi = origin[i] + (vol.shape[i] - 5) * h[i]
+            assert abs(min(mesh.points[:, i]) - lo) < 1.01 * h[i]
+            assert abs(max(mesh.points[:, i]) - hi) < 1.01 * h[i]
+
+        # cells are positively oriented
+        p = mesh.points[mesh.get_cells_type("tetra")]
+        omega = np.einsum(
+            "ij,ij->i", p[:, 1] - p[:, 0], np.cross(p[:, 2] - p[:, 0], p[:, 3] - p[:, 0])
+        )
+        assert np.all(omega > 0.0)
+
+
+def test_image_array_dtypes():
+    from _pygalmesh import _ImageArray
+
+    for dtype in [np.uint8, np.uint16, np.float32, np.float64]:
+        _ImageArray(np.zeros((2, 2, 2), dtype=dtype), (1.0, 1.0, 1.0))
+    for dtype in [np.uint32, np.int16, np.float16, np.dtype(">u2")]:
+        with pytest.raises(ValueError):
+            _ImageArray(np.zeros((2, 2, 2), dtype=dtype), (1.0, 1.0, 1.0))
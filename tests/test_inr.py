@@ -3,6 +3,7 @@ import tempfile
 
 import helpers
 import meshio
+import numpy as np
 
 import pygalmesh
 
@@ -42,3 +43,23 @@ def test_inr():
     # Debian needs 2.0e-2 here.
     # <https://github.com/nschloe/pygalmesh/issues/60>
     assert abs(vol - ref) < ref * 2.0e-2, f"{vol:.8e}"
+
+
+def test_inr_with_mesh_sizing_field():
+    this_dir = pathlib.Path(__file__).resolve().parent
+    inr = str(this_dir / "meshes" / "sphere.inr")
+    coarse = pygalmesh.generate_from_inr(inr, max_cell_circumradius=2.0, verbose=False)
+
+    # finer toward the center of the sphere, as a solver might ask for
+    tetra = coarse.get_cells_type("tetra")
+    sizes = 0.5 + 0.3 * np.linalg.norm(coarse.points - 4.5, axis=1)
+    field = pygalmesh.MeshSizingField(coarse.points, tetra, sizes)
+    assert abs(field.eval(coarse.points[tetra[0, 0]]) - sizes[tetra[0, 0]]) < 1.0e-10
+    centroid = np.mean(coarse.points[tetra[0]], axis=0)
+    assert abs(field.eval(centroid) - np.mean(sizes[tetra[0]])) < 1.0e-10
+
+    mesh = pygalmesh.generate_from_inr(inr, max_cell_circumradius=field, verbose=False)
+    assert len(mesh.points) > len(coarse.points)
+    vol = sum(helpers.compute_volumes(mesh.points, mesh.get_cells_type("tetra")))
+    ref = 6.95558790e02
+    assert abs(vol - ref) < ref * 2.0e-2, f"{vol:.8e}"
@@ -1,3 +1,9 @@
+import sys
+import time
+
+import numpy as np
+import pytest
+
 import pygalmesh
 
 
@@ -9,3 +15,146 @@ def test_cylinder():
     assert len(mesh.points) == 71
     assert mesh.cells[0].type == "triangle"
     assert len(mesh.cells[0].data) == 220
+
+
+def test_eval_many():
+    domain = pygalmesh.Difference(
+        pygalmesh.Union(
+            [
+                pygalmesh.Rotate(pygalmesh.Ball([0.3, 0.0, 0.0], 0.7), [0, 1, 1], 0.3),
+                pygalmesh.Scale(pygalmesh.Cuboid([0, 0, 0], [1, 1, 1]), 1.5),
+                pygalmesh.Stretch(pygalmesh.Torus(1.0, 0.3), [0.0, 0.0, 2.0]),
+                pygalmesh.Translate(pygalmesh.Cone(1.0, 0.5, 0.1), [0.0, 0.0, -1.0]),
+                pygalmesh.Cylinder(-1.0, 1.0, 0.3, 0.1),
+                pygalmesh.Ellipsoid([0.0, 0.0, 0.0], 1.0, 0.5, 0.3),
+            ]
+        ),
+        pygalmesh.Intersection(
+            [
+                pygalmesh.HalfSpace([0.0, 0.0, 1.0], 0.2, 4.0),
+                pygalmesh.Ball([0.0, 0.0, 0.0], 1.2),
+            ]
+        ),
+    )
+    np.random.seed(0)
+    # an odd number of points to exercise the remainder loops
+    x = np.random.uniform(-2.0, 2.0, size=(10001, 3))
+    vals = domain.eval_many(x)
+    ref = np.array([domain.eval(pt) for pt in x])
+    assert vals.shape == (10001,)
+    assert np.all(np.abs(vals - ref) < 1.0e-13 * (1.0 + np.abs(ref)))
+
+
+def test_eval_many_python_domain():
+    class Sphere(pygalmesh.DomainBase):
+        def __init__(self):
+            super().__init__()
+
+        def eval(self, x):
+            return x[0] ** 2 + x[1] ** 2 + x[2] ** 2 - 1.0
+
+        def get_bounding_sphere_squared_radius(self):
+            return 2.0
+
+    sphere = Sphere()
+    ball = pygalmesh.Ball([1.0, 0.0, 0.0], 0.5)
+    union = pygalmesh.Union([sphere, ball])
+
+    np.random.seed(0)
+    x = np.random.uniform(-2.0, 2.0, size=(5001, 3))
+    # eval_many releases the GIL, the Python eval() takes it back
+    vals = sphere.eval_many(x)
+    ref = np.sum(x**2, axis=1) - 1.0
+    assert np.all(np.abs(vals - ref) < 1.0e-13 * (1.0 + np.abs(ref)))
+
+    vals = union.eval_many(x)
+    ref = np.minimum(ref, [ball.eval(pt) for pt in x])
+    assert np.all(np.abs(vals - ref) < 1.0e-13 * (1.0 + np.abs(ref)))
+
+
+def test_large_union():
+    np.random.seed(1)
+    balls = [pygalmesh.Ball(list(x), 0.05) for x in np.random.uniform(-1, 1, (500, 3))]
+    domain = pygalmesh.Union(balls)
+
+    box = domain.get_bounding_box()
+    assert np.all(np.array(box[0]) > -1.06)
+    assert np.all(np.array(box[1]) < 1.06)
+
+    x = np.random.uniform(-1.2, 1.2, size=(2000, 3))
+    ref = np.min([[b.eval(pt) for pt in x] for b in balls], axis=0)
+    # exact inside, only the sign and an upper bound outside of all child boxes
+    inside = ref < 0.0
+    vals = domain.eval_many(x)
+    assert np.all(np.abs(vals - ref)[inside] < 1.0e-13 * (1.0 + np.abs(ref[inside])))
+    assert np.all((vals < 0.0) == inside)
+    assert np.all(vals >= ref - 1.0e-13 * (1.0 + np.abs(ref)))
+    vals = np.array([domain.eval(pt) for pt in x])
+    assert np.all(vals[inside] == ref[inside])
+    assert np.all((vals < 0.0) == inside)
+    assert np.all(vals >= ref)
+    assert np.all(
+        np.array([domain.classify(pt) for pt in x]) == np.where(ref < 0.0, -1, 1)
+    )
+
+
+def test_nested_features():
+    c = pygalmesh.Cuboid([0.0, 0.0, 0.0], [1.0, 0.5, 0.3])
+    cone = pygalmesh.Cone(0.5, 1.0, 0.1)
+    u = pygalmesh.Union([c, pygalmesh.Scale(cone, 2.0)])
+    d = pygalmesh.Translate(pygalmesh.Rotate(u, [0.0, 0.0, 1.0], np.pi / 2), [1.0, 2.0, 3.0])
+
+    ref = c.get_features() + [[[2 * v for v in pt] for pt in f] for f in cone.get_features()]
+    features = d.get_features()
+    assert len(features) == len(ref)
+    for f, f_ref in zip(features, ref):
+        # rotation by 90 degrees about z, then translation
+        f_ref = np.array(f_ref)
+        f_ref = np.column_stack([-f_ref[:, 1], f_ref[:, 0], f_ref[:, 2]]) + [1.0, 2.0, 3.0]
+        assert np.all(np.abs(np.array(f) - f_ref) < 1.0e-13)
+
+
+def test_polygon2d_is_inside():
+    n = 10000
+    t = 2 * np.pi * np.arange(n) / n
+    poly = pygalmesh.Polygon2D(np.column_stack([np.cos(t), np.sin(t)]).tolist())
+
+    np.random.seed(0)
+    for x in np.random.uniform(-1.2, 1.2, size=(1000, 2)):
+        r = np.sqrt(np.dot(x, x))
+        # skip points too close to the boundary to decide with the circle
+        if abs(r - 1.0) > 1.0e-6:
+            assert poly.is_inside(x.tolist()) == (r < 1.0)
+
+    # points on the boundary are inside
+    assert poly.is_inside([1.0, 0.0])
+    assert not poly.is_inside([1.0 + 1.0e-12, 0.0])
+
+
+def test_polygon2d_comb():
+    # 2500 teeth of height 2 that all overlap the same y-range
+    m = 2500
+    points = []
+    for k in range(m):
+        points += [[2.0 * k, 1.0], [2.0 * k + 1, 1.0]]
+        if k < m - 1:
+            points += [[2.0 * k + 1, -1.0], [2.0 * k + 2, -1.0]]
+    points += [[2.0 * m - 1, -2.0], [0.0, -2.0]]
+    assert len(points) == 10000
+
+    resource = pytest.importorskip("resource")
+    rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    start = time.perf_counter()
+    poly = pygalmesh.Polygon2D(points)
+    assert time.perf_counter() - start < 1.0
+    # An index with an entry per tooth and band takes hundreds of megabytes.
+    # ru_maxrss is in bytes on macOS and in kilobytes elsewhere.
+    kb = 1024 if sys.platform == "darwin" else 1
+    assert (resource.getrusage(resource.RUSAGE_SELF).ru_maxrss - rss) / kb < 50 * 1024
+
+    for k in range(0, m, 97):
+        assert poly.is_inside([2.0 * k + 0.5, 0.0])
+        assert not poly.is_inside([2.0 * k + 1.5, 0.0])
+        assert poly.is_inside([2.0 * k + 1.5, -1.5])
+        assert poly.is_inside([2.0 * k, 0.0])
+        assert not poly.is_inside([2.0 * k + 0.5, 1.5])
@@ -54,3 +54,21 @@ def test_remesh_surface():
     vol = sum(triangle_areas)
     ref = 1.2357989593759846
     assert abs(vol - ref) < ref * 1.0e-3, vol
+
+
+def test_remesh_surface_with_sizing_field():
+    this_dir = pathlib.Path(__file__).resolve().parent
+    mesh = pygalmesh.remesh_surface(
+        meshio.read(this_dir / "meshes" / "elephant.vtu"),
+        max_edge_size_at_feature_edges=0.025,
+        min_facet_angle=25,
+        # finer toward the front
+        max_radius_surface_delaunay_ball=lambda x: 0.05 + 0.1 * (x[1] + 0.5),
+        max_facet_distance=0.001,
+        verbose=False,
+    )
+    triangle_areas = helpers.compute_triangle_areas(
+        mesh.points, mesh.get_cells_type("triangle")
+    )
+    ref = 1.2357989593759846
+    assert abs(sum(triangle_areas) - ref) < ref * 1.0e-2
@@ -51,3 +51,52 @@ def test_volume_from_surface():
 
     vol = sum(helpers.compute_volumes(mesh.points, mesh.get_cells_type("tetra")))
     assert abs(vol - 0.044164693065) < (1.0 + vol) * tol
+
+
+def test_volume_from_surface_in_memory():
+    this_dir = pathlib.Path(__file__).resolve().parent
+    surface = meshio.read(this_dir / "meshes" / "elephant.vtu")
+    mesh = pygalmesh.generate_volume_mesh_from_surface_mesh(
+        surface,
+        min_facet_angle=0.5,
+        max_radius_surface_delaunay_ball=0.15,
+        max_facet_distance=0.008,
+        max_circumradius_edge_ratio=3.0,
+        verbose=False,
+    )
+    vol = sum(helpers.compute_volumes(mesh.points, mesh.get_cells_type("tetra")))
+    tol = 2.0e-2
+    assert abs(vol - 0.044164693065) < (1.0 + vol) * tol
+
+
+def test_volume_from_surface_with_sizing_fields():
+    this_dir = pathlib.Path(__file__).resolve().parent
+    surface = meshio.read(this_dir / "meshes" / "elephant.vtu")
+    kwargs = dict(
+        min_facet_angle=0.5,
+        max_facet_distance=0.008,
+        max_circumradius_edge_ratio=3.0,
+        verbose=False,
+    )
+    fine = pygalmesh.generate_volume_mesh_from_surface_mesh(
+        surface, max_radius_surface_delaunay_ball=0.05, **kwargs
+    )
+    # fine at the front only
+    field = pygalmesh.MaxSizingField(
+        [
+            pygalmesh.ConstantSizingField(0.05),
+            pygalmesh.ScaledSizingField(
+                pygalmesh.DistanceToPointsField([[0.0, -0.5, 0.0]]), 0.3
+            ),
+        ]
+    )
+    graded = pygalmesh.generate_volume_mesh_from_surface_mesh(
+        surface,
+        max_radius_surface_delaunay_ball=field,
+        max_cell_circumradius=field,
+        **kwargs,
+    )
+    assert len(graded.points) < len(fine.points)
+    vol = sum(helpers.compute_volumes(graded.points, graded.get_cells_type("tetra")))
+    tol = 2.0e-2
+    assert abs(vol - 0.044164693065) < (1.0 + vol) * tol
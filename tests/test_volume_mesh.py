@@ -1,5 +1,9 @@
+import ctypes
+
 import helpers
 import numpy as np
+import pytest
+from _pygalmesh import _HAS_PARALLEL
 
 import pygalmesh
 
@@ -298,6 +302,95 @@ def test_tetrahedron():
     assert abs(vol - 1.0 / 6.0) < tol
 
 
+def test_convex_polyhedron():
+    # triangular prism
+    s0 = pygalmesh.ConvexPolyhedron(
+        [
+            [-1.0, 0.0, 0.0],
+            [0.0, -1.0, 0.0],
+            [1.0, 1.0, 0.0],
+            [0.0, 0.0, -1.0],
+            [0.0, 0.0, 1.0],
+        ],
+        [0.0, 0.0, 1.0, 0.0, 1.0],
+    )
+    assert len(s0.get_features()) == 9
+
+    mesh = pygalmesh.generate_mesh(
+        s0,
+        max_cell_circumradius=0.1,
+        max_edge_size_at_feature_edges=0.1,
+        verbose=False,
+    )
+
+    tol = 1.0e-3
+    assert abs(max(mesh.points[:, 0]) - 1.0) < tol
+    assert abs(min(mesh.points[:, 0]) + 0.0) < tol
+    assert abs(max(mesh.points[:, 1]) - 1.0) < tol
+    assert abs(min(mesh.points[:, 1]) + 0.0) < tol
+    assert abs(max(mesh.points[:, 2]) - 1.0) < tol
+    assert abs(min(mesh.points[:, 2]) + 0.0) < tol
+
+    vol = sum(helpers.compute_volumes(mesh.points, mesh.get_cells_type("tetra")))
+    assert abs(vol - 0.5) < tol
+
+
+def test_convex_polyhedron_invalid():
+    # open prism, missing the top
+    with pytest.raises(ValueError):
+        pygalmesh.ConvexPolyhedron(
+            [[-1.0, 0.0, 0.0], [0.0, -1.0, 0.0], [1.0, 1.0, 0.0], [0.0, 0.0, -1.0]],
+            [0.0, 0.0, 1.0, 0.0],
+        )
+    # x <= -1 and x >= 0
+    with pytest.raises(ValueError):
+        pygalmesh.ConvexPolyhedron(
+            [
+                [1.0, 0.0, 0.0],
+                [-1.0, 0.0, 0.0],
+                [0.0, 1.0, 0.0],
+                [0.0, -1.0, 0.0],
+                [0.0, 0.0, 1.0],
+                [0.0, 0.0, -1.0],
+            ],
+            [-1.0, 0.0, 1.0, 1.0, 1.0, 1.0],
+        )
+
+
+def test_surface_mesh_domain():
+    # unit cube with outward-oriented faces
+    vertices = [[float(k & 1), float((k >> 1) & 1), float((k >> 2) & 1)] for k in range(8)]
+    faces = [
+        [0, 2, 1], [1, 2, 3], [4, 5, 6], [5, 7, 6],
+        [0, 1, 4], [1, 5, 4], [2, 6, 3], [3, 6, 7],
+        [0, 4, 2], [2, 4, 6], [1, 3, 5], [3, 7, 5],
+    ]
+    cube = pygalmesh.SurfaceMeshDomain(vertices, faces)
+    assert len(cube.get_features()) == 12
+    assert abs(cube.winding_number([0.5, 0.5, 0.5]) - 1.0) < 1.0e-12
+    assert cube.eval([0.5, 0.5, 0.5]) < 0.0
+    assert abs(cube.eval([2.0, 0.5, 0.5]) - 1.0) < 1.0e-12
+
+    # cut a ball out of a corner
+    ball = pygalmesh.Ball([1.0, 1.0, 1.0], 0.5)
+    d = pygalmesh.Difference(cube, ball)
+    mesh = pygalmesh.generate_mesh(
+        d,
+        max_cell_circumradius=0.1,
+        max_edge_size_at_feature_edges=0.1,
+        verbose=False,
+    )
+
+    tol = 1.0e-3
+    assert abs(max(mesh.points[:, 0]) - 1.0) < tol
+    assert abs(min(mesh.points[:, 0]) + 0.0) < tol
+    assert abs(min(mesh.points[:, 2]) + 0.0) < tol
+
+    vol = sum(helpers.compute_volumes(mesh.points, mesh.get_cells_type("tetra")))
+    ref = 1.0 - np.pi * 0.5**3 / 6
+    assert abs(vol - ref) < 1.0e-2
+
+
 def test_torus():
     major_radius = 1.0
     minor_radius = 0.5
@@ -610,6 +703,341 @@ def test_ball_with_sizing_field():
     assert abs(vol - 4.0 / 3.0 * np.pi) < 0.15
 
 
+def test_ball_with_grid_sizing_field():
+    x = np.linspace(-1.0, 1.0, 21)
+    X, Y, Z = np.meshgrid(x, x, x, indexing="ij")
+    sizes = np.abs(np.sqrt(X**2 + Y**2 + Z**2) - 0.5) / 5 + 0.025
+    field = pygalmesh.GridSizingField(
+        sizes, origin=[-1.0, -1.0, -1.0], spacing=[0.1, 0.1, 0.1]
+    )
+    assert abs(field.eval([0.5, 0.0, 0.0]) - 0.025) < 1.0e-12
+    # clamped outside of the grid
+    assert field.eval([3.0, 0.0, 0.0]) == field.eval([1.0, 0.0, 0.0])
+
+    cubic = pygalmesh.GridSizingField(
+        sizes, [-1.0, -1.0, -1.0], [0.1, 0.1, 0.1], interpolation="cubic"
+    )
+    assert abs(cubic.eval([0.5, 0.0, 0.0]) - 0.025) < 1.0e-12
+
+    mesh = pygalmesh.generate_mesh(
+        pygalmesh.Ball([0.0, 0.0, 0.0], 1.0),
+        min_facet_angle=30.0,
+        max_radius_surface_delaunay_ball=field,
+        max_facet_distance=0.025,
+        max_circumradius_edge_ratio=2.0,
+        max_cell_circumradius=cubic,
+        verbose=False,
+    )
+    vol = sum(helpers.compute_volumes(mesh.points, mesh.get_cells_type("tetra")))
+    assert abs(vol - 4.0 / 3.0 * np.pi) < 0.15
+
+
+def test_ball_with_composed_sizing_field():
+    ball = pygalmesh.Ball([0.0, 0.0, 0.0], 1.0)
+    # fine near the center and along the boundary, coarse in between
+    to_center = pygalmesh.ScaledSizingField(
+        pygalmesh.DistanceToPointsField([[0.0, 0.0, 0.0]]), 0.3, 0.05
+    )
+    to_boundary = pygalmesh.ScaledSizingField(
+        pygalmesh.DistanceToSurfaceField(ball, [-1.1, -1.1, -1.1, 1.1, 1.1, 1.1]),
+        0.3,
+        0.05,
+    )
+    field = pygalmesh.MinSizingField(
+        [pygalmesh.ConstantSizingField(0.2), to_center, to_boundary]
+    )
+    assert abs(field.eval([0.0, 0.0, 0.0]) - 0.05) < 1.0e-12
+    assert abs(field.eval([0.5, 0.0, 0.0]) - 0.2) < 1.0e-3
+    assert abs(field.eval([0.0, 0.0, 1.0]) - 0.05) < 0.01
+
+    segment = pygalmesh.DistanceToPolylinesField([[[0.0, 0.0, 0.0], [1.0, 0.0, 0.0]]])
+    assert abs(segment.eval([0.5, 0.5, 0.0]) - 0.5) < 1.0e-12
+
+    graded = pygalmesh.GradedSizingField(
+        field, 0.5, [-1.1, -1.1, -1.1, 1.1, 1.1, 1.1]
+    )
+    assert graded.eval([0.5, 0.0, 0.0]) <= field.eval([0.5, 0.0, 0.0]) + 1.0e-12
+
+    mesh = pygalmesh.generate_mesh(
+        ball,
+        min_facet_angle=30.0,
+        max_radius_surface_delaunay_ball=0.1,
+        max_facet_distance=0.025,
+        max_circumradius_edge_ratio=2.0,
+        max_cell_circumradius=graded,
+        verbose=False,
+    )
+    vol = sum(helpers.compute_volumes(mesh.points, mesh.get_cells_type("tetra")))
+    assert abs(vol - 4.0 / 3.0 * np.pi) < 0.15
+
+
+def test_ball_with_native_functions():
+    # ctypes callbacks stand in for, e.g., numba cfuncs; they must be kept alive
+    point = ctypes.POINTER(ctypes.c_double)
+    eval_type = ctypes.CFUNCTYPE(ctypes.c_double, point)
+    batch_type = ctypes.CFUNCTYPE(None, point, point, ctypes.c_size_t)
+
+    def ball(x):
+        return x[0] ** 2 + x[1] ** 2 + x[2] ** 2 - 1.0
+
+    def ball_batch(x, out, n):
+        for i in range(n):
+            out[i] = ball(x[3 * i : 3 * i + 3])
+
+    eval_fun = eval_type(ball)
+    batch_fun = batch_type(ball_batch)
+    size_fun = eval_type(lambda x: 0.1 + 0.1 * abs(x[2]))
+
+    def address(f):
+        return ctypes.cast(f, ctypes.c_void_p).value
+
+    domain = pygalmesh.NativeDomain(address(eval_fun), 1.0, address(batch_fun))
+    field = pygalmesh.NativeSizingField(address(size_fun))
+    assert domain.eval([0.0, 0.0, 0.0]) == -1.0
+    # through the batched function
+    values = domain.eval_many(np.array([[0.0, 0.0, 0.0], [2.0, 0.0, 0.0]]))
+    assert np.allclose(values, [-1.0, 3.0])
+    assert abs(field.eval([0.0, 0.0, 1.0]) - 0.2) < 1.0e-12
+
+    mesh = pygalmesh.generate_mesh(
+        domain,
+        max_cell_circumradius=field,
+        max_facet_distance=0.025,
+        verbose=False,
+    )
+    vol = sum(helpers.compute_volumes(mesh.points, mesh.get_cells_type("tetra")))
+    assert abs(vol - 4.0 / 3.0 * np.pi) < 0.15
+
+
+def test_threads():
+    from concurrent.futures import ThreadPoolExecutor
+
+    def generate(radius):
+        s = pygalmesh.Ball([0.0, 0.0, 0.0], radius)
+        return pygalmesh.generate_mesh(
+            s, max_cell_circumradius=0.2, verbose=False, seed=1
+        )
+
+    radii = [1.0, 1.5, 1.0, 1.5]
+    with ThreadPoolExecutor(max_workers=4) as executor:
+        meshes = list(executor.map(generate, radii))
+
+    # same results as serial runs
+    for radius, mesh in zip(radii, meshes):
+        ref = generate(radius)
+        assert np.array_equal(mesh.points, ref.points)
+        assert np.array_equal(mesh.get_cells_type("tetra"), ref.get_cells_type("tetra"))
+
+
+@pytest.mark.skipif(not _HAS_PARALLEL, reason="built without TBB")
+def test_parallel():
+    s = pygalmesh.Difference(
+        pygalmesh.Ball([0.0, 0.0, 0.0], 1.0),
+        pygalmesh.Ball([0.5, 0.0, 0.0], 0.5),
+    )
+    mesh = pygalmesh.generate_mesh(
+        s, max_cell_circumradius=0.1, num_threads=2, verbose=False
+    )
+
+    vol = sum(helpers.compute_volumes(mesh.points, mesh.get_cells_type("tetra")))
+    ref = 4.0 / 3.0 * np.pi * (1.0 - 0.5**3)
+    assert abs(vol - ref) < 0.1
+
+
+def test_mesh_arrays():
+    s = pygalmesh.Ball([0.0, 0.0, 0.0], 1.0)
+    result = pygalmesh.generate_mesh(
+        s, max_cell_circumradius=0.2, verbose=False, lazy=True
+    )
+    data = result.arrays()
+
+    # the arrays wrap the buffers of the mesher
+    assert data["points"].dtype == np.float64
+    assert data["points"].shape[1] == 3
+    assert data["points"].base is not None
+    assert data["tetra"].shape == (len(data["tetra_subdomain"]), 4)
+    assert data["triangle"].shape == (len(data["triangle_patch"]), 3)
+
+    mesh = pygalmesh.generate_mesh(s, max_cell_circumradius=0.2, verbose=False)
+    assert np.all(mesh.get_cell_data("medit:ref", "tetra") == 1)
+
+    # boundary facets are oriented outward
+    p = mesh.points[mesh.get_cells_type("triangle")]
+    vol = np.sum(np.einsum("ij,ij->i", p[:, 0], np.cross(p[:, 1], p[:, 2]))) / 6
+    assert abs(vol - 4.0 / 3.0 * np.pi) < 0.15
+
+
+def test_save_and_refine(tmp_path):
+    s = pygalmesh.Ball([0.0, 0.0, 0.0], 1.0)
+    coarse = pygalmesh.generate_mesh(
+        s, max_cell_circumradius=0.4, verbose=False, lazy=True
+    )
+    num_coarse = coarse.num_cells("tetra")
+    coarse.save(str(tmp_path / "ball.bin"))
+
+    restored = pygalmesh.load_mesh(str(tmp_path / "ball.bin"), s)
+    assert restored.num_points == coarse.num_points
+    assert restored.num_cells("tetra") == num_coarse
+
+    mesh = pygalmesh.refine_existing(restored, max_cell_circumradius=0.2, verbose=False)
+    assert len(mesh.get_cells_type("tetra")) > num_coarse
+    vol = sum(helpers.compute_volumes(mesh.points, mesh.get_cells_type("tetra")))
+    assert abs(vol - 4.0 / 3.0 * np.pi) < 0.15
+
+
+def test_refine_with_sizing_field():
+    s = pygalmesh.Ball([0.0, 0.0, 0.0], 1.0)
+    coarse = pygalmesh.generate_mesh(
+        s, max_cell_circumradius=0.4, verbose=False, lazy=True
+    )
+    num_coarse = coarse.num_cells("tetra")
+
+    # nothing but the options references the lambda and its wrapper
+    mesh = pygalmesh.refine_existing(
+        coarse,
+        max_cell_circumradius=lambda x: 0.1 + 0.15 * abs(x[2]),
+        verbose=False,
+    )
+    assert len(mesh.get_cells_type("tetra")) > num_coarse
+    vol = sum(helpers.compute_volumes(mesh.points, mesh.get_cells_type("tetra")))
+    assert abs(vol - 4.0 / 3.0 * np.pi) < 0.15
+
+
+def test_partitioned():
+    s = pygalmesh.Ball([0.0, 0.0, 0.0], 1.0)
+    mesh = pygalmesh.generate_mesh_partitioned(
+        s,
+        bounding_cuboid=[-1.1, -1.1, -1.1, 1.1, 1.1, 1.1],
+        num_blocks=(2, 2, 1),
+        max_cell_circumradius=0.2,
+        max_edge_size_at_feature_edges=0.1,
+        verbose=False,
+        max_workers=2,
+    )
+
+    assert abs(max(mesh.points[:, 0]) - 1.0) < 0.02
+    assert abs(min(mesh.points[:, 0]) + 1.0) < 0.02
+    vol = sum(helpers.compute_volumes(mesh.points, mesh.get_cells_type("tetra")))
+    assert abs(vol - 4.0 / 3.0 * np.pi) < 0.15
+
+    # there are no facets between the blocks
+    triangles = mesh.get_cells_type("triangle")
+    assert not np.any(np.all(np.abs(mesh.points[triangles, 0]) < 1.0e-3, axis=1))
+
+
+def test_partitioned_conforming():
+    s = pygalmesh.Ball([0.0, 0.0, 0.0], 1.0)
+    mesh = pygalmesh.generate_mesh_partitioned(
+        s,
+        bounding_cuboid=[-1.1, -1.1, -1.1, 1.1, 1.1, 1.1],
+        num_blocks=(2, 2, 2),
+        max_cell_circumradius=0.2,
+        max_edge_size_at_feature_edges=0.1,
+        verbose=False,
+        max_workers=2,
+    )
+
+    # Each face of a tetra is shared with at most one other tetra, and those on only
+    # one are on the sphere, so there are no cracks between the blocks.
+    tetras = mesh.get_cells_type("tetra")
+    faces = np.concatenate([np.delete(tetras, i, axis=1) for i in range(4)])
+    faces, counts = np.unique(np.sort(faces, axis=1), axis=0, return_counts=True)
+    assert np.all(counts <= 2)
+    boundary = faces[counts == 1]
+    centroid_norms = np.linalg.norm(np.mean(mesh.points[boundary], axis=1), axis=1)
+    assert np.all(np.abs(centroid_norms - 1.0) < 0.05)
+
+    # the triangles are the boundary faces
+    triangles = np.unique(np.sort(mesh.get_cells_type("triangle"), axis=1), axis=0)
+    assert np.array_equal(triangles, boundary)
+
+
+def test_generate_many():
+    jobs = {
+        radius: {
+            "domain": pygalmesh.Ball([0.0, 0.0, 0.0], radius),
+            "max_cell_circumradius": 0.2,
+        }
+        for radius in [1.0, 1.5, 2.0]
+    }
+    meshes = dict(pygalmesh.generate_many(jobs, max_workers=2))
+    assert sorted(meshes.keys()) == [1.0, 1.5, 2.0]
+
+    for radius, mesh in meshes.items():
+        vol = sum(helpers.compute_volumes(mesh.points, mesh.get_cells_type("tetra")))
+        assert abs(vol - 4.0 / 3.0 * np.pi * radius**3) < 0.15 * radius**3
+
+    # same seeds, same meshes
+    ref = pygalmesh.generate_mesh(
+        jobs[1.5]["domain"], max_cell_circumradius=0.2, seed=1, verbose=False
+    )
+    assert np.array_equal(meshes[1.5].points, ref.points)
+
+
+def test_generate_many_python_objects():
+    import gc
+
+    class Sphere(pygalmesh.DomainBase):
+        def __init__(self, radius):
+            super().__init__()
+            self.radius = radius
+
+        def eval(self, x):
+            return np.sqrt(np.dot(x, x)) - self.radius
+
+        def get_bounding_sphere_squared_radius(self):
+            return 4.0 * self.radius**2
+
+    # only the batch references the domains and the sizing functions
+    results = pygalmesh.generate_many(
+        [
+            (
+                Sphere(radius),
+                {"max_cell_circumradius": lambda x: 0.3, "max_facet_distance": 0.05},
+            )
+            for radius in [1.0, 1.5]
+        ],
+        max_workers=2,
+    )
+    gc.collect()
+    meshes = dict(results)
+
+    for k, radius in enumerate([1.0, 1.5]):
+        mesh = meshes[k]
+        vol = sum(helpers.compute_volumes(mesh.points, mesh.get_cells_type("tetra")))
+        assert abs(vol - 4.0 / 3.0 * np.pi * radius**3) < 0.15 * radius**3
+
+
+def test_budgets():
+    s = pygalmesh.Ball([0.0, 0.0, 0.0], 1.0)
+
+    phases = []
+    with pytest.warns(RuntimeWarning, match="max_vertices"):
+        mesh = pygalmesh.generate_mesh(
+            s,
+            max_cell_circumradius=0.05,
+            max_vertices=500,
+            verbose=False,
+            progress=lambda phase, *counts: phases.append(phase),
+        )
+    # Mesh_3 checks the budget between two insertions
+    assert len(mesh.points) < 600
+    assert phases[0] == "refine"
+    assert phases[-1] == "done"
+
+    token = pygalmesh.CancelToken()
+    token.cancel()
+    with pytest.warns(RuntimeWarning, match="cancelled"):
+        pygalmesh.generate_mesh(
+            s, max_cell_circumradius=0.05, verbose=False, cancel_token=token
+        )
+
+    with pytest.raises(ZeroDivisionError):
+        pygalmesh.generate_mesh(
+            s, max_cell_circumradius=0.2, verbose=False, progress=lambda *args: 1 / 0
+        )
+
+
 if __name__ == "__main__":
     test_ball()
     # test_ball_with_sizing_field()
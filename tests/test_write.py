@@ -0,0 +1,56 @@
+import pathlib
+import tempfile
+
+import meshio
+import numpy as np
+import pytest
+
+import pygalmesh
+
+
+@pytest.mark.parametrize("lazy", [False, True])
+@pytest.mark.parametrize("suffix", [".meshb", ".vtu"])
+def test_write(suffix, lazy):
+    s = pygalmesh.Ball([0.0, 0.0, 0.0], 1.0)
+    mesh = pygalmesh.generate_mesh(s, max_cell_circumradius=0.2, verbose=False)
+    result = pygalmesh.generate_mesh(
+        s, max_cell_circumradius=0.2, verbose=False, lazy=lazy
+    )
+
+    with tempfile.TemporaryDirectory() as tmp:
+        filename = pathlib.Path(tmp) / ("out" + suffix)
+        pygalmesh.write(filename, result)
+        ref = meshio.read(filename)
+
+    assert np.array_equal(mesh.points, ref.points)
+    for cell_type in ["triangle", "tetra"]:
+        assert np.array_equal(
+            mesh.get_cells_type(cell_type), ref.get_cells_type(cell_type)
+        )
+        assert np.array_equal(
+            mesh.get_cell_data("medit:ref", cell_type),
+            ref.get_cell_data("medit:ref", cell_type),
+        )
+
+
+def test_iter_chunks():
+    s = pygalmesh.Ball([0.0, 0.0, 0.0], 1.0)
+    mesh = pygalmesh.generate_mesh(s, max_cell_circumradius=0.2, verbose=False)
+    result = pygalmesh.generate_mesh(
+        s, max_cell_circumradius=0.2, verbose=False, lazy=True
+    )
+
+    tetra = mesh.get_cells_type("tetra")
+    assert result.num_points == len(mesh.points)
+    assert result.num_cells("tetra") == len(tetra)
+
+    chunks = list(result.iter_chunks(100))
+    assert all(len(cells) == 100 for _, cells in chunks[:-1])
+    cells = np.concatenate([cells for _, cells in chunks])
+    pts = np.concatenate([pts for pts, _ in chunks])
+    assert np.array_equal(cells, tetra)
+    assert np.array_equal(pts, mesh.points[tetra])
+
+    # a second pass starts over
+    _, cells = next(iter(result.iter_chunks(10**6, cell_type="triangle")))
+    assert np.array_equal(cells, mesh.get_cells_type("triangle"))